@@ -0,0 +1,218 @@
+#ifndef TGD_HEADER_BENCHMARKS_SYNTHETIC_DATA_HPP
+#define TGD_HEADER_BENCHMARKS_SYNTHETIC_DATA_HPP
+
+/*****************************************************************************
+
+  Generator for synthetic layer content and tiles.
+
+  Everything is generated from a seeded pseudo-random number generator, so
+  the same parameters always give the same data on every machine. This
+  makes benchmark results comparable without needing any input files.
+
+*****************************************************************************/
+
+#include <tgd_header/layer.hpp>
+#include <tgd_header/string_sink.hpp>
+#include <tgd_header/tile.hpp>
+#include <tgd_header/types.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace synthetic {
+
+    /**
+     * Small and fast pseudo-random number generator (xorshift64*). Unlike
+     * the generators in <random> the sequence is the same with every
+     * standard library.
+     */
+    class random {
+
+        std::uint64_t m_state;
+
+    public:
+
+        explicit random(std::uint64_t seed) noexcept :
+            m_state(seed == 0 ? 0x9e3779b97f4a7c15ULL : seed) {
+        }
+
+        std::uint64_t next() noexcept {
+            m_state ^= m_state >> 12U;
+            m_state ^= m_state << 25U;
+            m_state ^= m_state >> 27U;
+            return m_state * 0x2545f4914f6cdd1dULL;
+        }
+
+        /// Return a number in the range [0, max).
+        std::uint64_t uniform(std::uint64_t max) noexcept {
+            return next() % max;
+        }
+
+        /// Return a number in the range [0, 1).
+        double real() noexcept {
+            return static_cast<double>(next() >> 11U) / static_cast<double>(1ULL << 53U);
+        }
+
+    }; // class random
+
+    /**
+     * Draws numbers in the range [0, n) following a Zipf distribution
+     * with exponent s: Small numbers are much more common than large
+     * ones. This is typical for layer names where a few names ("roads",
+     * "buildings") are used in nearly every tile.
+     */
+    class zipf_distribution {
+
+        std::vector<double> m_cdf;
+
+    public:
+
+        zipf_distribution(std::size_t n, double s) :
+            m_cdf(std::max<std::size_t>(n, 1)) {
+            double sum = 0.0;
+            for (std::size_t k = 0; k < m_cdf.size(); ++k) {
+                sum += 1.0 / std::pow(static_cast<double>(k + 1), s);
+                m_cdf[k] = sum;
+            }
+            for (auto& value : m_cdf) {
+                value /= sum;
+            }
+        }
+
+        std::size_t operator()(random& rng) const {
+            const auto it = std::lower_bound(m_cdf.begin(), m_cdf.end(), rng.real());
+            return std::min(static_cast<std::size_t>(it - m_cdf.begin()), m_cdf.size() - 1);
+        }
+
+        /**
+         * Draw k different numbers (without replacement) and put them
+         * into out in ascending order. Each number is picked with a
+         * probability proportional to its weight in the distribution
+         * (Efraimidis-Spirakis sampling), so common numbers are still
+         * picked more often.
+         *
+         * @pre k <= n
+         */
+        void sample(random& rng, std::size_t k, std::vector<std::size_t>& out) const {
+            assert(k <= m_cdf.size());
+
+            std::vector<std::pair<double, std::size_t>> keys;
+            keys.reserve(m_cdf.size());
+            double prev = 0.0;
+            for (std::size_t i = 0; i < m_cdf.size(); ++i) {
+                const double weight = m_cdf[i] - prev;
+                prev = m_cdf[i];
+                // Larger is better: log(u) / w for u in (0, 1]
+                const double u = 1.0 - rng.real();
+                keys.emplace_back(weight > 0.0 ? std::log(u) / weight : -HUGE_VAL, i);
+            }
+
+            std::partial_sort(keys.begin(), keys.begin() + static_cast<std::ptrdiff_t>(k), keys.end(),
+                              [](const std::pair<double, std::size_t>& a, const std::pair<double, std::size_t>& b) {
+                return a.first > b.first;
+            });
+
+            out.clear();
+            for (std::size_t i = 0; i < k; ++i) {
+                out.push_back(keys[i].second);
+            }
+            std::sort(out.begin(), out.end());
+        }
+
+    }; // class zipf_distribution
+
+    /**
+     * Append size bytes of content to out. The compressibility (0.0 to
+     * 1.0) is the fraction of the content made up of words from a small
+     * vocabulary, which compresses well, the rest is random bytes, which
+     * doesn't compress at all.
+     */
+    inline void append_content(std::string& out, std::size_t size, double compressibility, random& rng) {
+        static const char* const words[] = {
+            "road", "building", "water", "landuse", "poi", "highway",
+            "residential", "park", "river", "name", "type", "class",
+            "primary", "secondary", "footway", "rail", "forest", "place"
+        };
+        constexpr const std::size_t num_words = sizeof(words) / sizeof(words[0]);
+        constexpr const std::size_t chunk_size = 64;
+
+        const auto end = out.size() + size;
+        out.reserve(end);
+        while (out.size() < end) {
+            const auto len = std::min(chunk_size, end - out.size());
+            if (rng.real() < compressibility) {
+                const auto chunk_end = out.size() + len;
+                while (out.size() < chunk_end) {
+                    const std::string word{words[rng.uniform(num_words)]};
+                    out.append(word, 0, chunk_end - out.size());
+                    if (out.size() < chunk_end) {
+                        out += ' ';
+                    }
+                }
+            } else {
+                for (std::size_t i = 0; i < len; ++i) {
+                    out += static_cast<char>(rng.next() >> 56U);
+                }
+            }
+        }
+    }
+
+    /// Return content of the specified size and compressibility.
+    inline std::string make_content(std::size_t size, double compressibility, random& rng) {
+        std::string content;
+        append_content(content, size, compressibility, rng);
+        return content;
+    }
+
+    /// Parameters for make_tiles().
+    struct tile_options {
+        std::size_t num_tiles = 1;
+        std::size_t layers_per_tile = 10;
+        std::size_t content_size = 1024;
+        double compressibility = 0.7;
+        tgd_header::layer_compression_type compression = tgd_header::layer_compression_type::zlib;
+        std::uint64_t seed = 1;
+    };
+
+    /**
+     * Generate tiles with layers according to the options and return them
+     * in a string in the format they are stored in a file. Tiles are taken
+     * in order from zoom level 14, layers are named "layer0", "layer1",
+     * and so on. Content sizes vary between half and one and a half times
+     * the configured size.
+     */
+    inline std::string make_tiles(const tile_options& options) {
+        random rng{options.seed};
+        std::string out;
+        tgd_header::string_sink sink{out};
+
+        const std::uint32_t dim = 1U << 14U;
+        for (std::size_t t = 0; t < options.num_tiles; ++t) {
+            const tgd_header::tile_address tile{14, static_cast<std::uint32_t>(t % dim), static_cast<std::uint32_t>(t / dim)};
+            for (std::size_t l = 0; l < options.layers_per_tile; ++l) {
+                const auto name = "layer" + std::to_string(l);
+                const auto size = options.content_size / 2 + rng.uniform(options.content_size + 1);
+                const auto content = make_content(size, options.compressibility, rng);
+
+                tgd_header::layer layer;
+                layer.set_name(name.c_str());
+                layer.set_tile(tile);
+                layer.set_content_type(tgd_header::layer_content_type::vt3);
+                layer.set_compression_type(options.compression);
+                layer.set_content(content.data(), content.size());
+                layer.write(sink);
+            }
+        }
+
+        return out;
+    }
+
+} // namespace synthetic
+
+#endif // TGD_HEADER_BENCHMARKS_SYNTHETIC_DATA_HPP
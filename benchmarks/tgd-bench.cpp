@@ -0,0 +1,391 @@
+/*****************************************************************************
+
+  tgd-bench
+
+  Microbenchmarks for the tgd_header library.
+
+  Measures header (de)serialization, zlib round-trips at several sizes, and
+  full scans of a file through the different sources. All data is generated
+  synthetically, so no input files are needed and results are comparable
+  between runs and machines. For the scan benchmarks a temporary file is
+  written into the current directory (or the one set with -d/--dir).
+
+  Each benchmark is run repeatedly until it took at least the minimum time
+  (set with -t/--time). Results are reported in MB/s and layers/s.
+
+  Examples:
+
+  tgd-bench
+
+  tgd-bench -f zlib
+
+  tgd-bench --quick -t 0.1
+
+*****************************************************************************/
+
+#include "synthetic_data.hpp"
+
+#include <tgd_header/buffer.hpp>
+#include <tgd_header/buffer_source.hpp>
+#include <tgd_header/buffered_file_source.hpp>
+#include <tgd_header/crc32c.hpp>
+#include <tgd_header/file_sink.hpp>
+#include <tgd_header/file_source.hpp>
+#include <tgd_header/layer.hpp>
+#include <tgd_header/layer_cache.hpp>
+#include <tgd_header/layer_view.hpp>
+#include <tgd_header/mmap_source.hpp>
+#include <tgd_header/reader.hpp>
+#include <tgd_header/scanner.hpp>
+#include <tgd_header/string_sink.hpp>
+#include <tgd_header/tile_key.hpp>
+#include <tgd_header/zlib_context.hpp>
+
+#include <clara.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+    // Results are added up here, so the compiler can't optimize the work
+    // away.
+    volatile std::size_t result_sink = 0;
+
+    class benchmark_runner {
+
+        std::string m_filter;
+        double m_min_time;
+
+    public:
+
+        benchmark_runner(std::string filter, double min_time) :
+            m_filter(std::move(filter)),
+            m_min_time(min_time) {
+            std::cout << std::left << std::setw(32) << "benchmark"
+                      << std::right << std::setw(10) << "iters"
+                      << std::setw(14) << "ms/iter"
+                      << std::setw(12) << "MB/s"
+                      << std::setw(14) << "layers/s" << '\n';
+        }
+
+        /**
+         * Run the benchmark function repeatedly until the minimum time is
+         * reached and print the results. Each call of the function works
+         * on the specified number of bytes and layers.
+         */
+        template <typename TFunc>
+        void run(const std::string& name, std::size_t bytes, std::size_t layers, TFunc&& func) {
+            if (name.find(m_filter) == std::string::npos) {
+                return;
+            }
+
+            func(); // warm up
+
+            using clock = std::chrono::steady_clock;
+            std::size_t iterations = 1;
+            double elapsed = 0.0;
+            while (true) {
+                const auto start = clock::now();
+                for (std::size_t i = 0; i < iterations; ++i) {
+                    func();
+                }
+                elapsed = std::chrono::duration<double>(clock::now() - start).count();
+                if (elapsed >= m_min_time) {
+                    break;
+                }
+                iterations *= 2;
+            }
+
+            const auto per_iteration = elapsed / static_cast<double>(iterations);
+            std::cout << std::left << std::setw(32) << name
+                      << std::right << std::setw(10) << iterations
+                      << std::fixed << std::setprecision(3)
+                      << std::setw(14) << per_iteration * 1000.0
+                      << std::setprecision(1)
+                      << std::setw(12) << static_cast<double>(bytes) / per_iteration / (1024.0 * 1024.0)
+                      << std::setprecision(0)
+                      << std::setw(14) << static_cast<double>(layers) / per_iteration << '\n';
+        }
+
+    }; // class benchmark_runner
+
+    void bench_headers(benchmark_runner& runner, std::size_t num_layers) {
+        synthetic::tile_options options;
+        options.num_tiles = num_layers;
+        options.layers_per_tile = 1;
+        options.content_size = 16;
+        options.compression = tgd_header::layer_compression_type::uncompressed;
+
+        const auto data = synthetic::make_tiles(options);
+
+        runner.run("header_write", data.size(), num_layers, [&]() {
+            std::string out;
+            out.reserve(data.size());
+            tgd_header::string_sink sink{out};
+            const char content[16] = {0};
+            for (std::size_t n = 0; n < num_layers; ++n) {
+                tgd_header::layer layer;
+                layer.set_name("layer0");
+                layer.set_tile(tgd_header::tile_address{14, static_cast<std::uint32_t>(n), 0});
+                layer.set_content(content, sizeof(content));
+                layer.write(sink);
+            }
+            result_sink += out.size();
+        });
+
+        runner.run("header_scan", data.size(), num_layers, [&]() {
+            tgd_header::buffer b{data.data(), data.size()};
+            tgd_header::buffer_source source{b};
+            tgd_header::reader<tgd_header::buffer_source> reader{source};
+            while (auto& layer = reader.next_layer()) {
+                result_sink += layer.name_length();
+            }
+        });
+    }
+
+    void bench_zlib(benchmark_runner& runner, const std::vector<std::size_t>& sizes) {
+        synthetic::random rng{42};
+        tgd_header::zlib_context context;
+
+        for (const auto size : sizes) {
+            const auto content = synthetic::make_content(size, 0.7, rng);
+            const auto suffix = size >= 1024 * 1024 ? std::to_string(size / (1024 * 1024)) + "M"
+                                                    : std::to_string(size / 1024) + "k";
+
+            runner.run("zlib_compress_" + suffix, size, 1, [&]() {
+                const auto compressed = context.compress(content.data(), content.size());
+                result_sink += compressed.size();
+            });
+
+            const auto compressed = context.compress(content.data(), content.size());
+            runner.run("zlib_uncompress_" + suffix, size, 1, [&]() {
+                const auto uncompressed = context.uncompress(compressed.data(), compressed.size(), content.size());
+                result_sink += uncompressed.size();
+            });
+
+            runner.run("zlib_layer_roundtrip_" + suffix, size, 1, [&]() {
+                std::string out;
+                tgd_header::string_sink sink{out};
+                tgd_header::layer layer;
+                layer.set_name("test");
+                layer.set_compression_type(tgd_header::layer_compression_type::zlib);
+                layer.set_content(content.data(), content.size());
+                layer.write(sink, context);
+
+                tgd_header::buffer b{out.data(), out.size()};
+                tgd_header::buffer_source source{b};
+                tgd_header::reader<tgd_header::buffer_source> reader{source};
+                auto& in = reader.next_layer();
+                reader.read_content();
+                in.decode_content(context);
+                result_sink += in.content().size();
+            });
+        }
+    }
+
+    void bench_crc32c(benchmark_runner& runner, std::size_t size) {
+        synthetic::random rng{42};
+        const auto data = synthetic::make_content(size, 0.0, rng);
+
+        runner.run("crc32c", size, 1, [&]() {
+            result_sink += tgd_header::crc32c(data.data(), data.size());
+        });
+    }
+
+    void bench_find_magic(benchmark_runner& runner, std::size_t size) {
+        synthetic::random rng{42};
+        const auto data = synthetic::make_content(size, 0.0, rng);
+
+        runner.run("find_magic", size, 1, [&]() {
+            result_sink += tgd_header::find_magic(data.data(), data.size(), 0);
+        });
+    }
+
+    void bench_tile_keys(benchmark_runner& runner, std::size_t num_tiles) {
+        synthetic::random rng{42};
+        std::vector<tgd_header::tile_address> tiles;
+        tiles.reserve(num_tiles);
+        for (std::size_t n = 0; n < num_tiles; ++n) {
+            tiles.emplace_back(14, static_cast<std::uint32_t>(rng.next() & 0x3fffU), static_cast<std::uint32_t>(rng.next() & 0x3fffU));
+        }
+
+        runner.run("morton_key", 0, num_tiles, [&]() {
+            for (const auto& tile : tiles) {
+                result_sink += tgd_header::morton_key(tile);
+            }
+        });
+
+        runner.run("hilbert_key", 0, num_tiles, [&]() {
+            for (const auto& tile : tiles) {
+                result_sink += tgd_header::hilbert_key(tile);
+            }
+        });
+
+        runner.run("hilbert_encode", 0, num_tiles, [&]() {
+            for (const auto& tile : tiles) {
+                result_sink += tgd_header::hilbert_encode(tile.zoom(), tile.x(), tile.y());
+            }
+        });
+    }
+
+    // Decoding the same layers again and again with and without the cache
+    void bench_layer_cache(benchmark_runner& runner, std::size_t num_layers) {
+        synthetic::random rng{42};
+        tgd_header::zlib_context context;
+
+        const auto content = synthetic::make_content(16 * 1024, 0.7, rng);
+        std::string data;
+        tgd_header::string_sink sink{data};
+        std::vector<std::uint64_t> offsets;
+        for (std::size_t n = 0; n < num_layers; ++n) {
+            tgd_header::layer layer;
+            layer.set_name("test");
+            layer.set_tile(tgd_header::tile_address{10, static_cast<std::uint32_t>(n), 0});
+            layer.set_compression_type(tgd_header::layer_compression_type::zlib);
+            layer.set_content(content.data(), content.size());
+            offsets.push_back(data.size());
+            layer.write(sink, context);
+        }
+
+        const tgd_header::buffer b{data.data(), data.size()};
+        const tgd_header::buffer_source source{b};
+        const auto size = num_layers * content.size();
+
+        runner.run("layer_decode", size, num_layers, [&]() {
+            for (const auto offset : offsets) {
+                auto layer = tgd_header::read_layer_at(source, offset, false);
+                layer.decode_content(context);
+                result_sink += layer.content().size();
+            }
+        });
+
+        tgd_header::layer_cache cache{2 * size};
+        runner.run("layer_cache_hit", size, num_layers, [&]() {
+            for (const auto offset : offsets) {
+                auto layer = tgd_header::read_layer_at(source, offset, false);
+                result_sink += cache.content(0, layer, context).size();
+            }
+        });
+    }
+
+    template <typename TSource>
+    void scan(TSource& source) {
+        tgd_header::reader<TSource> reader{source};
+        while (auto& layer = reader.next_layer()) {
+            reader.read_content();
+            result_sink += layer.wire_content().size();
+        }
+    }
+
+    void bench_scan(benchmark_runner& runner, const std::string& filename, std::size_t num_tiles) {
+        synthetic::tile_options options;
+        options.num_tiles = num_tiles;
+        const auto data = synthetic::make_tiles(options);
+        const auto num_layers = options.num_tiles * options.layers_per_tile;
+
+        {
+            tgd_header::file_sink sink{filename};
+            sink.write(tgd_header::buffer{data.data(), data.size()});
+            sink.close();
+        }
+
+        runner.run("scan_buffer_source", data.size(), num_layers, [&]() {
+            tgd_header::buffer b{data.data(), data.size()};
+            tgd_header::buffer_source source{b};
+            scan(source);
+        });
+
+        runner.run("scan_file_source", data.size(), num_layers, [&]() {
+            tgd_header::file_source source{filename};
+            scan(source);
+        });
+
+        runner.run("scan_buffered_file_source", data.size(), num_layers, [&]() {
+            tgd_header::buffered_file_source source{filename};
+            scan(source);
+        });
+
+        runner.run("scan_mmap_source", data.size(), num_layers, [&]() {
+            tgd_header::mmap_source source{filename};
+            scan(source);
+        });
+
+        runner.run("scan_mmap_layer_views", data.size(), num_layers, [&]() {
+            tgd_header::mmap_source source{filename};
+            for (const auto& view : tgd_header::layer_view_range{source.mapping()}) {
+                result_sink += view.wire_content().size();
+            }
+        });
+
+        std::remove(filename.c_str());
+    }
+
+} // anonymous namespace
+
+int main(int argc, char *argv[]) {
+    std::string filter;
+    std::string dir{"."};
+    double min_time = 0.5;
+    bool quick = false;
+    bool help = false;
+
+    const auto cli
+        = clara::Opt(filter, "text")
+            ["-f"]["--filter"]
+            ("only run benchmarks with names containing this text")
+        | clara::Opt(min_time, "seconds")
+            ["-t"]["--time"]
+            ("minimum run time per benchmark (default: 0.5)")
+        | clara::Opt(dir, "dir")
+            ["-d"]["--dir"]
+            ("directory for temporary files (default: current directory)")
+        | clara::Opt(quick)
+            ["-q"]["--quick"]
+            ("use less data for a quick check")
+        | clara::Help(help);
+
+    const auto result = cli.parse(clara::Args(argc, argv));
+    if (!result) {
+        std::cerr << "Error in command line: " << result.errorMessage() << '\n';
+        return 2;
+    }
+
+    if (help) {
+        std::cout << "Run benchmarks.\n\n";
+        std::cout << cli;
+        return 0;
+    }
+
+    if (min_time < 0.0) {
+        std::cerr << "Invalid value for -t/--time option.\n";
+        return 2;
+    }
+
+    benchmark_runner runner{filter, min_time};
+
+    bench_headers(runner, quick ? 1000 : 100000);
+
+    if (quick) {
+        bench_zlib(runner, {1024, 16 * 1024});
+    } else {
+        bench_zlib(runner, {1024, 16 * 1024, 256 * 1024, 4 * 1024 * 1024});
+    }
+
+    bench_crc32c(runner, quick ? 64 * 1024 : 4 * 1024 * 1024);
+
+    bench_find_magic(runner, quick ? 64 * 1024 : 4 * 1024 * 1024);
+
+    bench_tile_keys(runner, quick ? 1000 : 100000);
+
+    bench_layer_cache(runner, quick ? 10 : 1000);
+
+    bench_scan(runner, dir + "/tgd-bench-scan.tgd", quick ? 100 : 10000);
+
+    return 0;
+}
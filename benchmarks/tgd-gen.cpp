@@ -0,0 +1,336 @@
+/*****************************************************************************
+
+  tgd-gen
+
+  Generate a tile file with synthetic data for load and scale testing.
+
+  Tiles are generated zoom level by zoom level from the minimum to the
+  maximum zoom level. Each zoom level is enumerated row by row, starting
+  at the tile given with --start (default 0/0) at the minimum zoom level,
+  or the corresponding tile on higher zoom levels, up to the end of the
+  zoom level. Generation stops when the maximum number of tiles (-n) is
+  reached.
+
+  Each tile gets a random number of layers in the range given with
+  -l/--layers. Layer names are taken from a set of names ("layer0",
+  "layer1", ...) with a Zipf distribution, so some names are much more
+  common than others, like in real data. Use --zipf 0 for a uniform
+  distribution. Layer names within a tile are always different, so the
+  number of layers per tile can't be larger than the number of names.
+
+  The content profile (-p/--profile) sets the content type, compression,
+  and how compressible the content is:
+
+  vector - vector tile data (vt3), zlib compressed, compressibility 0.7
+  text   - unknown content type, zlib compressed, compressibility 0.95
+  raster - png, uncompressed, not compressible
+  random - unknown content type, zlib compressed, not compressible
+  mixed  - one of the above chosen randomly for each layer
+
+  The data is written out while it is generated, so files can be much
+  larger than the available memory. The output only depends on the
+  options including the seed, so it is the same on every run.
+
+  Examples:
+
+  tgd-gen -o out.tgd
+
+  tgd-gen -z 10-14 -n 100000 -l 5-20 -s 100-10000 -o large.tgd
+
+  tgd-gen -p raster -z 0-8 -n 0 -l 1 -s 20000-40000 -o raster.tgd
+
+*****************************************************************************/
+
+#include "synthetic_data.hpp"
+
+#include <tgd_header/file_sink.hpp>
+#include <tgd_header/layer.hpp>
+#include <tgd_header/tile.hpp>
+#include <tgd_header/types.hpp>
+#include <tgd_header/zlib_context.hpp>
+
+#include <clara.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct content_profile {
+    tgd_header::layer_content_type content_type;
+    tgd_header::layer_compression_type compression;
+    double compressibility;
+};
+
+static const content_profile profile_vector{tgd_header::layer_content_type::vt3, tgd_header::layer_compression_type::zlib, 0.7};
+static const content_profile profile_text{tgd_header::layer_content_type::unknown, tgd_header::layer_compression_type::zlib, 0.95};
+static const content_profile profile_raster{tgd_header::layer_content_type::png, tgd_header::layer_compression_type::uncompressed, 0.0};
+static const content_profile profile_random{tgd_header::layer_content_type::unknown, tgd_header::layer_compression_type::zlib, 0.0};
+
+/**
+ * Parse a range "MIN-MAX" or a single number "N" (which is the same as
+ * "N-N"). Returns false if this is not a valid range.
+ */
+static bool parse_range(const std::string& str, std::uint64_t* min, std::uint64_t* max) {
+    if (str.empty() || str[0] < '0' || str[0] > '9') {
+        return false;
+    }
+
+    char* end = nullptr;
+    *min = std::strtoull(str.c_str(), &end, 10);
+    if (*end == '\0') {
+        *max = *min;
+        return true;
+    }
+
+    if (*end != '-' || end[1] < '0' || end[1] > '9') {
+        return false;
+    }
+
+    *max = std::strtoull(end + 1, &end, 10);
+    return *end == '\0' && *min <= *max;
+}
+
+/**
+ * Parse a tile "X/Y". Returns false if this is not a valid tile.
+ */
+static bool parse_tile(const std::string& str, std::uint64_t* x, std::uint64_t* y) {
+    if (str.empty() || str[0] < '0' || str[0] > '9') {
+        return false;
+    }
+
+    char* end = nullptr;
+    *x = std::strtoull(str.c_str(), &end, 10);
+    if (*end != '/' || end[1] < '0' || end[1] > '9') {
+        return false;
+    }
+
+    *y = std::strtoull(end + 1, &end, 10);
+    return *end == '\0';
+}
+
+static std::uint64_t in_range(synthetic::random& rng, std::uint64_t min, std::uint64_t max) {
+    return min + rng.uniform(max - min + 1);
+}
+
+int main(int argc, char *argv[]) {
+    std::string output_file_name;
+    std::string zoom_range{"14"};
+    std::string start_tile{"0/0"};
+    std::string layers_range{"10"};
+    std::string size_range{"1024"};
+    std::string profile_name{"vector"};
+    std::uint64_t max_tiles = 1000;
+    std::size_t num_names = 20;
+    double zipf = 1.0;
+    double compressibility = -1.0;
+    int level = -1;
+    std::uint64_t seed = 1;
+    bool help = false;
+    bool verbose = false;
+
+    const auto cli
+        = clara::Opt(output_file_name, "file")
+            ["-o"]["--output"]
+            ("output file")
+        | clara::Opt(zoom_range, "MIN[-MAX]")
+            ["-z"]["--zoom"]
+            ("zoom levels of the tile pyramid (default: 14)")
+        | clara::Opt(start_tile, "X/Y")
+            ["--start"]
+            ("first tile on minimum zoom level (default: 0/0)")
+        | clara::Opt(max_tiles, "N")
+            ["-n"]["--tiles"]
+            ("maximum number of tiles, 0 for all zoom levels (default: 1000)")
+        | clara::Opt(layers_range, "MIN[-MAX]")
+            ["-l"]["--layers"]
+            ("number of layers per tile (default: 10)")
+        | clara::Opt(num_names, "N")
+            ["--names"]
+            ("number of different layer names (default: 20)")
+        | clara::Opt(zipf, "S")
+            ["--zipf"]
+            ("exponent of Zipf distribution of names, 0 for uniform (default: 1.0)")
+        | clara::Opt(size_range, "MIN[-MAX]")
+            ["-s"]["--size"]
+            ("content size in bytes (default: 1024)")
+        | clara::Opt(profile_name, "profile")
+            ["-p"]["--profile"]
+            ("content profile: vector, text, raster, random, mixed (default: vector)")
+        | clara::Opt(compressibility, "X")
+            ["-c"]["--compressibility"]
+            ("override compressibility of profile (0.0 to 1.0)")
+        | clara::Opt(level, "level")
+            ["-L"]["--level"]
+            ("zlib compression level (0-9, default: zlib default)")
+        | clara::Opt(seed, "seed")
+            ["--seed"]
+            ("seed for random number generator (default: 1)")
+        | clara::Opt(verbose)
+            ["-v"]["--verbose"]
+            ("verbose output")
+        | clara::Help(help);
+
+    const auto result = cli.parse(clara::Args(argc, argv));
+    if (!result) {
+        std::cerr << "Error in command line: " << result.errorMessage() << '\n';
+        return 2;
+    }
+
+    if (help) {
+        std::cout << "Generate tile file with synthetic data.\n\n";
+        std::cout << cli;
+        return 0;
+    }
+
+    if (output_file_name.empty()) {
+        std::cerr << "Missing -o/--output option. Try 'tgd-gen -h'.\n";
+        return 2;
+    }
+
+    std::uint64_t min_zoom = 0;
+    std::uint64_t max_zoom = 0;
+    if (!parse_range(zoom_range, &min_zoom, &max_zoom) || max_zoom > 30) {
+        std::cerr << "Invalid value for -z/--zoom option.\n";
+        return 2;
+    }
+
+    std::uint64_t start_x = 0;
+    std::uint64_t start_y = 0;
+    if (!parse_tile(start_tile, &start_x, &start_y) ||
+        start_x >= (1ULL << min_zoom) || start_y >= (1ULL << min_zoom)) {
+        std::cerr << "Invalid value for --start option.\n";
+        return 2;
+    }
+
+    std::uint64_t min_layers = 0;
+    std::uint64_t max_layers = 0;
+    if (!parse_range(layers_range, &min_layers, &max_layers)) {
+        std::cerr << "Invalid value for -l/--layers option.\n";
+        return 2;
+    }
+
+    std::uint64_t min_size = 0;
+    std::uint64_t max_size = 0;
+    if (!parse_range(size_range, &min_size, &max_size) || max_size > 0xffffffffULL) {
+        std::cerr << "Invalid value for -s/--size option.\n";
+        return 2;
+    }
+
+    if (num_names == 0) {
+        std::cerr << "Invalid value for --names option.\n";
+        return 2;
+    }
+
+    if (max_layers > num_names) {
+        std::cerr << "Number of layers per tile (-l/--layers) can't be larger than number of names (--names).\n";
+        return 2;
+    }
+
+    if (zipf < 0.0) {
+        std::cerr << "Invalid value for --zipf option.\n";
+        return 2;
+    }
+
+    if (compressibility > 1.0) {
+        std::cerr << "Invalid value for -c/--compressibility option.\n";
+        return 2;
+    }
+
+    if (level < -1 || level > 9) {
+        std::cerr << "Invalid value for -L/--level option.\n";
+        return 2;
+    }
+
+    std::vector<content_profile> profiles;
+    if (profile_name == "vector") {
+        profiles.push_back(profile_vector);
+    } else if (profile_name == "text") {
+        profiles.push_back(profile_text);
+    } else if (profile_name == "raster") {
+        profiles.push_back(profile_raster);
+    } else if (profile_name == "random") {
+        profiles.push_back(profile_random);
+    } else if (profile_name == "mixed") {
+        profiles = {profile_vector, profile_text, profile_raster, profile_random};
+    } else {
+        std::cerr << "Invalid value for -p/--profile option.\n";
+        return 2;
+    }
+
+    if (compressibility >= 0.0) {
+        for (auto& profile : profiles) {
+            profile.compressibility = compressibility;
+        }
+    }
+
+    std::vector<std::string> names;
+    for (std::size_t n = 0; n < num_names; ++n) {
+        names.push_back("layer" + std::to_string(n));
+    }
+
+    synthetic::random rng{seed};
+    const synthetic::zipf_distribution name_distribution{num_names, zipf};
+
+    tgd_header::zlib_options options;
+    options.level = level;
+    tgd_header::zlib_context context{options};
+
+    tgd_header::file_sink sink{output_file_name, 1024UL * 1024UL};
+
+    std::uint64_t num_tiles = 0;
+    std::uint64_t num_layers = 0;
+    std::uint64_t num_bytes = 0;
+    std::string content;
+    std::vector<std::size_t> tile_names;
+
+    const auto done = [&]() {
+        return max_tiles > 0 && num_tiles == max_tiles;
+    };
+
+    for (auto zoom = min_zoom; zoom <= max_zoom && !done(); ++zoom) {
+        const std::uint64_t dim = 1ULL << zoom;
+        const auto shift = zoom - min_zoom;
+        for (std::uint64_t y = start_y << shift; y < dim && !done(); ++y) {
+            for (std::uint64_t x = start_x << shift; x < dim && !done(); ++x) {
+                const tgd_header::tile_address tile{static_cast<std::uint8_t>(zoom),
+                                                    static_cast<std::uint32_t>(x),
+                                                    static_cast<std::uint32_t>(y)};
+
+                const auto layers = in_range(rng, min_layers, max_layers);
+                name_distribution.sample(rng, layers, tile_names);
+                for (const auto name : tile_names) {
+                    const auto& profile = profiles[rng.uniform(profiles.size())];
+
+                    content.clear();
+                    synthetic::append_content(content, in_range(rng, min_size, max_size), profile.compressibility, rng);
+
+                    tgd_header::layer layer;
+                    layer.set_name(names[name].c_str());
+                    layer.set_tile(tile);
+                    layer.set_content_type(profile.content_type);
+                    layer.set_compression_type(profile.compression);
+                    layer.set_content(content.data(), content.size());
+                    num_bytes += layer.write(sink, context);
+                }
+                num_layers += layers;
+                ++num_tiles;
+
+                if (verbose && num_tiles % 10000 == 0) {
+                    std::cerr << "Generated " << num_tiles << " tiles (" << num_bytes / (1024 * 1024) << " MB)\n";
+                }
+            }
+        }
+    }
+
+    sink.close();
+
+    if (verbose) {
+        std::cerr << "Generated " << num_tiles << " tiles with "
+                  << num_layers << " layers (" << num_bytes << " bytes)\n";
+    }
+
+    return 0;
+}
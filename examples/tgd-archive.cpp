@@ -0,0 +1,129 @@
+/*****************************************************************************
+
+  tgd-archive
+
+  Create an archive from many tile files.
+
+  Reads all layers from the input files and writes them into the output
+  file ordered by zoom level and then along a Hilbert curve, so that tiles
+  close to each other on the map are close to each other in the file. All
+  layers of a tile are stored together. The layer records are copied
+  unchanged, references to deduplicated content are resolved.
+
+  An index (see tgd-index) is written as directory of the archive. If no
+  index file is specified, it is written into a file with the same name as
+  the output file and an additional suffix ".idx".
+
+  While the archive is created, a staging file with the name of the output
+  file and the suffix ".tmp" is used.
+
+  Examples:
+
+  tgd-archive 0-0-0.tgd 1-0-0.tgd 1-0-1.tgd -o archive.tgd
+
+  tgd-archive 0-0-0.tgd 1-0-0.tgd 1-0-1.tgd -o archive.tgd -i archive.idx
+
+*****************************************************************************/
+
+#include <tgd_header/archive_writer.hpp>
+#include <tgd_header/file_sink.hpp>
+#include <tgd_header/layer_view.hpp>
+#include <tgd_header/mmap_source.hpp>
+#include <tgd_header/pread_source.hpp>
+
+#include <clara.hpp>
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char *argv[]) {
+    std::vector<std::string> input_files;
+    std::string output_file_name;
+    std::string index_file_name;
+    bool help = false;
+    bool verbose = false;
+
+    const auto cli
+        = clara::Opt(output_file_name, "file")
+            ["-o"]["--output"]
+            ("output file")
+        | clara::Opt(index_file_name, "file")
+            ["-i"]["--index"]
+            ("index file (default: output file name + '.idx')")
+        | clara::Opt(verbose)
+            ["-v"]["--verbose"]
+            ("verbose output")
+        | clara::Help(help)
+        | clara::Arg(input_files, "FILE")
+            ("data");
+
+    const auto result = cli.parse(clara::Args(argc, argv));
+    if (!result) {
+        std::cerr << "Error in command line: " << result.errorMessage() << '\n';
+        return 2;
+    }
+
+    if (help) {
+        std::cout << "Create archive from tile files.\n\n";
+        std::cout << cli;
+        return 0;
+    }
+
+    if (input_files.empty()) {
+        std::cerr << "Missing input file(s). Try 'tgd-archive -h'.\n";
+        return 2;
+    }
+
+    if (output_file_name.empty()) {
+        std::cerr << "Missing -o/--output option. Try 'tgd-archive -h'.\n";
+        return 2;
+    }
+
+    if (index_file_name.empty()) {
+        index_file_name = output_file_name + ".idx";
+    }
+
+    try {
+        tgd_header::archive_writer writer{output_file_name};
+
+        for (const auto& filename : input_files) {
+            // An empty file has no layers, but can't be memory mapped.
+            if (tgd_header::pread_source{filename}.file_size() == 0) {
+                continue;
+            }
+
+            tgd_header::mmap_options options;
+            options.access = tgd_header::mmap_access::sequential;
+            const tgd_header::mmap_source source{filename, options};
+            const tgd_header::layer_view_range range{source.mapping()};
+            for (const auto& view : range) {
+                if (view.is_reference()) {
+                    auto layer = range.to_layer(view);
+                    writer.add(layer);
+                } else {
+                    writer.add(view);
+                }
+            }
+        }
+
+        const auto num_layers = writer.size();
+
+        tgd_header::file_sink index{index_file_name};
+        const std::uint64_t size = writer.close(index);
+        index.close();
+
+        if (verbose) {
+            std::cerr << "Wrote archive with " << num_layers << " layers (" << size
+                      << " bytes) to '" << output_file_name << "' and its index to '"
+                      << index_file_name << "'\n";
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << '\n';
+        return 2;
+    }
+
+    return 0;
+}
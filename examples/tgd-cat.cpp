@@ -9,6 +9,22 @@
   are copied to the output. Files with .png or .jpg suffix are written
   uncompressed, .mvt files are written compressed, all other files are
   written uncompressed unless the -c/--compression option was specified.
+  Use -l/--level to set the zlib compression level from 0 (no compression,
+  the data is only stored in zlib format) over 1 (fastest) to 9 (best
+  compression). With -a/--adaptive, layers are written uncompressed
+  if compression doesn't make them smaller.
+
+  Use -j/--jobs to read and compress the input files on several threads.
+  The layers are always written in the order of the input files.
+
+  With -C/--checksum a CRC-32C checksum is stored with each new layer, use
+  tgd-verify to check it. Layers from .tgd input files are copied as they
+  are.
+
+  With -D/--dedup layers with the same content as a layer written before
+  are written as references to that content, so it is only stored once.
+  References in .tgd input files are always replaced by the content they
+  point to, because offsets in the output file are different.
 
   Examples:
 
@@ -16,18 +32,33 @@
 
   tgd-cat streets.tgd buildings.tgd shops.tgd -o tile.tgd
 
+  tgd-cat -l 9 roads.mvt water.mvt -o tile.tgd
+
+  tgd-cat -j 8 *.mvt -o tile.tgd
+
+  tgd-cat -D ocean.tgd land.tgd ocean-again.tgd -o all.tgd
+
 *****************************************************************************/
 
+#include <tgd_header/dedup_writer.hpp>
 #include <tgd_header/file_sink.hpp>
 #include <tgd_header/file_source.hpp>
 #include <tgd_header/layer.hpp>
+#include <tgd_header/layer_view.hpp>
 #include <tgd_header/string_sink.hpp>
+#include <tgd_header/zlib_context.hpp>
 
 #include <clara.hpp>
 
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
 #include <iostream>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 /**
@@ -61,16 +92,32 @@ static tgd_header::buffer read_file(const std::string& filename) {
     return source.read(source.file_size());
 }
 
-static void write_layer(const std::string& filename, tgd_header::file_sink& output_file, const tgd_header::tile_address& tile, tgd_header::layer_compression_type compression) {
-    tgd_header::layer layer;
+/**
+ * An input file ready to be written out: Either the raw contents of a .tgd
+ * file or a layer with encoded content.
+ */
+struct prepared_input {
+    tgd_header::buffer raw{};
+    tgd_header::layer layer{};
+    bool is_raw = false;
+};
+
+/**
+ * Read the input file and encode it as a layer.
+ */
+static prepared_input prepare_input(const std::string& filename, tgd_header::zlib_context& context, const tgd_header::tile_address& tile, tgd_header::layer_compression_type compression) {
+    prepared_input input;
 
     const auto f = split_filename(filename);
 
     if (f.second == "tgd") {
-        output_file.write(read_file(filename));
-        return;
+        input.raw = read_file(filename);
+        input.is_raw = true;
+        return input;
     }
 
+    auto& layer = input.layer;
+
     if (f.second == "png") {
         layer.set_content_type(tgd_header::layer_content_type::png);
     } else if (f.second == "jpg") {
@@ -83,23 +130,179 @@ static void write_layer(const std::string& filename, tgd_header::file_sink& outp
     }
 
     const auto layer_name = basename(f.first);
-    layer.set_name(tgd_header::buffer{layer_name.data(), layer_name.size() + 1});
+    layer.set_name(tgd_header::buffer{layer_name.data(), layer_name.size() + 1}.copy());
 
     layer.set_tile(tile);
 
     layer.set_content(read_file(filename));
 
-    layer.write(output_file);
+    layer.encode_content(context);
+
+    return input;
+}
+
+using dedup_writer_type = tgd_header::dedup_writer<tgd_header::file_sink>;
+
+static bool has_references(const tgd_header::buffer& data) {
+    for (const auto& view : tgd_header::layer_view_range{data}) {
+        if (view.is_reference()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void write_layer(tgd_header::layer& layer, tgd_header::file_sink& output_file, dedup_writer_type* dedup) {
+    if (dedup) {
+        dedup->write(layer);
+    } else {
+        layer.write(output_file);
+    }
+}
+
+/**
+ * Write out the input. Layers from .tgd files are only written one by one
+ * if they have to be deduplicated or contain references.
+ */
+static void write_input(prepared_input& input, tgd_header::file_sink& output_file, bool checksum, dedup_writer_type* dedup) {
+    if (!input.is_raw) {
+        input.layer.enable_checksum(checksum);
+        write_layer(input.layer, output_file, dedup);
+        return;
+    }
+
+    if (!dedup && !has_references(input.raw)) {
+        output_file.write(input.raw);
+        return;
+    }
+
+    const tgd_header::layer_view_range range{input.raw};
+    for (const auto& view : range) {
+        auto layer = range.to_layer(view);
+        write_layer(layer, output_file, dedup);
+    }
 }
 
+/**
+ * Reads and encodes input files on a pool of worker threads. The results
+ * are handed out in the order of the input files. Workers never get more
+ * than a few files ahead of the writer to limit memory use.
+ */
+class parallel_preparer {
+
+    struct slot {
+        prepared_input input{};
+        std::exception_ptr error{};
+        bool done = false;
+    };
+
+    const std::vector<std::string>& m_input_files;
+    std::vector<slot> m_slots;
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+
+    // Index of the next input file to be taken by a worker.
+    std::size_t m_next = 0;
+
+    // Number of results taken by the writer.
+    std::size_t m_taken = 0;
+
+    std::size_t m_max_ahead;
+    bool m_stop = false;
+
+    void work(tgd_header::zlib_options options, tgd_header::tile_address tile, tgd_header::layer_compression_type compression) {
+        tgd_header::zlib_context context{options};
+
+        while (true) {
+            std::size_t n = 0;
+            {
+                std::unique_lock<std::mutex> lock{m_mutex};
+                m_cv.wait(lock, [&] {
+                    return m_stop || m_next == m_input_files.size() || m_next < m_taken + m_max_ahead;
+                });
+                if (m_stop || m_next == m_input_files.size()) {
+                    return;
+                }
+                n = m_next++;
+            }
+
+            auto& slot = m_slots[n];
+            try {
+                slot.input = prepare_input(m_input_files[n], context, tile, compression);
+            } catch (...) {
+                slot.error = std::current_exception();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock{m_mutex};
+                slot.done = true;
+            }
+            m_cv.notify_all();
+        }
+    }
+
+public:
+
+    parallel_preparer(const std::vector<std::string>& input_files, unsigned int num_threads, const tgd_header::zlib_options& options, const tgd_header::tile_address& tile, tgd_header::layer_compression_type compression) :
+        m_input_files(input_files),
+        m_slots(input_files.size()),
+        m_max_ahead(num_threads * 2) {
+        for (unsigned int i = 0; i < num_threads; ++i) {
+            m_threads.emplace_back(&parallel_preparer::work, this, options, tile, compression);
+        }
+    }
+
+    parallel_preparer(const parallel_preparer&) = delete;
+    parallel_preparer& operator=(const parallel_preparer&) = delete;
+
+    ~parallel_preparer() {
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        for (auto& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    /**
+     * Wait for the nth input file to be ready and return it. Must be
+     * called for n = 0, 1, 2, ... in order.
+     */
+    prepared_input get(std::size_t n) {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        m_cv.wait(lock, [&] {
+            return m_slots[n].done;
+        });
+
+        auto& slot = m_slots[n];
+        ++m_taken;
+        m_cv.notify_all();
+
+        if (slot.error) {
+            std::rethrow_exception(slot.error);
+        }
+
+        return std::move(slot.input);
+    }
+
+}; // class parallel_preparer
+
 int main(int argc, char *argv[]) {
     std::vector<std::string> input_files;
     std::string output_file_name;
     uint32_t x = 0;
     uint32_t y = 0;
     unsigned int zoom = 0;
+    int level = Z_DEFAULT_COMPRESSION;
+    unsigned int threads = 1;
     bool help = false;
     bool want_compression = false;
+    bool adaptive = false;
+    bool checksum = false;
+    bool dedup = false;
     bool verbose = false;
 
     const auto cli
@@ -115,6 +318,21 @@ int main(int argc, char *argv[]) {
         | clara::Opt(want_compression)
             ["-c"]["--compression"]
             ("enable compression")
+        | clara::Opt(adaptive)
+            ["-a"]["--adaptive"]
+            ("only compress if it makes layers smaller")
+        | clara::Opt(level, "level")
+            ["-l"]["--level"]
+            ("set compression level (0-9)")
+        | clara::Opt(checksum)
+            ["-C"]["--checksum"]
+            ("store checksum with each layer")
+        | clara::Opt(dedup)
+            ["-D"]["--dedup"]
+            ("store identical layer content only once")
+        | clara::Opt(threads, "threads")
+            ["-j"]["--jobs"]
+            ("number of threads reading and compressing input files (default: 1)")
         | clara::Opt(verbose)
             ["-v"]["--verbose"]
             ("enable verbose output")
@@ -142,19 +360,55 @@ int main(int argc, char *argv[]) {
         return 2;
     }
 
+    if (level != Z_DEFAULT_COMPRESSION && (level < 0 || level > 9)) {
+        std::cerr << "Invalid value for -l/--level option.\n";
+        return 2;
+    }
+
+    if (threads == 0) {
+        std::cerr << "Invalid value for -j/--jobs option.\n";
+        return 2;
+    }
+
     tgd_header::layer_compression_type compression =
         want_compression ? tgd_header::layer_compression_type::zlib
                          : tgd_header::layer_compression_type::uncompressed;
 
     tgd_header::tile_address tile{static_cast<uint8_t>(zoom), x, y};
 
-    tgd_header::file_sink sink{output_file_name};
-
-    for (const auto& filename : input_files) {
-        if (verbose) {
-            std::cerr << "Reading " << filename << '\n';
+    // Collect small layers and write them out together
+    tgd_header::file_sink sink{output_file_name, 64UL * 1024UL};
+    tgd_header::zlib_options options;
+    options.level = level;
+    options.adaptive = adaptive;
+
+    dedup_writer_type dedup_writer{sink};
+    dedup_writer_type* dedup_ptr = dedup ? &dedup_writer : nullptr;
+
+    if (threads > 1) {
+        parallel_preparer preparer{input_files, threads, options, tile, compression};
+        for (std::size_t n = 0; n < input_files.size(); ++n) {
+            if (verbose) {
+                std::cerr << "Reading " << input_files[n] << '\n';
+            }
+            auto input = preparer.get(n);
+            write_input(input, sink, checksum, dedup_ptr);
+        }
+    } else {
+        tgd_header::zlib_context context{options};
+        for (const auto& filename : input_files) {
+            if (verbose) {
+                std::cerr << "Reading " << filename << '\n';
+            }
+            auto input = prepare_input(filename, context, tile, compression);
+            write_input(input, sink, checksum, dedup_ptr);
         }
-        write_layer(filename, sink, tile, compression);
     }
-}
 
+    sink.close();
+
+    if (verbose && dedup) {
+        std::cerr << "Wrote " << dedup_writer.references() << " of " << dedup_writer.layers()
+                  << " layers as references saving " << dedup_writer.bytes_saved() << " bytes\n";
+    }
+}
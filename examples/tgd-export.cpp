@@ -8,22 +8,35 @@
   Reads from the specified input file and writes to stdout. If the layer
   doesn't exist, nothing is written.
 
+  Without an index the input file is read from the beginning until the
+  layer is found. If an index for the input file (see tgd-index and
+  tgd-archive) is specified with -i/--index, the layer with the name given
+  with -l/--layer in the tile given with -z/--zoom, -x, and -y (default
+  0/0/0) is looked up in the index and only that layer is read.
+
   Examples:
 
   tgd-export input.tgd buildings -o buildings.layer
 
   tgd-export input.tgd -o first.layer
 
+  tgd-export -i archive.tgd.idx -z 14 -x 8800 -y 5373 -l roads archive.tgd -o roads.layer
+
 *****************************************************************************/
 
 #include <tgd_header/buffer.hpp>
 #include <tgd_header/file_sink.hpp>
 #include <tgd_header/file_source.hpp>
+#include <tgd_header/index.hpp>
 #include <tgd_header/layer.hpp>
+#include <tgd_header/mmap_source.hpp>
+#include <tgd_header/pread_source.hpp>
 #include <tgd_header/reader.hpp>
+#include <tgd_header/tile.hpp>
 
 #include <clara.hpp>
 
+#include <cstdint>
 #include <iostream>
 #include <string>
 
@@ -31,12 +44,28 @@ int main(int argc, char *argv[]) {
     std::string input_file_name;
     std::string output_file_name;
     std::string layer_name;
+    std::string index_file_name;
+    uint32_t x = 0;
+    uint32_t y = 0;
+    unsigned int zoom = 0;
     bool help = false;
 
     const auto cli
         = clara::Opt(layer_name, "layer name")
             ["-l"]["--layer"]
             ("layer to export (default: first layer)")
+        | clara::Opt(index_file_name, "file")
+            ["-i"]["--index"]
+            ("use this index of the input file to find the layer")
+        | clara::Opt(zoom, "zoom")
+            ["-z"]["--zoom"]
+            ("zoom of the tile to look up in the index")
+        | clara::Opt(x, "x")
+            ["-x"]
+            ("x of the tile to look up in the index")
+        | clara::Opt(y, "y")
+            ["-y"]
+            ("y of the tile to look up in the index")
         | clara::Opt(output_file_name, "file")
             ["-o"]["--output"]
             ("output file (default: stdout)")
@@ -66,15 +95,34 @@ int main(int argc, char *argv[]) {
         return 2;
     }
 
+    if (!index_file_name.empty()) {
+        if (layer_name.empty()) {
+            std::cerr << "The -i/--index option needs the -l/--layer option. Try 'tgd-export -h'.\n";
+            return 2;
+        }
+
+        const tgd_header::mmap_source index_source{index_file_name};
+        const auto index_data = index_source.mapping();
+        const tgd_header::layer_index index{tgd_header::buffer{index_data.data(), index_data.size()}};
+
+        const tgd_header::tile_address tile{static_cast<uint8_t>(zoom), x, y};
+        const auto entry = index.find(tile, layer_name);
+        if (entry) {
+            tgd_header::pread_source source{input_file_name};
+            auto layer = tgd_header::read_layer_at(source, entry.offset());
+            tgd_header::file_sink out{output_file_name};
+            out.write(layer.load_content());
+        }
+        return 0;
+    }
+
     tgd_header::file_source source{input_file_name};
     tgd_header::reader<decltype(source)> reader{source};
 
     while (auto& layer = reader.next_layer()) {
         if (layer_name.empty() || layer.has_name(layer_name)) {
-            reader.read_content();
-            layer.decode_content();
             tgd_header::file_sink out{output_file_name};
-            out.write(layer.content());
+            out.write(layer.load_content());
             return 0;
         }
     }
@@ -2,12 +2,22 @@
 
   tgd-filter
 
-  Filter tile files by name and/or content type.
+  Filter tile files by name, content type, zoom level, and/or area.
 
   Reads from the input file and writes all matching layers to the output file
   (or stdout if no output file was specified). Layers must fulfill all
   requirements to match.
 
+  If an index for the input file (see tgd-index and tgd-archive) is
+  specified with -i/--index, only the layers with matching tiles are read
+  from the input file, everything else is skipped. Otherwise the whole file
+  is read.
+
+  Matching layers are copied unchanged without decoding them. Runs of
+  consecutive matching layers are copied in one go inside the kernel where
+  possible (using copy_file_range() or sendfile() on Linux). References to
+  deduplicated content (see tgd-cat -D) are replaced by the content.
+
   Examples:
 
   tgd-filter input.tgd -o output.tgd -n roads # all layers named "roads"
@@ -17,44 +27,66 @@
   tgd-filter input.tgd -o output.tgd -z 12 -n water # all layers with zoom
                                                     # level 12 and name "water"
 
+  tgd-filter planet.tgd -i planet.tgd.idx -o berlin.tgd \
+             --bbox 13.08,52.33,13.77,52.68 --zoom-range 10-14
+
+  Use the form --bbox=... if the bounding box starts with a negative number.
+
 *****************************************************************************/
 
 #include <tgd_header/file_sink.hpp>
-#include <tgd_header/file_source.hpp>
+#include <tgd_header/buffered_file_source.hpp>
+#include <tgd_header/index.hpp>
 #include <tgd_header/layer.hpp>
+#include <tgd_header/mmap_source.hpp>
+#include <tgd_header/pread_source.hpp>
 #include <tgd_header/reader.hpp>
 #include <tgd_header/stream.hpp>
+#include <tgd_header/tile_range.hpp>
 
 #include <clara.hpp>
 
+#include <algorithm>
 #include <cstdint>
+#include <cstdio>
+#include <exception>
 #include <iostream>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
-static constexpr const std::uint8_t any_zoom = 255;
+static constexpr const int max_zoom = 30;
 
 class matcher {
 
     std::string m_name;
     tgd_header::layer_content_type m_type;
-    std::uint8_t m_zoom;
+    std::uint8_t m_min_zoom;
+    std::uint8_t m_max_zoom;
+    bool m_check_bbox;
+    std::vector<tgd_header::tile_range> m_ranges;
 
 public:
 
-    matcher(std::string name, tgd_header::layer_content_type type, std::uint8_t zoom) :
+    matcher(std::string name, tgd_header::layer_content_type type, std::uint8_t min_zoom_, std::uint8_t max_zoom_, const tgd_header::geo_bbox* bbox) :
         m_name(std::move(name)),
         m_type(type),
-        m_zoom(zoom) {
-    }
-
-    bool operator()(const tgd_header::layer& layer) noexcept {
-        if (m_name.empty() && m_type == tgd_header::layer_content_type::unknown && m_zoom == any_zoom) {
-            return true;
+        m_min_zoom(min_zoom_),
+        m_max_zoom(max_zoom_),
+        m_check_bbox(bbox != nullptr) {
+        if (bbox) {
+            // one range for every zoom level up to m_max_zoom, tiles on
+            // higher zoom levels never get to the bbox check
+            m_ranges.reserve(m_max_zoom + 1U);
+            for (unsigned int zoom = 0; zoom <= m_max_zoom; ++zoom) {
+                m_ranges.emplace_back(static_cast<std::uint8_t>(zoom), *bbox);
+            }
         }
+    }
 
-        if (m_zoom != any_zoom && m_zoom != layer.tile().zoom()) {
-            return false;
-        }
+    /// Check only the name and content type (used with an index).
+    template <typename T>
+    bool match_name_and_type(const T& layer) const noexcept {
         if (m_type != tgd_header::layer_content_type::unknown && m_type != layer.content_type()) {
             return false;
         }
@@ -65,6 +97,19 @@ public:
         return true;
     }
 
+    template <typename T>
+    bool operator()(const T& layer) const noexcept {
+        const auto tile = layer.tile();
+        if (tile.zoom() < m_min_zoom || tile.zoom() > m_max_zoom) {
+            return false;
+        }
+        if (m_check_bbox && !m_ranges[tile.zoom()].contains(tile)) {
+            return false;
+        }
+
+        return match_name_and_type(layer);
+    }
+
 }; // class matcher
 
 static tgd_header::layer_content_type parse_content_type(const std::string& content_type) {
@@ -87,12 +132,76 @@ static tgd_header::layer_content_type parse_content_type(const std::string& cont
     throw std::runtime_error{"unknown content type: " + content_type};
 }
 
+// Parse bounding box in the format "MIN_LON,MIN_LAT,MAX_LON,MAX_LAT".
+static tgd_header::geo_bbox parse_bbox(const std::string& text) {
+    tgd_header::geo_bbox bbox;
+    char rest = '\0';
+    if (std::sscanf(text.c_str(), "%lf,%lf,%lf,%lf%c", &bbox.min_lon, &bbox.min_lat, &bbox.max_lon, &bbox.max_lat, &rest) != 4 || !bbox.valid()) {
+        throw std::runtime_error{"invalid bounding box: " + text};
+    }
+    return bbox;
+}
+
+// Parse zoom range in the format "MIN-MAX" or "ZOOM".
+static std::pair<int, int> parse_zoom_range(const std::string& text) {
+    int min = 0;
+    int max = 0;
+    char rest = '\0';
+    const int count = std::sscanf(text.c_str(), "%d-%d%c", &min, &max, &rest);
+    if (count == 1 && text.find('-') == std::string::npos) {
+        max = min;
+    } else if (count != 2) {
+        throw std::runtime_error{"invalid zoom range: " + text};
+    }
+    if (min < 0 || max > max_zoom || min > max) {
+        throw std::runtime_error{"invalid zoom range: " + text};
+    }
+    return std::make_pair(min, max);
+}
+
+// Copy the records at the offsets given in the index entries. Runs of
+// consecutive records are copied in one go. Reference records are written
+// with the referenced content.
+static void copy_records(std::vector<tgd_header::layer_index_entry>& entries, const tgd_header::pread_source& source, tgd_header::file_sink& output_file) {
+    std::sort(entries.begin(), entries.end(), [](const tgd_header::layer_index_entry& a, const tgd_header::layer_index_entry& b) {
+        return a.offset() < b.offset();
+    });
+
+    std::uint64_t copy_offset = 0;
+    std::uint64_t copy_length = 0;
+    for (const auto& entry : entries) {
+        if (entry.is_reference()) {
+            if (copy_length > 0) {
+                output_file.copy_from(source, copy_offset, copy_length);
+            }
+            copy_length = 0;
+            tgd_header::read_layer_at(source, entry.offset()).write(output_file);
+            continue;
+        }
+        if (copy_offset + copy_length != entry.offset()) {
+            if (copy_length > 0) {
+                output_file.copy_from(source, copy_offset, copy_length);
+            }
+            copy_offset = entry.offset();
+            copy_length = 0;
+        }
+        copy_length += entry.size();
+    }
+
+    if (copy_length > 0) {
+        output_file.copy_from(source, copy_offset, copy_length);
+    }
+}
+
 int main(int argc, char *argv[]) {
     std::string input_file_name;
     std::string output_file_name;
     std::string layer_name;
     std::string content_type;
-    int zoom = any_zoom;
+    std::string index_file_name;
+    std::string bbox_text;
+    std::string zoom_range_text;
+    int zoom = -1;
     bool help = false;
     bool verbose = false;
 
@@ -112,6 +221,15 @@ int main(int argc, char *argv[]) {
         | clara::Opt(zoom, "zoom")
             ["-z"]["--zoom"]
             ("filter by zoom level (default: any)")
+        | clara::Opt(zoom_range_text, "min-max")
+            ["-Z"]["--zoom-range"]
+            ("filter by range of zoom levels (default: any)")
+        | clara::Opt(bbox_text, "bbox")
+            ["-b"]["--bbox"]
+            ("filter by bounding box: MIN_LON,MIN_LAT,MAX_LON,MAX_LAT")
+        | clara::Opt(index_file_name, "file")
+            ["-i"]["--index"]
+            ("use this index of the input file to read only matching tiles")
         | clara::Help(help)
         | clara::Arg(input_file_name, "FILE")
             ("data");
@@ -123,7 +241,7 @@ int main(int argc, char *argv[]) {
     }
 
     if (help) {
-        std::cout << "Filter tile input file by name, content type, and/or zoom level.\n\n";
+        std::cout << "Filter tile input file by name, content type, zoom level, and/or area.\n\n";
         std::cout << cli;
         return 0;
     }
@@ -138,36 +256,112 @@ int main(int argc, char *argv[]) {
         return 2;
     }
 
-    if (zoom != 255 && (zoom < 0 || zoom > 30)) {
+    if (zoom != -1 && (zoom < 0 || zoom > max_zoom)) {
         std::cerr << "Invalid value for -z/--zoom option.\n";
         return 2;
     }
 
-    matcher match{layer_name, parse_content_type(content_type), std::uint8_t(zoom)};
+    if (zoom != -1 && !zoom_range_text.empty()) {
+        std::cerr << "Use either -z/--zoom or -Z/--zoom-range option, not both.\n";
+        return 2;
+    }
+
+    try {
+        int min_zoom = 0;
+        int max_zoom_used = 255;
+        if (zoom != -1) {
+            min_zoom = zoom;
+            max_zoom_used = zoom;
+        } else if (!zoom_range_text.empty()) {
+            const auto range = parse_zoom_range(zoom_range_text);
+            min_zoom = range.first;
+            max_zoom_used = range.second;
+        }
+
+        tgd_header::geo_bbox bbox;
+        if (!bbox_text.empty()) {
+            bbox = parse_bbox(bbox_text);
+        }
+
+        const matcher match{layer_name, parse_content_type(content_type),
+                            static_cast<std::uint8_t>(min_zoom), static_cast<std::uint8_t>(max_zoom_used),
+                            bbox_text.empty() ? nullptr : &bbox};
 
-    tgd_header::file_source source{input_file_name};
-    tgd_header::reader<decltype(source)> reader{source};
+        tgd_header::file_sink output_file{output_file_name};
 
-    tgd_header::file_sink output_file{output_file_name};
+        if (!index_file_name.empty()) {
+            const tgd_header::mmap_source index_source{index_file_name};
+            const auto index_data = index_source.mapping();
+            const tgd_header::layer_index index{tgd_header::buffer{index_data.data(), index_data.size()}};
 
-    while (auto& layer = reader.next_layer()) {
-        if (verbose) {
-            std::cout << "Considering layer '"
-                      << layer.name()
-                      << "' of type "
-                      << layer.content_type()
-                      << " in tile "
-                      << layer.tile();
+            std::vector<tgd_header::layer_index_entry> entries;
+            index.for_each_in(static_cast<std::uint8_t>(min_zoom),
+                              static_cast<std::uint8_t>(max_zoom_used),
+                              bbox, [&](const tgd_header::layer_index_entry& entry) {
+                if (match.match_name_and_type(entry)) {
+                    entries.push_back(entry);
+                }
+            });
+
+            if (verbose) {
+                std::cout << "Found " << entries.size() << " matching layers in index\n";
+            }
+
+            const tgd_header::pread_source source{input_file_name};
+            copy_records(entries, source, output_file);
+            output_file.close();
+            return 0;
         }
-        if (match(layer)) {
+
+        tgd_header::buffered_file_source source{input_file_name};
+        tgd_header::reader<decltype(source)> reader{source};
+
+        // The range of consecutive matching records not copied yet
+        std::uint64_t copy_offset = 0;
+        std::uint64_t copy_length = 0;
+
+        while (auto& layer = reader.next_layer()) {
             if (verbose) {
-                std::cout << ": MATCHED\n";
+                std::cout << "Considering layer '"
+                          << layer.name()
+                          << "' of type "
+                          << layer.content_type()
+                          << " in tile "
+                          << layer.tile();
             }
-            reader.read_content();
-            layer.write(output_file);
-        } else if (verbose) {
-            std::cout << ": DOES NOT MATCH\n";
+            if (match(layer)) {
+                if (verbose) {
+                    std::cout << ": MATCHED\n";
+                }
+                if (layer.is_reference()) {
+                    if (copy_length > 0) {
+                        output_file.copy_from(source, copy_offset, copy_length);
+                    }
+                    copy_length = 0;
+                    layer.write(output_file);
+                    continue;
+                }
+                const auto offset = reader.layer_offset();
+                if (copy_offset + copy_length != offset) {
+                    if (copy_length > 0) {
+                        output_file.copy_from(source, copy_offset, copy_length);
+                    }
+                    copy_offset = offset;
+                    copy_length = 0;
+                }
+                copy_length += layer.record_size();
+            } else if (verbose) {
+                std::cout << ": DOES NOT MATCH\n";
+            }
+        }
+
+        if (copy_length > 0) {
+            output_file.copy_from(source, copy_offset, copy_length);
         }
+
+        output_file.close();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << '\n';
+        return 2;
     }
 }
-
@@ -0,0 +1,91 @@
+/*****************************************************************************
+
+  tgd-index
+
+  Create an index for a tile file.
+
+  Reads all layer headers from the specified input file and writes an index
+  into the output file. If no output file is specified, the index is written
+  into a file with the same name as the input file and an additional suffix
+  ".idx". The index contains the tile address, name, and content type of
+  each layer and where it is in the input file. It can be used to quickly
+  find layers without reading through the whole input file.
+
+  Examples:
+
+  tgd-index input.tgd
+
+  tgd-index input.tgd -o input.idx
+
+*****************************************************************************/
+
+#include <tgd_header/buffered_file_source.hpp>
+#include <tgd_header/file_sink.hpp>
+#include <tgd_header/index.hpp>
+#include <tgd_header/layer.hpp>
+#include <tgd_header/reader.hpp>
+
+#include <clara.hpp>
+
+#include <iostream>
+#include <string>
+
+int main(int argc, char *argv[]) {
+    std::string input_file_name;
+    std::string output_file_name;
+    bool help = false;
+    bool verbose = false;
+
+    const auto cli
+        = clara::Opt(output_file_name, "file")
+            ["-o"]["--output"]
+            ("output file (default: input file name + '.idx')")
+        | clara::Opt(verbose)
+            ["-v"]["--verbose"]
+            ("verbose output")
+        | clara::Help(help)
+        | clara::Arg(input_file_name, "FILE")
+            ("data");
+
+    const auto result = cli.parse(clara::Args(argc, argv));
+    if (!result) {
+        std::cerr << "Error in command line: " << result.errorMessage() << '\n';
+        return 2;
+    }
+
+    if (help) {
+        std::cout << "Create index for tile file.\n\n";
+        std::cout << cli;
+        return 0;
+    }
+
+    if (input_file_name.empty()) {
+        std::cerr << "Missing input file. Try 'tgd-index -h'.\n";
+        return 2;
+    }
+
+    if (output_file_name.empty()) {
+        output_file_name = input_file_name + ".idx";
+    }
+
+    tgd_header::buffered_file_source source{input_file_name};
+    tgd_header::reader<decltype(source)> reader{source};
+
+    tgd_header::layer_index_builder builder;
+
+    while (auto& layer = reader.next_layer()) {
+        builder.add(layer, reader.layer_offset());
+    }
+
+    tgd_header::file_sink sink{output_file_name};
+    const auto size = builder.write(sink);
+    sink.close();
+
+    if (verbose) {
+        std::cerr << "Wrote index with " << builder.size() << " layers ("
+                  << size << " bytes) to '" << output_file_name << "'\n";
+    }
+
+    return 0;
+}
+
@@ -8,19 +8,26 @@
   option -n/--name was no specified, all layers are examined, otherwise only
   the layers with the specified name.
 
+  The content of all layers is read and decoded to make sure it is okay.
+  Use -H/--headers-only if you only want to see the metadata, in that case
+  the content is skipped and never read.
+
   Examples:
 
   tgd-info input.tgd
 
   tgd-info input.tgd -n roads
 
+  tgd-info input.tgd -H
+
 *****************************************************************************/
 
 #include <tgd_header/buffer.hpp>
-#include <tgd_header/file_source.hpp>
+#include <tgd_header/buffered_file_source.hpp>
 #include <tgd_header/layer.hpp>
 #include <tgd_header/reader.hpp>
 #include <tgd_header/stream.hpp>
+#include <tgd_header/zlib_context.hpp>
 
 #include <clara.hpp>
 
@@ -30,11 +37,15 @@ int main(int argc, char *argv[]) {
     std::string input_file_name;
     std::string layer_name;
     bool help = false;
+    bool headers_only = false;
 
     const auto cli
         = clara::Opt(layer_name, "name")
             ["-n"]["--name"]
             ("layer name")
+        | clara::Opt(headers_only)
+            ["-H"]["--headers-only"]
+            ("only read headers, don't read and decode content")
         | clara::Help(help)
         | clara::Arg(input_file_name, "FILE")
             ("data");
@@ -56,13 +67,16 @@ int main(int argc, char *argv[]) {
         return 2;
     }
 
-    tgd_header::file_source source{input_file_name};
+    tgd_header::buffered_file_source source{input_file_name};
     tgd_header::reader<decltype(source)> reader{source};
+    tgd_header::zlib_context context;
 
     while (auto& layer = reader.next_layer()) {
         if (layer_name.empty() || layer.has_name(layer_name)) {
-            reader.read_content();
-            layer.decode_content();
+            if (!headers_only) {
+                reader.read_content();
+                layer.decode_content(context);
+            }
             std::cout << "LAYER " << layer.name() << '\n';
             std::cout << "  tile (zoom/x/y): " << layer.tile() << '\n';
             std::cout << "  content type:    " << layer.content_type() << '\n';
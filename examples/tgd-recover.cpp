@@ -0,0 +1,156 @@
+/*****************************************************************************
+
+  tgd-recover
+
+  Recover layers from a damaged or truncated tile file.
+
+  Reads the input file and writes all intact layers to the output file.
+  When damaged data is found, the input is searched for the next plausible
+  layer record (magic bytes at an 8 byte aligned offset, valid name and
+  compression type, record completely inside the file, and matching
+  checksum if there is one) and copying resumes there. Incomplete records
+  at the end of a truncated file are dropped.
+
+  Layers with a checksum that doesn't match are always dropped. Content is
+  not decoded, so errors in compressed data without a checksum are not
+  detected. Use tgd-verify -d for that. References to deduplicated content
+  (see tgd-cat -D) are replaced by the content, references pointing outside
+  the file are dropped.
+
+  The exit code is 0 if the input was intact, 1 if some data had to be
+  skipped, and 2 on other problems.
+
+  Examples:
+
+  tgd-recover damaged.tgd -o recovered.tgd
+
+*****************************************************************************/
+
+#include <tgd_header/buffer.hpp>
+#include <tgd_header/exceptions.hpp>
+#include <tgd_header/file_sink.hpp>
+#include <tgd_header/layer_view.hpp>
+#include <tgd_header/mmap_source.hpp>
+#include <tgd_header/pread_source.hpp>
+#include <tgd_header/scanner.hpp>
+
+#include <clara.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+
+int main(int argc, char *argv[]) {
+    std::string input_file_name;
+    std::string output_file_name;
+    bool help = false;
+    bool verbose = false;
+
+    const auto cli
+        = clara::Opt(output_file_name, "file")
+            ["-o"]["--output"]
+            ("output file")
+        | clara::Opt(verbose)
+            ["-v"]["--verbose"]
+            ("report every skipped range")
+        | clara::Help(help)
+        | clara::Arg(input_file_name, "FILE")
+            ("data");
+
+    const auto result = cli.parse(clara::Args(argc, argv));
+    if (!result) {
+        std::cerr << "Error in command line: " << result.errorMessage() << '\n';
+        return 2;
+    }
+
+    if (help) {
+        std::cout << "Recover layers from damaged tile file.\n\n";
+        std::cout << cli;
+        return 0;
+    }
+
+    if (input_file_name.empty()) {
+        std::cerr << "Missing input file. Try 'tgd-recover -h'.\n";
+        return 2;
+    }
+
+    if (output_file_name.empty()) {
+        std::cerr << "Missing -o/--output option. Try 'tgd-recover -h'.\n";
+        return 2;
+    }
+
+    try {
+        tgd_header::file_sink output_file{output_file_name, 1024UL * 1024UL};
+
+        // An empty file is intact, but can't be memory mapped.
+        if (tgd_header::pread_source{input_file_name}.file_size() == 0) {
+            output_file.close();
+            return 0;
+        }
+
+        tgd_header::mmap_options options;
+        options.access = tgd_header::mmap_access::sequential;
+        const tgd_header::mmap_source source{input_file_name, options};
+        const auto input = source.mapping();
+        const char* data = input.data();
+        const std::uint64_t size = input.size();
+        const tgd_header::layer_view_range range{data, static_cast<std::size_t>(size)};
+
+        std::uint64_t layers = 0;
+        std::uint64_t skipped_bytes = 0;
+        std::uint64_t skipped_ranges = 0;
+
+        std::uint64_t offset = 0;
+        while (offset < size) {
+            const auto record_size = tgd_header::check_record(data + offset, size - offset);
+            if (record_size > 0) {
+                const tgd_header::layer_view view{data + offset, record_size};
+                if (view.is_reference()) {
+                    // Offsets are different in the output, so references
+                    // are replaced by the content they point to.
+                    try {
+                        range.to_layer(view).write(output_file);
+                    } catch (const tgd_header::format_error& e) {
+                        if (verbose) {
+                            std::cerr << "Skipping layer at offset " << offset << ": " << e.what() << '\n';
+                        }
+                        skipped_bytes += record_size;
+                        ++skipped_ranges;
+                        offset += record_size;
+                        continue;
+                    }
+                } else {
+                    output_file.write(tgd_header::buffer{data + offset, record_size});
+                }
+                offset += record_size;
+                ++layers;
+                continue;
+            }
+
+            const auto next = tgd_header::find_record(data, size, offset + 8);
+            if (verbose) {
+                std::cerr << "Skipping damaged data from offset " << offset
+                          << " to " << next << " (" << (next - offset) << " bytes)\n";
+            }
+            skipped_bytes += next - offset;
+            ++skipped_ranges;
+            offset = next;
+        }
+
+        output_file.close();
+
+        std::cout << "Recovered " << layers << " layers";
+        if (skipped_ranges > 0) {
+            std::cout << ", skipped " << skipped_bytes << " bytes in "
+                      << skipped_ranges << " damaged ranges";
+        }
+        std::cout << '\n';
+
+        return skipped_ranges > 0 ? 1 : 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << '\n';
+        return 2;
+    }
+}
@@ -0,0 +1,237 @@
+/*****************************************************************************
+
+  tgd-verify
+
+  Check the integrity of a tile file.
+
+  All layer records are checked for a valid header (including a known
+  compression type) and a complete name and content. The name must be
+  terminated by a zero byte and must not contain any other zero bytes. Layers with a checksum (written for instance with tgd-cat -C)
+  are checked against it. With -d/--decode the content of every layer is
+  also decoded to find errors in the compressed data.
+
+  The file is memory mapped and the layers are checked on several threads
+  (set with -j/--jobs), so this is usually limited by memory or disk
+  bandwidth.
+
+  The exit code is 0 if everything is okay, 1 if errors were found, and 2
+  on other problems.
+
+  Examples:
+
+  tgd-verify tile.tgd
+
+  tgd-verify -j 16 --require-checksum archive.tgd
+
+*****************************************************************************/
+
+#include <tgd_header/exceptions.hpp>
+#include <tgd_header/layer.hpp>
+#include <tgd_header/layer_view.hpp>
+#include <tgd_header/mmap_source.hpp>
+#include <tgd_header/pread_source.hpp>
+#include <tgd_header/stream.hpp>
+#include <tgd_header/zlib_context.hpp>
+
+#include <clara.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct verify_options {
+    bool decode = false;
+    bool require_checksum = false;
+    bool verbose = false;
+};
+
+struct verify_result {
+    std::size_t layers = 0;
+    std::size_t checksums = 0;
+    std::size_t errors = 0;
+};
+
+static std::mutex output_mutex;
+
+static void report(const tgd_header::layer_view_range& range, const tgd_header::layer_view& view, const std::string& message) {
+    std::lock_guard<std::mutex> lock{output_mutex};
+    std::cout << "ERROR at offset " << range.offset(view) << " (layer '" << view.name()
+              << "' in tile " << view.tile() << "): " << message << '\n';
+}
+
+/**
+ * Check the layers in views from begin to end.
+ */
+static verify_result verify(const tgd_header::layer_view_range& range,
+                            const std::vector<tgd_header::layer_view>& views,
+                            std::size_t begin, std::size_t end,
+                            const verify_options& options) {
+    verify_result result;
+    tgd_header::zlib_context context;
+
+    for (std::size_t n = begin; n < end; ++n) {
+        const auto& view = views[n];
+        ++result.layers;
+
+        if (view.has_checksum()) {
+            ++result.checksums;
+            if (!view.verify_checksum()) {
+                report(range, view, "checksum mismatch");
+                ++result.errors;
+                continue;
+            }
+        } else if (options.require_checksum) {
+            report(range, view, "no checksum");
+            ++result.errors;
+            continue;
+        }
+
+        if (view.is_reference()) {
+            try {
+                range.wire_content(view);
+            } catch (const std::exception& e) {
+                report(range, view, e.what());
+                ++result.errors;
+                continue;
+            }
+        }
+
+        if (options.decode) {
+            try {
+                auto layer = range.to_layer(view);
+                layer.decode_content(context);
+            } catch (const std::exception& e) {
+                report(range, view, e.what());
+                ++result.errors;
+            }
+        }
+    }
+
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    std::string input_file_name;
+    unsigned int threads = std::thread::hardware_concurrency();
+    verify_options options;
+    bool help = false;
+
+    const auto cli
+        = clara::Opt(threads, "threads")
+            ["-j"]["--jobs"]
+            ("number of threads (default: number of CPUs)")
+        | clara::Opt(options.decode)
+            ["-d"]["--decode"]
+            ("also decode the content of all layers")
+        | clara::Opt(options.require_checksum)
+            ["-r"]["--require-checksum"]
+            ("report layers without checksum as errors")
+        | clara::Opt(options.verbose)
+            ["-v"]["--verbose"]
+            ("verbose output")
+        | clara::Help(help)
+        | clara::Arg(input_file_name, "FILE")
+            ("data");
+
+    const auto result = cli.parse(clara::Args(argc, argv));
+    if (!result) {
+        std::cerr << "Error in command line: " << result.errorMessage() << '\n';
+        return 2;
+    }
+
+    if (help) {
+        std::cout << "Check the integrity of a tile file.\n\n";
+        std::cout << cli;
+        return 0;
+    }
+
+    if (input_file_name.empty()) {
+        std::cerr << "Missing input file. Try 'tgd-verify -h'.\n";
+        return 2;
+    }
+
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    try {
+        // An empty file is valid, but can't be memory mapped.
+        if (tgd_header::pread_source{input_file_name}.file_size() == 0) {
+            std::cout << "OK: 0 layers\n";
+            return 0;
+        }
+
+        tgd_header::mmap_options mmap_opts;
+        mmap_opts.access = tgd_header::mmap_access::sequential;
+        const tgd_header::mmap_source source{input_file_name, mmap_opts};
+        const tgd_header::layer_view_range range{source.mapping()};
+
+        // Find all records first. This only touches the headers.
+        std::vector<tgd_header::layer_view> views;
+        std::uint64_t end_of_last = 0;
+        try {
+            for (const auto& view : range) {
+                views.push_back(view);
+                end_of_last = range.offset(view) + view.record_size();
+            }
+        } catch (const tgd_header::format_error& e) {
+            std::cout << "ERROR at offset " << end_of_last << ": " << e.what() << '\n';
+            return 1;
+        }
+
+        if (end_of_last != source.file_size()) {
+            std::cout << "ERROR at offset " << end_of_last << ": "
+                      << (source.file_size() - end_of_last) << " bytes of trailing data\n";
+            return 1;
+        }
+
+        if (threads > views.size()) {
+            threads = views.empty() ? 1 : static_cast<unsigned int>(views.size());
+        }
+
+        if (options.verbose) {
+            std::cerr << "Checking " << views.size() << " layers on " << threads << " threads\n";
+        }
+
+        // Split the records into ranges of about the same number of bytes.
+        std::vector<std::size_t> bounds{0};
+        const auto bytes_per_thread = source.file_size() / threads + 1;
+        for (std::size_t n = 0; n < views.size(); ++n) {
+            if (range.offset(views[n]) >= bytes_per_thread * bounds.size()) {
+                bounds.push_back(n);
+            }
+        }
+        bounds.push_back(views.size());
+
+        std::vector<verify_result> results(bounds.size() - 1);
+        std::vector<std::thread> workers;
+        for (std::size_t t = 0; t + 1 < bounds.size(); ++t) {
+            workers.emplace_back([&, t]() {
+                results[t] = verify(range, views, bounds[t], bounds[t + 1], options);
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        verify_result total;
+        for (const auto& r : results) {
+            total.layers += r.layers;
+            total.checksums += r.checksums;
+            total.errors += r.errors;
+        }
+
+        std::cout << (total.errors ? "FAILED: " : "OK: ") << total.layers << " layers, "
+                  << total.checksums << " with checksum, " << total.errors << " errors\n";
+
+        return total.errors ? 1 : 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << '\n';
+        return 2;
+    }
+}
@@ -0,0 +1,242 @@
+#ifndef TGD_HEADER_ARCHIVE_WRITER_HPP
+#define TGD_HEADER_ARCHIVE_WRITER_HPP
+
+/*****************************************************************************
+
+tgd_header - Encoding and decoding the Tiled Geographic Data Common Header.
+
+This file is from https://github.com/mapbox/tgd-header-lib where you can find
+more documentation.
+
+*****************************************************************************/
+
+/**
+ * @file archive_writer.hpp
+ *
+ * @brief Contains the archive_writer class.
+ *
+ * An archive is an ordinary tile file containing the layers of many tiles,
+ * usually a whole tile pyramid, together with a layer index (see
+ * index.hpp) as its directory. In the archive all layers of a tile are
+ * stored together and the tiles are ordered by zoom level and then along
+ * a Hilbert curve (see tile_key.hpp). This way tiles that are close to
+ * each other on the map are also close to each other in the file.
+ */
+
+#include "buffer.hpp"
+#include "file_sink.hpp"
+#include "index.hpp"
+#include "layer.hpp"
+#include "layer_view.hpp"
+#include "pread_source.hpp"
+#include "tile.hpp"
+#include "tile_key.hpp"
+#include "types.hpp"
+#include "zlib_context.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tgd_header {
+
+    /**
+     * Writes an archive from layers added in any order.
+     *
+     * The layers are written to a staging file (the name of the archive
+     * with the suffix ".tmp") as they are added, only their tile address,
+     * name, and position are kept in memory. When the archive is closed,
+     * the layers are copied from the staging file into the archive in the
+     * right order (using file_sink::copy_from(), so the data doesn't have
+     * to go through user space), the directory is written, and the staging
+     * file is removed.
+     *
+     * @code
+     * archive_writer writer{"archive.tgd"};
+     * writer.add(layer); // as often as needed
+     * file_sink index{"archive.tgd.idx"};
+     * writer.close(index);
+     * index.close();
+     * @endcode
+     */
+    class archive_writer {
+
+        struct item {
+            tile_address tile;
+            std::uint64_t key;
+            layer_content_type content_type;
+            std::string name;
+            std::uint64_t offset;
+            std::uint64_t size;
+        };
+
+        std::string m_filename;
+        std::string m_staging_filename;
+        file_sink m_staging;
+        zlib_context m_context;
+        std::vector<item> m_items;
+        std::uint64_t m_staging_size = 0;
+        bool m_closed = false;
+
+        void check_open() const {
+            if (m_closed) {
+                throw std::logic_error{"archive_writer is already closed"};
+            }
+        }
+
+        void add_item(const tile_address& tile, layer_content_type type, std::string name, std::uint64_t size) {
+            if (tile.zoom() > max_key_zoom) {
+                throw format_error{"zoom level too large for archive"};
+            }
+            m_items.push_back(item{tile, hilbert_key(tile), type, std::move(name), m_staging_size, size});
+            m_staging_size += size;
+        }
+
+        void sort_items() {
+            std::sort(m_items.begin(), m_items.end(), [](const item& a, const item& b) {
+                if (a.tile.zoom() != b.tile.zoom()) {
+                    return a.tile.zoom() < b.tile.zoom();
+                }
+                if (a.key != b.key) {
+                    return a.key < b.key;
+                }
+                const int cmp = detail::compare_names(a.name.data(), a.name.size(), b.name.data(), b.name.size());
+                return cmp < 0 || (cmp == 0 && a.content_type < b.content_type);
+            });
+        }
+
+    public:
+
+        /**
+         * Construct an archive_writer writing into the specified file.
+         *
+         * @param filename Name of the archive file.
+         * @param batch_size Batch size for writing into the staging file,
+         *                   see file_sink.
+         * @throws std::system_error If the staging file can not be
+         *                           created.
+         */
+        explicit archive_writer(const std::string& filename, std::size_t batch_size = 1024UL * 1024UL) :
+            m_filename(filename),
+            m_staging_filename(filename + ".tmp"),
+            m_staging(m_staging_filename, batch_size) {
+        }
+
+        archive_writer(const archive_writer&) = delete;
+        archive_writer& operator=(const archive_writer&) = delete;
+
+        archive_writer(archive_writer&&) = delete;
+        archive_writer& operator=(archive_writer&&) = delete;
+
+        /// Removes the staging file if the archive was not closed.
+        ~archive_writer() noexcept {
+            if (!m_closed) {
+                try {
+                    m_staging.close();
+                } catch (...) {
+                    // ignore errors so that the destructor can be noexcept
+                }
+                std::remove(m_staging_filename.c_str());
+            }
+        }
+
+        /// The number of layers added so far.
+        std::size_t size() const noexcept {
+            return m_items.size();
+        }
+
+        /**
+         * Add a layer to the archive. Its content is encoded if needed.
+         *
+         * @throws format_error If the zoom level of the tile is larger
+         *                      than max_key_zoom.
+         * @throws std::logic_error If the archive was already closed.
+         */
+        void add(layer& layer) {
+            check_open();
+            const auto size = layer.write(m_staging, m_context);
+            add_item(layer.tile(), layer.content_type(), std::string(layer.name(), layer.name_length()), size);
+        }
+
+        /**
+         * Add a layer from memory to the archive. The record is copied
+         * unchanged. Reference records can't be copied, because they only
+         * make sense in the file they are in, resolve them first using
+         * layer_view_range::to_layer() and add the layer.
+         *
+         * @throws format_error If the zoom level of the tile is larger
+         *                      than max_key_zoom or if the view is a
+         *                      reference record.
+         * @throws std::logic_error If the archive was already closed.
+         */
+        void add(const layer_view& view) {
+            check_open();
+            if (view.is_reference()) {
+                throw format_error{"can not add reference record to archive"};
+            }
+            m_staging.write(buffer{view.data(), view.record_size()});
+            add_item(view.tile(), view.content_type(), std::string(view.name(), view.name_length()), view.record_size());
+        }
+
+        /**
+         * Write out the archive and its directory and remove the staging
+         * file. The archive_writer can not be used any more afterwards.
+         *
+         * @param index_sink The sink the directory (a layer index) is
+         *                   written to.
+         * @returns The size of the archive in bytes.
+         * @throws std::logic_error If the archive was already closed.
+         */
+        template <typename TSink>
+        std::uint64_t close(TSink& index_sink) {
+            check_open();
+            m_closed = true;
+            m_staging.close();
+
+            try {
+                sort_items();
+
+                const pread_source staging{m_staging_filename};
+                file_sink output{m_filename};
+                layer_index_builder builder;
+
+                // Layers that follow each other in the staging file are
+                // copied in one go.
+                std::uint64_t offset = 0;
+                std::uint64_t run_begin = 0;
+                std::uint64_t run_size = 0;
+                for (auto& item : m_items) {
+                    if (item.offset != run_begin + run_size) {
+                        output.copy_from(staging, run_begin, run_size);
+                        run_begin = item.offset;
+                        run_size = 0;
+                    }
+                    run_size += item.size;
+                    builder.add(item.tile, item.content_type, std::move(item.name), offset, item.size);
+                    offset += item.size;
+                }
+                output.copy_from(staging, run_begin, run_size);
+                output.close();
+
+                builder.write(index_sink);
+            } catch (...) {
+                std::remove(m_staging_filename.c_str());
+                throw;
+            }
+
+            std::remove(m_staging_filename.c_str());
+            m_items.clear();
+
+            return m_staging_size;
+        }
+
+    }; // class archive_writer
+
+} // namespace tgd_header
+
+#endif // TGD_HEADER_ARCHIVE_WRITER_HPP
@@ -16,10 +16,14 @@ more documentation.
  * @brief Contains the buffer class.
  */
 
+#include "memory_resource.hpp"
+
 #include <algorithm>
 #include <array>
+#include <cassert>
+#include <cstddef>
 #include <cstdint>
-#include <memory>
+#include <utility>
 
 namespace tgd_header {
 
@@ -36,11 +40,12 @@ namespace tgd_header {
 
         friend class buffer;
 
-        std::unique_ptr<char[]> m_data = nullptr;
+        memory_resource* m_resource;
+        char* m_data;
         std::size_t m_size;
 
         void release() noexcept {
-            m_data.release();
+            m_data = nullptr;
             m_size = 0;
         }
 
@@ -48,16 +53,47 @@ namespace tgd_header {
 
         /**
          * Construct buffer with specified size. This will allocate the
-         * required memory on the heap using new.
+         * required memory from the specified memory resource, by default
+         * on the heap using new.
          */
-        explicit mutable_buffer(std::size_t size) :
+        explicit mutable_buffer(std::size_t size, memory_resource* resource = new_delete_resource()) :
+            m_resource(resource),
+            m_data(resource->allocate(size)),
             m_size(size) {
-            m_data.reset(new char[size]); // NOLINT(modernize-make-unique) (not available in C++11)
+        }
+
+        mutable_buffer(const mutable_buffer&) = delete;
+        mutable_buffer& operator=(const mutable_buffer&) = delete;
+
+        mutable_buffer(mutable_buffer&& other) noexcept :
+            m_resource(other.m_resource),
+            m_data(other.m_data),
+            m_size(other.m_size) {
+            other.release();
+        }
+
+        mutable_buffer& operator=(mutable_buffer&& other) noexcept {
+            using std::swap;
+            swap(m_resource, other.m_resource);
+            swap(m_data, other.m_data);
+            swap(m_size, other.m_size);
+            return *this;
+        }
+
+        ~mutable_buffer() noexcept {
+            if (m_data) {
+                m_resource->deallocate(m_data, m_size);
+            }
+        }
+
+        /// Return the memory resource this buffer was allocated from.
+        memory_resource* resource() const noexcept {
+            return m_resource;
         }
 
         /// Return a pointer to the data in the buffer.
         char* data() const noexcept {
-            return m_data.get();
+            return m_data;
         }
 
         /// Return the size of the buffer.
@@ -67,22 +103,22 @@ namespace tgd_header {
 
         /// Iterator pointing to the beginning of the data.
         char* begin() noexcept {
-            return m_data.get();
+            return m_data;
         }
 
         /// Iterator pointing to the end of the data.
         char* end() noexcept {
-            return m_data.get() + m_size;
+            return m_data + m_size;
         }
 
         /// Iterator pointing to the beginning of the data.
         const char* cbegin() const noexcept {
-            return m_data.get();
+            return m_data;
         }
 
         /// Iterator pointing to the end of the data.
         const char* cend() const noexcept {
-            return m_data.get() + m_size;
+            return m_data + m_size;
         }
 
     }; // class mutable_buffer
@@ -100,14 +136,19 @@ namespace tgd_header {
      *   as this buffer is still used.
      * * The buffer can allocate memory itself or take over the memory
      *   management for some memory you give it access to. In this case
-     *   the buffer will release the memory (using delete[]) when the clear()
-     *   function is called or when it is destructed.
+     *   the buffer will release the memory (using delete[] or the memory
+     *   resource it was allocated from) when the clear() function is
+     *   called or when it is destructed.
      */
     class buffer {
 
         const char* m_data = nullptr;
         std::size_t m_size = 0;
-        bool m_managed = false;
+
+        // The memory resource managing the data, nullptr if the data is
+        // not managed, and the size of the memory allocated from it.
+        memory_resource* m_resource = nullptr;
+        std::size_t m_capacity = 0;
 
     public:
 
@@ -128,10 +169,26 @@ namespace tgd_header {
          * Construct a buffer from a mutable buffer. Management of the
          * memory will be taken over from the mutable_buffer.
          */
-        explicit buffer(mutable_buffer&& mb) :
+        explicit buffer(mutable_buffer&& mb) noexcept :
             m_data(mb.data()),
             m_size(mb.size()),
-            m_managed(true) {
+            m_resource(mb.resource()),
+            m_capacity(mb.size()) {
+            mb.release();
+        }
+
+        /**
+         * Construct a buffer from the first size bytes of a mutable buffer.
+         * Management of the memory will be taken over from the
+         * mutable_buffer. This is used when it is not known beforehand
+         * how much of the memory will be needed.
+         */
+        explicit buffer(mutable_buffer&& mb, std::size_t size) noexcept :
+            m_data(mb.data()),
+            m_size(size),
+            m_resource(mb.resource()),
+            m_capacity(mb.size()) {
+            assert(size <= mb.size());
             mb.release();
         }
 
@@ -146,12 +203,14 @@ namespace tgd_header {
 
         /**
          * Construct a buffer pointing to existing memory. The memory is
-         * managed by the buffer if the manage flag is true.
+         * managed by the buffer if the manage flag is true. In that case
+         * it must have been allocated with new[].
          */
         explicit buffer(const char* data, std::size_t size, bool manage) noexcept :
             m_data(data),
             m_size(size),
-            m_managed(manage) {
+            m_resource(manage ? new_delete_resource() : nullptr),
+            m_capacity(size) {
         }
 
         /**
@@ -165,10 +224,12 @@ namespace tgd_header {
         buffer(buffer&& other) noexcept :
             m_data(other.m_data),
             m_size(other.m_size),
-            m_managed(other.m_managed) {
+            m_resource(other.m_resource),
+            m_capacity(other.m_capacity) {
             other.m_data = nullptr;
             other.m_size = 0;
-            other.m_managed = false;
+            other.m_resource = nullptr;
+            other.m_capacity = 0;
         }
 
         /// Buffers can be move assigned.
@@ -189,10 +250,11 @@ namespace tgd_header {
          * Return a copy of this buffer.
          *
          * The resulting buffer is always managed and contains a copy of the
-         * data in this buffer.
+         * data in this buffer. The memory is allocated from the specified
+         * memory resource.
          */
-        buffer copy() const {
-            mutable_buffer mbuffer{size()};
+        buffer copy(memory_resource* resource = new_delete_resource()) const {
+            mutable_buffer mbuffer{size(), resource};
             std::copy_n(data(), size(), mbuffer.data());
             return buffer{std::move(mbuffer)};
         }
@@ -202,12 +264,28 @@ namespace tgd_header {
          * managed, release the memory.
          */
         void clear() noexcept {
-            if (m_managed) {
-                delete[] m_data;
-                m_managed = false;
+            if (m_resource) {
+                m_resource->deallocate(const_cast<char*>(m_data), m_capacity); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+                m_resource = nullptr;
             }
             m_data = nullptr;
             m_size = 0;
+            m_capacity = 0;
+        }
+
+        /**
+         * Release the memory from the buffer without freeing it. If the
+         * buffer was managed, the caller is now responsible for giving the
+         * memory back to the resource() using capacity() as size, so get
+         * those first. The buffer is empty afterwards.
+         */
+        const char* release() noexcept {
+            const char* data = m_data;
+            m_data = nullptr;
+            m_size = 0;
+            m_resource = nullptr;
+            m_capacity = 0;
+            return data;
         }
 
         /// Swap the contents of this buffer with the specified buffer.
@@ -215,7 +293,8 @@ namespace tgd_header {
             using std::swap;
             swap(m_data, other.m_data);
             swap(m_size, other.m_size);
-            swap(m_managed, other.m_managed);
+            swap(m_resource, other.m_resource);
+            swap(m_capacity, other.m_capacity);
         }
 
         /// Does this buffer contain some data.
@@ -230,7 +309,23 @@ namespace tgd_header {
 
         /// Returns true if the buffer manages the memory allocation.
         bool managed() const noexcept {
-            return m_managed;
+            return m_resource != nullptr;
+        }
+
+        /**
+         * Return the memory resource managing the memory, nullptr if the
+         * memory is not managed.
+         */
+        memory_resource* resource() const noexcept {
+            return m_resource;
+        }
+
+        /**
+         * Return the size of the memory allocated for a managed buffer.
+         * This can be larger than size().
+         */
+        std::size_t capacity() const noexcept {
+            return m_capacity;
         }
 
         /// Return the size of the buffer contents.
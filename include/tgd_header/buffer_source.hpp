@@ -19,6 +19,7 @@ more documentation.
 #include "buffer.hpp"
 
 #include <cstddef>
+#include <cstdint>
 #include <stdexcept>
 
 namespace tgd_header {
@@ -70,6 +71,31 @@ namespace tgd_header {
             m_offset += len;
         }
 
+        /**
+         * Read exactly len bytes starting at offset and return the
+         * results. This doesn't change the read position. If there aren't
+         * len bytes at that offset, an empty buffer is returned.
+         */
+        buffer read_at(const std::uint64_t offset, const std::size_t len) const noexcept {
+            if (offset > m_data.size() || len > m_data.size() - offset) {
+                return buffer{};
+            }
+            return buffer{m_data.data() + offset, len};
+        }
+
+        /**
+         * Set the read position to the specified offset.
+         *
+         * @throws std::range_error If the offset is beyond the end of the
+         *                          source
+         */
+        void seek(const std::size_t offset) {
+            if (offset > m_data.size()) {
+                throw std::range_error{"Out of range"};
+            }
+            m_offset = offset;
+        }
+
     }; // buffer_source
 
 } // namespace tgd_header
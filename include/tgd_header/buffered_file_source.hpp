@@ -0,0 +1,265 @@
+#ifndef TGD_HEADER_BUFFERED_FILE_SOURCE_HPP
+#define TGD_HEADER_BUFFERED_FILE_SOURCE_HPP
+
+/*****************************************************************************
+
+tgd_header - Encoding and decoding the Tiled Geographic Data Common Header.
+
+This file is from https://github.com/mapbox/tgd-header-lib where you can find
+more documentation.
+
+*****************************************************************************/
+
+/**
+ * @file buffered_file_source.hpp
+ *
+ * @brief Contains the buffered_file_source class.
+ */
+
+#include "buffer.hpp"
+#include "exceptions.hpp"
+#include "file.hpp"
+#include "pread_source.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <fcntl.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace tgd_header {
+
+    /**
+     * Source for a tgd_header::reader based on a file. Works like the
+     * file_source, but reads the file in large chunks into an internal
+     * read-ahead window and hands out buffers pointing into that window.
+     * This saves a memory allocation and a system call for most reads.
+     *
+     * There are two windows which are used alternately: Whenever the
+     * current window doesn't contain enough data for a read, the data not
+     * yet consumed is moved to the other window and it is filled up from
+     * the file. The data in the old window is left alone until the next
+     * refill. Because each call to read() refills at most once, a buffer
+     * returned from read() stays valid until read() has been called two
+     * more times. This is enough for the reader which needs the name of
+     * a layer to stay around while the content is read. Use buffer::copy()
+     * if you need the data longer.
+     *
+     * Reads larger than the window size are returned in a freshly allocated
+     * (managed) buffer.
+     */
+    class buffered_file_source : public detail::file {
+
+        std::unique_ptr<char[]> m_windows[2];
+        std::size_t m_window_size;
+
+        // Window currently in use (0 or 1).
+        std::size_t m_current = 0;
+
+        // Start and end of the unconsumed data in the current window.
+        std::size_t m_begin = 0;
+        std::size_t m_end = 0;
+
+        // Number of bytes we still have to skip in the file before reading
+        // the next chunk of data.
+        std::size_t m_pending_skip = 0;
+
+        static int open_file_or_stdin(const std::string& filename) {
+            if (filename.empty() || filename == "-") {
+                return 0;
+            }
+
+            return open_file(filename, O_RDONLY | O_CLOEXEC); // NOLINT(hicpp-signed-bitwise)
+        }
+
+        std::size_t available() const noexcept {
+            return m_end - m_begin;
+        }
+
+        // Read from the file until the buffer is full or we are at the end
+        // of the file. Returns the number of bytes read.
+        std::size_t read_fully(char* data, std::size_t len) {
+            if (len == 0) {
+                return 0;
+            }
+
+            if (m_pending_skip > 0) {
+                const auto result = ::lseek(fd(), static_cast<off_t>(m_pending_skip), SEEK_CUR);
+                if (result < 0) {
+                    if (errno != ESPIPE) {
+                        throw std::system_error{errno, std::system_category(), "Seek error: "};
+                    }
+                    // Can't seek on pipes, read and throw away the data
+                    // instead using the output buffer as scratch space.
+                    while (m_pending_skip > 0) {
+                        const auto read_length = ::read(fd(), data, std::min(len, m_pending_skip));
+                        if (read_length < 0 && errno == EINTR) {
+                            continue;
+                        }
+                        if (read_length < 0) {
+                            throw std::system_error{errno, std::system_category(), "Read error: "};
+                        }
+                        if (read_length == 0) {
+                            break;
+                        }
+                        m_pending_skip -= static_cast<std::size_t>(read_length);
+                    }
+                }
+                m_pending_skip = 0;
+            }
+
+            std::size_t done = 0;
+            while (done < len) {
+                const auto read_length = ::read(fd(), data + done, len - done);
+                if (read_length < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw std::system_error{errno, std::system_category(), "Read error: "};
+                }
+                if (read_length == 0) {
+                    break;
+                }
+                done += static_cast<std::size_t>(read_length);
+            }
+
+            return done;
+        }
+
+        // Switch to the other window, move the unconsumed data there and
+        // fill it up from the file.
+        void refill() {
+            const auto next = 1 - m_current;
+            const auto len = available();
+
+            std::copy_n(m_windows[m_current].get() + m_begin, len, m_windows[next].get());
+
+            m_current = next;
+            m_begin = 0;
+            m_end = len + read_fully(m_windows[next].get() + len, m_window_size - len);
+        }
+
+    public:
+
+        /// The default size of each of the two read-ahead windows.
+        static constexpr const std::size_t default_window_size = 256UL * 1024UL;
+
+        /**
+         * Construct buffered_file_source from contents of the specified file.
+         *
+         * @param filename Name of the input file. If empty or "-", STDIN
+         *                 is used.
+         * @param window_size Size of each of the two read-ahead windows.
+         */
+        explicit buffered_file_source(const std::string& filename, std::size_t window_size = default_window_size) :
+            file(open_file_or_stdin(filename)),
+            m_window_size(std::max<std::size_t>(window_size, 1)) {
+            m_windows[0].reset(new char[m_window_size]); // NOLINT(modernize-make-unique) (not available in C++11)
+            m_windows[1].reset(new char[m_window_size]); // NOLINT(modernize-make-unique) (not available in C++11)
+        }
+
+        /// Return the size of each of the read-ahead windows.
+        std::size_t window_size() const noexcept {
+            return m_window_size;
+        }
+
+        /**
+         * Read exactly len bytes from the source and return the results.
+         * If there are no bytes left in the source, an empty buffer is
+         * returned.
+         *
+         * @throws format_error If the file ends in the middle of the data.
+         * @throws std::system_error If there was an error reading the file.
+         */
+        buffer read(const std::size_t len) {
+            if (available() < len && len <= m_window_size) {
+                refill();
+            }
+
+            if (available() >= len) {
+                buffer buffer{m_windows[m_current].get() + m_begin, len};
+                m_begin += len;
+                return buffer;
+            }
+
+            if (len <= m_window_size) {
+                // refill() has been called above, so we are at the end
+                // of the file
+                if (available() == 0) {
+                    return buffer{};
+                }
+                throw format_error{"unexpected end of file"};
+            }
+
+            // Block is larger than the window, read it into its own buffer.
+            const auto have = available();
+            mutable_buffer mb{len};
+            std::copy_n(m_windows[m_current].get() + m_begin, have, mb.data());
+            m_begin = 0;
+            m_end = 0;
+
+            const auto read_length = have + read_fully(mb.data() + have, len - have);
+            if (read_length == 0) {
+                return buffer{};
+            }
+            if (read_length != len) {
+                throw format_error{"unexpected end of file"};
+            }
+
+            return buffer{std::move(mb)};
+        }
+
+        /**
+         * Skip exactly len bytes from the source.
+         *
+         * @throws std::system_error If there was an error seeking in the file.
+         */
+        void skip(const std::size_t len) {
+            if (len <= available()) {
+                m_begin += len;
+                return;
+            }
+
+            m_pending_skip += len - available();
+            m_begin = 0;
+            m_end = 0;
+        }
+
+        /**
+         * Read exactly len bytes starting at offset in the file without
+         * changing the read position. This doesn't work on STDIN. See
+         * pread_source::read_at() for details.
+         */
+        buffer read_at(const std::uint64_t offset, const std::size_t len) const {
+            return detail::pread_buffer(fd(), offset, len);
+        }
+
+        /**
+         * Set the read position to the specified offset. This throws away
+         * the read-ahead data, but buffers returned earlier stay valid
+         * as described above.
+         *
+         * @throws std::system_error If there was an error seeking in the file.
+         */
+        void seek(const std::size_t offset) {
+            const auto result = ::lseek(fd(), static_cast<off_t>(offset), SEEK_SET);
+            if (result < 0) {
+                throw std::system_error{errno, std::system_category(), "Seek error: "};
+            }
+            m_pending_skip = 0;
+            m_begin = 0;
+            m_end = 0;
+        }
+
+    }; // buffered_file_source
+
+} // namespace tgd_header
+
+#endif // TGD_HEADER_BUFFERED_FILE_SOURCE_HPP
@@ -0,0 +1,167 @@
+#ifndef TGD_HEADER_CRC32C_HPP
+#define TGD_HEADER_CRC32C_HPP
+
+/*****************************************************************************
+
+tgd_header - Encoding and decoding the Tiled Geographic Data Common Header.
+
+This file is from https://github.com/mapbox/tgd-header-lib where you can find
+more documentation.
+
+*****************************************************************************/
+
+/**
+ * @file crc32c.hpp
+ *
+ * @brief Contains the crc32c() function for the CRC-32C (Castagnoli)
+ *        checksum used for the integrity checks of layers.
+ *
+ * On x86 CPUs with SSE 4.2 the crc32 instruction is used, this is decided
+ * at runtime. Everywhere else a table-driven implementation is used.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+# define TGD_HEADER_CRC32C_SSE42
+# include <nmmintrin.h>
+#endif
+
+namespace tgd_header {
+
+    namespace detail {
+
+        // Slicing-by-8 tables for the reflected polynomial 0x82f63b78.
+        class crc32c_tables {
+
+            std::uint32_t m_table[8][256];
+
+        public:
+
+            crc32c_tables() noexcept {
+                for (std::uint32_t n = 0; n < 256; ++n) {
+                    std::uint32_t crc = n;
+                    for (int k = 0; k < 8; ++k) {
+                        crc = (crc & 1U) ? (crc >> 1U) ^ 0x82f63b78U : crc >> 1U;
+                    }
+                    m_table[0][n] = crc;
+                }
+                for (std::uint32_t n = 0; n < 256; ++n) {
+                    for (int t = 1; t < 8; ++t) {
+                        m_table[t][n] = (m_table[t - 1][n] >> 8U) ^ m_table[0][m_table[t - 1][n] & 0xffU];
+                    }
+                }
+            }
+
+            const std::uint32_t* operator[](std::size_t n) const noexcept {
+                return m_table[n];
+            }
+
+        }; // class crc32c_tables
+
+        inline const crc32c_tables& get_crc32c_tables() noexcept {
+            static const crc32c_tables tables;
+            return tables;
+        }
+
+        inline std::uint32_t crc32c_software(std::uint32_t crc, const char* data, std::size_t size) noexcept {
+            const auto& table = get_crc32c_tables();
+            const auto* p = reinterpret_cast<const unsigned char*>(data); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+
+            while (size >= 8) {
+                std::uint32_t lo = 0;
+                std::uint32_t hi = 0;
+                std::memcpy(&lo, p, 4);
+                std::memcpy(&hi, p + 4, 4);
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+                lo = __builtin_bswap32(lo);
+                hi = __builtin_bswap32(hi);
+#endif
+                lo ^= crc;
+                crc = table[7][lo & 0xffU] ^ table[6][(lo >> 8U) & 0xffU] ^
+                      table[5][(lo >> 16U) & 0xffU] ^ table[4][lo >> 24U] ^
+                      table[3][hi & 0xffU] ^ table[2][(hi >> 8U) & 0xffU] ^
+                      table[1][(hi >> 16U) & 0xffU] ^ table[0][hi >> 24U];
+                p += 8;
+                size -= 8;
+            }
+
+            while (size > 0) {
+                crc = (crc >> 8U) ^ table[0][(crc ^ *p) & 0xffU];
+                ++p;
+                --size;
+            }
+
+            return crc;
+        }
+
+#ifdef TGD_HEADER_CRC32C_SSE42
+        __attribute__((target("sse4.2")))
+        inline std::uint32_t crc32c_sse42(std::uint32_t crc, const char* data, std::size_t size) noexcept {
+# ifdef __x86_64__
+            std::uint64_t crc64 = crc;
+            while (size >= 8) {
+                std::uint64_t value = 0;
+                std::memcpy(&value, data, 8);
+                crc64 = _mm_crc32_u64(crc64, value);
+                data += 8;
+                size -= 8;
+            }
+            crc = static_cast<std::uint32_t>(crc64);
+# endif
+            while (size >= 4) {
+                std::uint32_t value = 0;
+                std::memcpy(&value, data, 4);
+                crc = _mm_crc32_u32(crc, value);
+                data += 4;
+                size -= 4;
+            }
+            while (size > 0) {
+                crc = _mm_crc32_u8(crc, static_cast<unsigned char>(*data));
+                ++data;
+                --size;
+            }
+            return crc;
+        }
+
+        inline bool has_sse42() noexcept {
+            static const bool result = __builtin_cpu_supports("sse4.2");
+            return result;
+        }
+#endif
+
+        /**
+         * Update the raw (not inverted) CRC-32C state with the data using
+         * the fastest implementation available on this CPU.
+         */
+        inline std::uint32_t crc32c_update(std::uint32_t crc, const char* data, std::size_t size) noexcept {
+#ifdef TGD_HEADER_CRC32C_SSE42
+            if (has_sse42()) {
+                return crc32c_sse42(crc, data, size);
+            }
+#endif
+            return crc32c_software(crc, data, size);
+        }
+
+    } // namespace detail
+
+    /**
+     * Calculate the CRC-32C (Castagnoli) checksum of the data. To get the
+     * checksum of data in several pieces, hand in the result for the
+     * previous pieces as crc.
+     *
+     * @param data Pointer to the data.
+     * @param size Size of the data.
+     * @param crc Checksum of the data before this one.
+     */
+    inline std::uint32_t crc32c(const char* data, std::size_t size, std::uint32_t crc = 0) noexcept {
+        return ~detail::crc32c_update(~crc, data, size);
+    }
+
+} // namespace tgd_header
+
+#undef TGD_HEADER_CRC32C_SSE42
+
+#endif // TGD_HEADER_CRC32C_HPP
@@ -0,0 +1,86 @@
+#ifndef TGD_HEADER_CURSOR_HPP
+#define TGD_HEADER_CURSOR_HPP
+
+/*****************************************************************************
+
+tgd_header - Encoding and decoding the Tiled Geographic Data Common Header.
+
+This file is from https://github.com/mapbox/tgd-header-lib where you can find
+more documentation.
+
+*****************************************************************************/
+
+/**
+ * @file cursor.hpp
+ *
+ * @brief Contains the cursor class template.
+ */
+
+#include "buffer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tgd_header {
+
+    /**
+     * Turns a positional source (one with a read_at() function like the
+     * pread_source) into a sequential source that can be used with a
+     * reader. The cursor keeps its own read position, so several cursors
+     * (for instance one per thread) can share the same positional source.
+     */
+    template <typename TSource>
+    class cursor {
+
+        const TSource& m_source;
+        std::uint64_t m_offset;
+
+    public:
+
+        /// Create a cursor reading from the source starting at offset.
+        explicit cursor(const TSource& source, std::uint64_t offset = 0) noexcept :
+            m_source(source),
+            m_offset(offset) {
+        }
+
+        /// The current read position.
+        std::uint64_t offset() const noexcept {
+            return m_offset;
+        }
+
+        /**
+         * Read exactly len bytes from the source and return the results.
+         * If there are no bytes left in the source, an empty buffer is
+         * returned.
+         */
+        buffer read(const std::size_t len) {
+            auto buffer = m_source.read_at(m_offset, len);
+            if (buffer) {
+                m_offset += len;
+            }
+            return buffer;
+        }
+
+        /**
+         * Read len bytes from the specified offset in the source without
+         * changing the read position.
+         */
+        buffer read_at(const std::uint64_t offset, const std::size_t len) const {
+            return m_source.read_at(offset, len);
+        }
+
+        /// Skip exactly len bytes from the source.
+        void skip(const std::size_t len) noexcept {
+            m_offset += len;
+        }
+
+        /// Set the read position to the specified offset.
+        void seek(const std::uint64_t offset) noexcept {
+            m_offset = offset;
+        }
+
+    }; // class cursor
+
+} // namespace tgd_header
+
+#endif // TGD_HEADER_CURSOR_HPP
@@ -0,0 +1,197 @@
+#ifndef TGD_HEADER_DEDUP_WRITER_HPP
+#define TGD_HEADER_DEDUP_WRITER_HPP
+
+/*****************************************************************************
+
+tgd_header - Encoding and decoding the Tiled Geographic Data Common Header.
+
+This file is from https://github.com/mapbox/tgd-header-lib where you can find
+more documentation.
+
+*****************************************************************************/
+
+/**
+ * @file dedup_writer.hpp
+ *
+ * @brief Contains the dedup_writer class.
+ *
+ * Tile sets often contain many layers with exactly the same content, for
+ * instance ocean tiles which only contain one polygon covering the whole
+ * tile. The dedup_writer stores such content only once, all other layers
+ * with the same content are written as reference records pointing to it
+ * (see layer::is_reference()). The reader and read_layer_at() resolve
+ * references transparently.
+ */
+
+#include "buffer.hpp"
+#include "encoding.hpp"
+#include "layer.hpp"
+#include "sha256.hpp"
+#include "types.hpp"
+#include "zlib_context.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+namespace tgd_header {
+
+    /**
+     * Writes layers into a sink storing identical content only once.
+     *
+     * The (encoded) wire content of every layer is hashed. The first layer
+     * with some content is written as usual, for all following layers
+     * with the same content, compression type, and original length a
+     * reference record is written instead, which contains the offset and
+     * length of the content written before. Content of 16 bytes or less
+     * (after padding) is never deduplicated, because a reference wouldn't
+     * be any smaller.
+     *
+     * The content is identified by the first 128 bits of its SHA-256
+     * digest together with its length, it is not compared byte by byte,
+     * because the content written before isn't available any more. A
+     * collision would silently give a layer the content of another one,
+     * so a cryptographic hash is used: The probability of any collision
+     * among n different contents is about n^2 / 2^129, which is about
+     * 1.5 * 10^-21 for a billion different contents.
+     *
+     * References contain offsets into the file, so everything written into
+     * the file must go through the dedup_writer. If the file already
+     * contains data, construct the dedup_writer with its size.
+     *
+     * @code
+     * file_sink sink{"out.tgd"};
+     * dedup_writer<file_sink> writer{sink};
+     * writer.write(layer); // as often as needed
+     * sink.close();
+     * @endcode
+     *
+     * @tparam TSink The sink type, see file_sink or string_sink.
+     */
+    template <typename TSink>
+    class dedup_writer {
+
+        struct content_key {
+            std::uint64_t hash;
+            std::uint64_t hash2;
+            content_length_type length;
+            content_length_type original_length;
+            layer_compression_type compression_type;
+
+            content_key(const char* content, content_length_type content_length, content_length_type content_original_length, layer_compression_type content_compression_type) noexcept :
+                length(content_length),
+                original_length(content_original_length),
+                compression_type(content_compression_type) {
+                const auto digest = sha256(content, content_length);
+                std::memcpy(&hash, digest.data(), sizeof(hash));
+                std::memcpy(&hash2, digest.data() + sizeof(hash), sizeof(hash2));
+            }
+
+            friend bool operator==(const content_key& lhs, const content_key& rhs) noexcept {
+                return lhs.hash == rhs.hash &&
+                       lhs.hash2 == rhs.hash2 &&
+                       lhs.length == rhs.length &&
+                       lhs.original_length == rhs.original_length &&
+                       lhs.compression_type == rhs.compression_type;
+            }
+        };
+
+        struct content_key_hash {
+            std::size_t operator()(const content_key& key) const noexcept {
+                return static_cast<std::size_t>(key.hash);
+            }
+        };
+
+        TSink& m_sink;
+        zlib_context m_context;
+        std::unordered_map<content_key, std::uint64_t, content_key_hash> m_contents;
+        std::uint64_t m_offset;
+        std::size_t m_layers = 0;
+        std::size_t m_references = 0;
+        std::uint64_t m_bytes_saved = 0;
+
+    public:
+
+        /**
+         * Construct a dedup_writer writing into the sink.
+         *
+         * @param sink The sink to write to.
+         * @param offset The current offset in the file the sink writes to,
+         *               ie. the number of bytes already in there.
+         */
+        explicit dedup_writer(TSink& sink, std::uint64_t offset = 0) :
+            m_sink(sink),
+            m_offset(offset) {
+        }
+
+        /// The zlib_context used for encoding the content of layers.
+        zlib_context& context() noexcept {
+            return m_context;
+        }
+
+        /**
+         * Write a layer, or a reference record if the same content was
+         * written before. The content of the layer is encoded if needed.
+         * If the layer is a reference, the referenced content is fetched.
+         *
+         * @returns The number of bytes written.
+         */
+        std::size_t write(layer& layer) {
+            layer.fetch_wire_content();
+            layer.encode_content(m_context);
+
+            const auto length = layer.wire_content_length();
+            std::size_t size = 0;
+            if (detail::padded_size(length) <= detail::reference_size) {
+                size = layer.write(m_sink, m_context);
+            } else {
+                const auto& content = layer.wire_content();
+                const content_key key{content.data(), length, layer.content_length(), layer.compression_type()};
+
+                const auto it = m_contents.find(key);
+                if (it == m_contents.end()) {
+                    m_contents.emplace(key, m_offset + detail::header_size + detail::padded_size(layer.name_length() + 1));
+                    size = layer.write(m_sink, m_context);
+                } else {
+                    size = layer.write_reference(m_sink, it->second, m_context);
+                    ++m_references;
+                    m_bytes_saved += detail::padded_size(length) - detail::reference_size;
+                }
+            }
+
+            ++m_layers;
+            m_offset += size;
+            return size;
+        }
+
+        /// The offset in the file the next record will be written to.
+        std::uint64_t offset() const noexcept {
+            return m_offset;
+        }
+
+        /// The number of layers written so far.
+        std::size_t layers() const noexcept {
+            return m_layers;
+        }
+
+        /// The number of layers written as reference records.
+        std::size_t references() const noexcept {
+            return m_references;
+        }
+
+        /// The number of bytes saved by writing references.
+        std::uint64_t bytes_saved() const noexcept {
+            return m_bytes_saved;
+        }
+
+        /// The number of different contents seen so far.
+        std::size_t unique_contents() const noexcept {
+            return m_contents.size();
+        }
+
+    }; // class dedup_writer
+
+} // namespace tgd_header
+
+#endif // TGD_HEADER_DEDUP_WRITER_HPP
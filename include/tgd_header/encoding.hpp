@@ -158,12 +158,14 @@ namespace tgd_header {
         // XXX this is preliminary and needs to be optimized
         enum offset : std::size_t {
             content_type     =  4,
+            flags            =  6,
             name_length      =  8,
             compression_type = 10,
             tile             = 11,
             tile_zoom        = 11,
             tile_x           = 12,
             tile_y           = 16,
+            checksum         = 20,
             original_length  = 24,
             content_length   = 28,
             end              = 32
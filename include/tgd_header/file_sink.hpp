@@ -18,22 +18,50 @@ more documentation.
 
 #include "buffer.hpp"
 #include "encoding.hpp"
+#include "exceptions.hpp"
 #include "file.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cerrno>
 #include <cstdint>
 #include <fcntl.h>
+#include <iterator>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <system_error>
 #include <unistd.h>
+#include <utility>
+
+#ifdef __linux__
+# include <sys/sendfile.h>
+#endif
 
 namespace tgd_header {
 
+    /**
+     * Sink for writing layers into a file. The file is opened on
+     * construction and closed on destruction (unless the filename is
+     * empty or "-" in which case STDOUT is used).
+     *
+     * All parts of a layer (header, name, content, and padding) are written
+     * with a single writev() system call. If a batch size is set on
+     * construction, data is collected in an internal buffer and only
+     * written once the buffer is larger than the batch size, so many small
+     * layers are written with one system call. In that case you have to
+     * call flush() or close() to make sure everything is written. The
+     * destructor will try to flush the data, but errors are ignored there.
+     */
     class file_sink : public detail::file {
 
+        std::string m_pending{};
+        std::size_t m_batch_size = 0;
+
         static int open_file_or_stdout(const std::string& filename) {
             if (filename.empty() || filename == "-") {
                 return 1;
@@ -42,6 +70,11 @@ namespace tgd_header {
             return open_file(filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644); // NOLINT(hicpp-signed-bitwise)
         }
 
+        static const char* zeros() noexcept {
+            static const char pad[detail::align_bytes] = {0};
+            return pad;
+        }
+
         void write_impl(const char* data, std::size_t size) const {
             const auto write_length = ::write(fd(), data, size);
 
@@ -50,26 +83,271 @@ namespace tgd_header {
             }
         }
 
+        // Write out all the data in the iovecs. Empty iovecs are allowed.
+        void writev_impl(::iovec* iov, int count) const {
+            while (count > 0) {
+                const auto write_length = ::writev(fd(), iov, count);
+                if (write_length < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw std::system_error{errno, std::system_category(), "Error writing to file: "};
+                }
+
+                // Skip over everything that was written. There might be a
+                // partial write, so adjust the first unfinished iovec.
+                auto written = static_cast<std::size_t>(write_length);
+                while (count > 0 && written >= iov->iov_len) {
+                    written -= iov->iov_len;
+                    ++iov;
+                    --count;
+                }
+                if (count > 0) {
+                    iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+                    iov->iov_len -= written;
+                }
+            }
+        }
+
+        static ::iovec make_iovec(const char* data, std::size_t size) noexcept {
+            return ::iovec{const_cast<char*>(data), size}; // NOLINT(cppcoreguidelines-pro-type-const-cast)
+        }
+
+        bool batching() const noexcept {
+            return m_batch_size > 0;
+        }
+
+        void flush_if_full() {
+            if (m_pending.size() >= m_batch_size) {
+                flush();
+            }
+        }
+
+        // Is this an error where copy_file_range() or sendfile() are not
+        // supported for these files, so the next method should be tried?
+        static bool not_supported(int error) noexcept {
+            return error == EINVAL || error == EXDEV || error == ENOSYS ||
+                   error == EOPNOTSUPP || error == EBADF;
+        }
+
+        // Copy as much of the range as possible inside the kernel. Updates
+        // offset and len. Returns false if the rest has to be copied in
+        // some other way.
+        bool copy_in_kernel(int input_fd, std::uint64_t& offset, std::uint64_t& len) const {
+#ifdef __linux__
+            bool use_copy_file_range = true;
+            while (len > 0) {
+                ssize_t copied = 0;
+                if (use_copy_file_range) {
+                    loff_t off_in = static_cast<loff_t>(offset);
+                    copied = ::copy_file_range(input_fd, &off_in, fd(), nullptr, static_cast<std::size_t>(len), 0);
+                } else {
+                    off_t off_in = static_cast<off_t>(offset);
+                    copied = ::sendfile(fd(), input_fd, &off_in, static_cast<std::size_t>(len));
+                }
+
+                if (copied < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    if (not_supported(errno)) {
+                        if (use_copy_file_range) {
+                            use_copy_file_range = false;
+                            continue;
+                        }
+                        return false;
+                    }
+                    throw std::system_error{errno, std::system_category(), "Error copying to file: "};
+                }
+
+                if (copied == 0) {
+                    throw format_error{"unexpected end of file"};
+                }
+
+                offset += static_cast<std::uint64_t>(copied);
+                len -= static_cast<std::uint64_t>(copied);
+            }
+            return true;
+#else
+            (void)input_fd;
+            (void)offset;
+            (void)len;
+            return false;
+#endif
+        }
+
+        // Copy the range by reading it into memory and writing it out.
+        void copy_through_buffer(int input_fd, std::uint64_t offset, std::uint64_t len) const {
+            constexpr const std::size_t chunk_size = 64UL * 1024UL;
+            std::unique_ptr<char[]> chunk{new char[chunk_size]}; // NOLINT(modernize-make-unique) (not available in C++11)
+
+            while (len > 0) {
+                const auto read_length = ::pread(input_fd, chunk.get(), static_cast<std::size_t>(std::min<std::uint64_t>(len, chunk_size)), static_cast<off_t>(offset));
+                if (read_length < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw std::system_error{errno, std::system_category(), "Read error: "};
+                }
+                if (read_length == 0) {
+                    throw format_error{"unexpected end of file"};
+                }
+                write_impl(chunk.get(), static_cast<std::size_t>(read_length));
+                offset += static_cast<std::uint64_t>(read_length);
+                len -= static_cast<std::uint64_t>(read_length);
+            }
+        }
+
     public:
 
-        explicit file_sink(const std::string& filename) :
-            file(open_file_or_stdout(filename)) {
+        /**
+         * Construct file_sink writing into the specified file.
+         *
+         * @param filename Name of the output file. If empty or "-", STDOUT
+         *                 is used.
+         * @param batch_size Collect data until there are at least this
+         *                   many bytes and write them in one go. Set to 0
+         *                   (the default) to write everything immediately.
+         */
+        explicit file_sink(const std::string& filename, std::size_t batch_size = 0) :
+            file(open_file_or_stdout(filename)),
+            m_batch_size(batch_size) {
+            if (batching()) {
+                m_pending.reserve(batch_size);
+            }
+        }
+
+        file_sink(const file_sink&) = delete;
+        file_sink& operator=(const file_sink&) = delete;
+
+        file_sink(file_sink&& other) noexcept :
+            file(std::move(other)),
+            m_pending(std::move(other.m_pending)),
+            m_batch_size(other.m_batch_size) {
+            other.m_pending.clear();
+        }
+
+        file_sink& operator=(file_sink&& other) noexcept {
+            try {
+                flush();
+            } catch (...) {
+                // ignore exceptions so that the move assignment
+                // can be noexcept
+            }
+            file::operator=(std::move(other));
+            m_pending = std::move(other.m_pending);
+            m_batch_size = other.m_batch_size;
+            other.m_pending.clear();
+            return *this;
+        }
+
+        ~file_sink() noexcept {
+            try {
+                flush();
+            } catch (...) {
+                // ignore errors so that the destructor can be noexcept
+            }
+        }
+
+        /// Write out any data collected internally.
+        void flush() {
+            if (!m_pending.empty()) {
+                write_impl(m_pending.data(), m_pending.size());
+                m_pending.clear();
+            }
+        }
+
+        /// Flush data and close the file.
+        void close() {
+            flush();
+            file::close();
         }
 
-        void write(const buffer& buffer) const {
-            write_impl(buffer.data(), buffer.size());
+        /// Write the contents of the buffer to the file.
+        void write(const buffer& buffer) {
+            if (!batching()) {
+                write_impl(buffer.data(), buffer.size());
+                return;
+            }
+
+            m_pending.append(buffer.data(), buffer.size());
+            flush_if_full();
         }
 
-        void padding(std::size_t size) const {
+        /// Write size zero bytes to the file for padding.
+        void padding(std::size_t size) {
             assert(size < detail::align_bytes);
 
-            static const char pad[detail::align_bytes] = {0};
+            if (!batching()) {
+                write_impl(zeros(), size);
+                return;
+            }
+
+            m_pending.append(size, '\0');
+            flush_if_full();
+        }
 
-            write_impl(pad, size);
+        /**
+         * Write the parts of a layer to the file. The name and content
+         * are padded as needed. This is usually called through
+         * layer::write().
+         */
+        void write_layer(const buffer& header, const buffer& name, const buffer& content) {
+            std::array<::iovec, 6> iov{{
+                make_iovec(m_pending.data(), m_pending.size()),
+                make_iovec(header.data(), header.size()),
+                make_iovec(name.data(), name.size()),
+                make_iovec(zeros(), detail::padding(name.size())),
+                make_iovec(content.data(), content.size()),
+                make_iovec(zeros(), detail::padding(content.size()))
+            }};
+
+            if (batching() && content.size() < m_batch_size) {
+                for (auto it = std::next(iov.begin()); it != iov.end(); ++it) {
+                    m_pending.append(static_cast<const char*>(it->iov_base), it->iov_len);
+                }
+                flush_if_full();
+                return;
+            }
+
+            writev_impl(iov.data(), static_cast<int>(iov.size()));
+            m_pending.clear();
+        }
+
+        /**
+         * Copy len bytes starting at offset in the input file to this file.
+         * Use this to pass whole layer records through unchanged (see
+         * reader::layer_offset() and layer::record_size()), consecutive
+         * records can be copied in one go.
+         *
+         * The data is copied inside the kernel with copy_file_range() or,
+         * if that isn't possible, with sendfile() (on Linux only). As a
+         * last resort the data is read into memory and written out. If
+         * the data is already in memory (for instance from a mmap_source)
+         * use write() instead.
+         *
+         * @throws format_error If the input file ends before len bytes
+         *                      were copied.
+         * @throws std::system_error If there was an error reading or
+         *                           writing.
+         */
+        void copy_from(const detail::file& input, std::uint64_t offset, std::uint64_t len) {
+            flush();
+            if (!copy_in_kernel(input.fd(), offset, len)) {
+                copy_through_buffer(input.fd(), offset, len);
+            }
         }
 
     }; // file_sink
 
+    /**
+     * Overload of the customization point in layer.hpp so that
+     * layer::write() uses file_sink::write_layer().
+     */
+    inline void write_layer_parts(file_sink& sink, const buffer& header, const buffer& name, const buffer& content) {
+        sink.write_layer(header, name, content);
+    }
+
 } // namespace tgd_header
 
 #endif // TGD_HEADER_FILE_SINK_HPP
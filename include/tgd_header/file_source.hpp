@@ -18,8 +18,10 @@ more documentation.
 
 #include "buffer.hpp"
 #include "file.hpp"
+#include "pread_source.hpp"
 
 #include <cstddef>
+#include <cstdint>
 #include <fcntl.h>
 #include <stdexcept>
 #include <string>
@@ -89,6 +91,23 @@ namespace tgd_header {
             }
         }
 
+        /**
+         * Read exactly len bytes starting at offset in the file without
+         * changing the read position. This doesn't work on STDIN. See
+         * pread_source::read_at() for details.
+         */
+        buffer read_at(const std::uint64_t offset, const std::size_t len) const {
+            return detail::pread_buffer(fd(), offset, len);
+        }
+
+        /// Set the read position to the specified offset.
+        void seek(const std::size_t offset) const {
+            const auto result = ::lseek(fd(), static_cast<off_t>(offset), SEEK_SET);
+            if (result < 0) {
+                throw std::system_error{errno, std::system_category(), "Seek error: "};
+            }
+        }
+
     }; // file_source
 
 } // namespace tgd_header
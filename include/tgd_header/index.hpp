@@ -0,0 +1,496 @@
+#ifndef TGD_HEADER_INDEX_HPP
+#define TGD_HEADER_INDEX_HPP
+
+/*****************************************************************************
+
+tgd_header - Encoding and decoding the Tiled Geographic Data Common Header.
+
+This file is from https://github.com/mapbox/tgd-header-lib where you can find
+more documentation.
+
+*****************************************************************************/
+
+/**
+ * @file index.hpp
+ *
+ * @brief Contains the layer_index and layer_index_builder classes.
+ *
+ * A layer index is stored in a separate (sidecar) file next to the tile
+ * file. It maps the tile address, name, and content type of each layer
+ * to the offset and size of the layer in the tile file. All numbers are
+ * stored in little endian byte order. The index looks like this:
+ *
+ * * 16 byte header: The magic "TGI0", the number of entries (uint32), and
+ *   the size of the name table (uint64).
+ * * One 40 byte entry per layer sorted by zoom, x, y, name, and content
+ *   type: zoom (uint8), flags (uint8, bit 0 is set for reference records,
+ *   see layer::is_reference()), content type (uint16), name
+ *   length (uint16), two unused bytes, x (uint32), y (uint32), offset of
+ *   the name in the name table (uint32), four unused bytes, offset of the
+ *   layer in the tile file (uint64), and size of the layer (uint64).
+ * * The name table with all layer names (without '\0' bytes) one after
+ *   the other, padded to a multiple of 8 bytes.
+ */
+
+#include "buffer.hpp"
+#include "encoding.hpp"
+#include "exceptions.hpp"
+#include "layer.hpp"
+#include "tile.hpp"
+#include "tile_range.hpp"
+#include "types.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tgd_header {
+
+    namespace detail {
+
+        namespace index_header_offset {
+            constexpr const std::size_t count      =  4;
+            constexpr const std::size_t names_size =  8;
+            constexpr const std::size_t end        = 16;
+        } // namespace index_header_offset
+
+        namespace index_entry_offset {
+            constexpr const std::size_t tile_zoom    =  0;
+            constexpr const std::size_t flags        =  1;
+            constexpr const std::size_t content_type =  2;
+            constexpr const std::size_t name_length  =  4;
+            constexpr const std::size_t tile_x       =  8;
+            constexpr const std::size_t tile_y       = 12;
+            constexpr const std::size_t name_offset  = 16;
+            constexpr const std::size_t layer_offset = 24;
+            constexpr const std::size_t layer_size   = 32;
+            constexpr const std::size_t end          = 40;
+        } // namespace index_entry_offset
+
+        template <typename T>
+        T get_value(const char* input) noexcept {
+            T value; // NOLINT(cppcoreguidelines-pro-type-member-init,hicpp-member-init)
+            get(input, &value);
+            return value;
+        }
+
+        inline int compare_tiles(const tile_address& a, const tile_address& b) noexcept {
+            if (a.zoom() != b.zoom()) {
+                return a.zoom() < b.zoom() ? -1 : 1;
+            }
+            if (a.x() != b.x()) {
+                return a.x() < b.x() ? -1 : 1;
+            }
+            if (a.y() != b.y()) {
+                return a.y() < b.y() ? -1 : 1;
+            }
+            return 0;
+        }
+
+        inline int compare_names(const char* a, std::size_t a_len, const char* b, std::size_t b_len) noexcept {
+            const auto result = std::memcmp(a, b, std::min(a_len, b_len));
+            if (result != 0) {
+                return result;
+            }
+            if (a_len == b_len) {
+                return 0;
+            }
+            return a_len < b_len ? -1 : 1;
+        }
+
+        namespace index_entry_flags {
+            constexpr const std::uint8_t reference = 0x01U;
+        } // namespace index_entry_flags
+
+    } // namespace detail
+
+    /**
+     * A view on one entry in a layer_index. This is only valid as long as
+     * the buffer the index was created from is valid.
+     */
+    class layer_index_entry {
+
+        const char* m_entry = nullptr;
+        const char* m_names = nullptr;
+
+    public:
+
+        /// Create an invalid entry which is returned if nothing was found.
+        layer_index_entry() noexcept = default;
+
+        layer_index_entry(const char* entry, const char* names) noexcept :
+            m_entry(entry),
+            m_names(names) {
+        }
+
+        /// Is this a valid entry?
+        explicit operator bool() const noexcept {
+            return m_entry != nullptr;
+        }
+
+        tile_address tile() const noexcept {
+            return tile_address{detail::get_value<std::uint8_t>(m_entry + detail::index_entry_offset::tile_zoom),
+                                detail::get_value<std::uint32_t>(m_entry + detail::index_entry_offset::tile_x),
+                                detail::get_value<std::uint32_t>(m_entry + detail::index_entry_offset::tile_y)};
+        }
+
+        layer_content_type content_type() const noexcept {
+            return detail::get_value<layer_content_type>(m_entry + detail::index_entry_offset::content_type);
+        }
+
+        name_length_type name_length() const noexcept {
+            return detail::get_value<name_length_type>(m_entry + detail::index_entry_offset::name_length);
+        }
+
+        /**
+         * The name of the layer. This is NOT '\0'-terminated, use
+         * name_length() to get the length.
+         */
+        const char* name() const noexcept {
+            return m_names + detail::get_value<std::uint32_t>(m_entry + detail::index_entry_offset::name_offset);
+        }
+
+        bool has_name(const char* name, std::size_t length) const noexcept {
+            return length == name_length() && !std::memcmp(this->name(), name, length);
+        }
+
+        bool has_name(const std::string& name) const noexcept {
+            return has_name(name.data(), name.size());
+        }
+
+        /// The offset of the layer in the tile file.
+        std::uint64_t offset() const noexcept {
+            return detail::get_value<std::uint64_t>(m_entry + detail::index_entry_offset::layer_offset);
+        }
+
+        /// The size of the layer in the tile file including padding.
+        std::uint64_t size() const noexcept {
+            return detail::get_value<std::uint64_t>(m_entry + detail::index_entry_offset::layer_size);
+        }
+
+        /**
+         * Is the layer a reference record? Its content is somewhere else
+         * in the tile file, so the record can't be copied as it is.
+         */
+        bool is_reference() const noexcept {
+            return (detail::get_value<std::uint8_t>(m_entry + detail::index_entry_offset::flags) & detail::index_entry_flags::reference) != 0;
+        }
+
+    }; // class layer_index_entry
+
+    /**
+     * Access to a layer index. The index data is not copied, it is
+     * accessed in place, so you can, for instance, read it using an
+     * mmap_source. The buffer must stay valid as long as the layer_index
+     * and any entries returned from it are used.
+     *
+     * Lookups use a binary search on the sorted entries.
+     */
+    class layer_index {
+
+        const char* m_entries = nullptr;
+        const char* m_names = nullptr;
+        std::size_t m_size = 0;
+
+        layer_index_entry get(std::size_t n) const noexcept {
+            return layer_index_entry{m_entries + n * detail::index_entry_offset::end, m_names};
+        }
+
+        // Find the first entry not less than the specified key.
+        std::size_t lower_bound(const tile_address& tile, const char* name, std::size_t length, layer_content_type type) const noexcept {
+            std::size_t first = 0;
+            std::size_t count = m_size;
+            while (count > 0) {
+                const auto step = count / 2;
+                const auto mid = first + step;
+                const auto e = get(mid);
+                int cmp = detail::compare_tiles(e.tile(), tile);
+                if (cmp == 0) {
+                    cmp = detail::compare_names(e.name(), e.name_length(), name, length);
+                }
+                if (cmp < 0 || (cmp == 0 && e.content_type() < type)) {
+                    first = mid + 1;
+                    count -= step + 1;
+                } else {
+                    count = step;
+                }
+            }
+            return first;
+        }
+
+        // Find the first entry with a tile not less than the specified one.
+        std::size_t lower_bound(const tile_address& tile) const noexcept {
+            return lower_bound(tile, "", 0, layer_content_type::unknown);
+        }
+
+    public:
+
+        /// The magic bytes at the beginning of an index.
+        static constexpr std::array<char, 4> magic() noexcept {
+            return {{'T', 'G', 'I', '0'}};
+        }
+
+        /**
+         * Create an index from the data in the buffer.
+         *
+         * @throws format_error If the data is not a valid index.
+         */
+        explicit layer_index(const buffer& data) {
+            if (data.size() < detail::index_header_offset::end ||
+                !std::equal(magic().begin(), magic().end(), data.data())) {
+                throw format_error{"not a layer index"};
+            }
+
+            const auto count = detail::get_value<std::uint32_t>(data.data() + detail::index_header_offset::count);
+            const auto names_size = detail::get_value<std::uint64_t>(data.data() + detail::index_header_offset::names_size);
+            const auto entries_size = static_cast<std::uint64_t>(count) * detail::index_entry_offset::end;
+
+            if (names_size > data.size() ||
+                detail::index_header_offset::end + entries_size + names_size > data.size()) {
+                throw format_error{"layer index too short"};
+            }
+
+            m_entries = data.data() + detail::index_header_offset::end;
+            m_names = m_entries + entries_size;
+            m_size = count;
+
+            for (std::size_t n = 0; n < m_size; ++n) {
+                const auto name_offset = detail::get_value<std::uint32_t>(m_entries + n * detail::index_entry_offset::end + detail::index_entry_offset::name_offset);
+                if (name_offset + static_cast<std::uint64_t>(get(n).name_length()) > names_size) {
+                    throw format_error{"invalid name in layer index"};
+                }
+            }
+        }
+
+        /// The number of entries in the index.
+        std::size_t size() const noexcept {
+            return m_size;
+        }
+
+        /// Is the index empty?
+        bool empty() const noexcept {
+            return m_size == 0;
+        }
+
+        /// Return the nth entry of the index.
+        layer_index_entry operator[](std::size_t n) const noexcept {
+            assert(n < m_size);
+            return get(n);
+        }
+
+        /**
+         * Find the layer with the specified tile address, name and content
+         * type.
+         *
+         * @returns The entry, an invalid entry if there is no such layer.
+         */
+        layer_index_entry find(const tile_address& tile, const char* name, std::size_t length, layer_content_type type) const noexcept {
+            const auto n = lower_bound(tile, name, length, type);
+            if (n == m_size) {
+                return layer_index_entry{};
+            }
+            const auto e = get(n);
+            if (e.tile() != tile || !e.has_name(name, length) || e.content_type() != type) {
+                return layer_index_entry{};
+            }
+            return e;
+        }
+
+        /**
+         * Find the first layer with the specified tile address and name.
+         * The content type doesn't matter.
+         *
+         * @returns The entry, an invalid entry if there is no such layer.
+         */
+        layer_index_entry find(const tile_address& tile, const char* name, std::size_t length) const noexcept {
+            const auto n = lower_bound(tile, name, length, layer_content_type::unknown);
+            if (n == m_size) {
+                return layer_index_entry{};
+            }
+            const auto e = get(n);
+            if (e.tile() != tile || !e.has_name(name, length)) {
+                return layer_index_entry{};
+            }
+            return e;
+        }
+
+        layer_index_entry find(const tile_address& tile, const std::string& name, layer_content_type type) const noexcept {
+            return find(tile, name.data(), name.size(), type);
+        }
+
+        layer_index_entry find(const tile_address& tile, const std::string& name) const noexcept {
+            return find(tile, name.data(), name.size());
+        }
+
+        /**
+         * Call func with every entry (as layer_index_entry) with a tile in
+         * the range. Only the parts of the index with tiles in the range
+         * are looked at: There is one binary search for every column
+         * (x coordinate) of the range which contains any tiles, empty
+         * columns are skipped. Entries are visited in index order.
+         */
+        template <typename TFunc>
+        void for_each_in(const tile_range& range, TFunc&& func) const {
+            std::uint64_t x = range.min_x();
+            while (x <= range.max_x()) {
+                auto n = lower_bound(tile_address{range.zoom(), static_cast<std::uint32_t>(x), range.min_y()});
+                if (n == m_size) {
+                    return;
+                }
+
+                const auto first = get(n).tile();
+                if (first.zoom() != range.zoom() || first.x() > range.max_x()) {
+                    return;
+                }
+                if (first.x() != x) {
+                    // nothing in this column, continue with the next one
+                    // that has any entries
+                    x = first.x();
+                    continue;
+                }
+
+                for (; n < m_size; ++n) {
+                    const auto e = get(n);
+                    const auto tile = e.tile();
+                    if (tile.zoom() != range.zoom() || tile.x() != x || tile.y() > range.max_y()) {
+                        break;
+                    }
+                    func(e);
+                }
+                ++x;
+            }
+        }
+
+        /**
+         * Call func with every entry (as layer_index_entry) with a tile on
+         * a zoom level from min_zoom to max_zoom (inclusive) intersecting
+         * the bounding box. See the other for_each_in() for details.
+         */
+        template <typename TFunc>
+        void for_each_in(std::uint8_t min_zoom, std::uint8_t max_zoom, const geo_bbox& bbox, TFunc&& func) const {
+            for (unsigned int zoom = min_zoom; zoom <= max_zoom; ++zoom) {
+                for_each_in(tile_range{static_cast<std::uint8_t>(zoom), bbox}, func);
+            }
+        }
+
+        /**
+         * Get all entries with a tile on a zoom level from min_zoom to
+         * max_zoom (inclusive) intersecting the bounding box (default:
+         * the whole world).
+         */
+        std::vector<layer_index_entry> query(std::uint8_t min_zoom, std::uint8_t max_zoom, const geo_bbox& bbox = geo_bbox{}) const {
+            std::vector<layer_index_entry> result;
+            for_each_in(min_zoom, max_zoom, bbox, [&result](const layer_index_entry& entry) {
+                result.push_back(entry);
+            });
+            return result;
+        }
+
+    }; // class layer_index
+
+    /**
+     * Collects information about layers and writes it out as a layer
+     * index.
+     */
+    class layer_index_builder {
+
+        struct item {
+            tile_address tile;
+            layer_content_type content_type;
+            std::string name;
+            std::uint64_t offset;
+            std::uint64_t size;
+            bool reference;
+        };
+
+        std::vector<item> m_items;
+
+    public:
+
+        /// Add a layer stored at the specified offset to the index.
+        void add(const tile_address& tile, layer_content_type type, std::string name, std::uint64_t offset, std::uint64_t size, bool reference = false) {
+            if (name.size() > std::numeric_limits<name_length_type>::max()) {
+                throw format_error{"name too long"};
+            }
+            m_items.push_back(item{tile, type, std::move(name), offset, size, reference});
+        }
+
+        /**
+         * Add a layer stored at the specified offset to the index. Usually
+         * the offset comes from reader::layer_offset().
+         */
+        void add(const layer& layer, std::uint64_t offset) {
+            add(layer.tile(), layer.content_type(), std::string(layer.name(), layer.name_length()), offset, layer.record_size(), layer.is_reference());
+        }
+
+        /// The number of layers added so far.
+        std::size_t size() const noexcept {
+            return m_items.size();
+        }
+
+        /**
+         * Write out the index to the sink. This sorts the entries first.
+         *
+         * @returns The number of bytes written.
+         * @throws format_error If there are too many layers or names.
+         */
+        template <typename TSink>
+        std::size_t write(TSink& sink) {
+            if (m_items.size() > std::numeric_limits<std::uint32_t>::max()) {
+                throw format_error{"too many layers for index"};
+            }
+
+            std::sort(m_items.begin(), m_items.end(), [](const item& a, const item& b) {
+                int cmp = detail::compare_tiles(a.tile, b.tile);
+                if (cmp == 0) {
+                    cmp = detail::compare_names(a.name.data(), a.name.size(), b.name.data(), b.name.size());
+                }
+                return cmp < 0 || (cmp == 0 && a.content_type < b.content_type);
+            });
+
+            std::string names;
+            std::string entries(m_items.size() * detail::index_entry_offset::end, '\0');
+
+            char* out = &entries[0];
+            for (const auto& item : m_items) {
+                if (names.size() + item.name.size() > std::numeric_limits<std::uint32_t>::max()) {
+                    throw format_error{"names too large for index"};
+                }
+                detail::set(item.tile.zoom(), out + detail::index_entry_offset::tile_zoom);
+                detail::set(item.reference ? detail::index_entry_flags::reference : std::uint8_t{0}, out + detail::index_entry_offset::flags);
+                detail::set(item.content_type, out + detail::index_entry_offset::content_type);
+                detail::set(static_cast<name_length_type>(item.name.size()), out + detail::index_entry_offset::name_length);
+                detail::set(item.tile.x(), out + detail::index_entry_offset::tile_x);
+                detail::set(item.tile.y(), out + detail::index_entry_offset::tile_y);
+                detail::set(static_cast<std::uint32_t>(names.size()), out + detail::index_entry_offset::name_offset);
+                detail::set(item.offset, out + detail::index_entry_offset::layer_offset);
+                detail::set(item.size, out + detail::index_entry_offset::layer_size);
+                names.append(item.name);
+                out += detail::index_entry_offset::end;
+            }
+            names.append(detail::padding(names.size()), '\0');
+
+            std::array<char, detail::index_header_offset::end> header{};
+            std::copy_n(layer_index::magic().begin(), 4, header.begin());
+            detail::set(static_cast<std::uint32_t>(m_items.size()), &header[detail::index_header_offset::count]);
+            detail::set(static_cast<std::uint64_t>(names.size()), &header[detail::index_header_offset::names_size]);
+
+            sink.write(buffer{header});
+            sink.write(buffer{entries.data(), entries.size()});
+            sink.write(buffer{names.data(), names.size()});
+
+            return header.size() + entries.size() + names.size();
+        }
+
+    }; // class layer_index_builder
+
+} // namespace tgd_header
+
+#endif // TGD_HEADER_INDEX_HPP
@@ -0,0 +1,311 @@
+#ifndef TGD_HEADER_IO_URING_HPP
+#define TGD_HEADER_IO_URING_HPP
+
+/*****************************************************************************
+
+tgd_header - Encoding and decoding the Tiled Geographic Data Common Header.
+
+This file is from https://github.com/mapbox/tgd-header-lib where you can find
+more documentation.
+
+*****************************************************************************/
+
+/**
+ * @file io_uring.hpp
+ *
+ * @brief Contains a minimal wrapper around the Linux io_uring interface
+ *        used by uring_source and uring_sink.
+ *
+ * This uses the system calls directly, liburing is not needed. Only
+ * available on Linux.
+ */
+
+#include <linux/io_uring.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+namespace tgd_header {
+
+    namespace detail {
+
+        /**
+         * An io_uring instance with its submission and completion queues.
+         * This is not thread-safe.
+         */
+        class io_uring {
+
+            // Pointers into the shared submission queue ring.
+            struct submission_queue {
+                unsigned* head = nullptr;
+                unsigned* tail = nullptr;
+                unsigned* mask = nullptr;
+                unsigned* array = nullptr;
+                unsigned entries = 0;
+            };
+
+            // Pointers into the shared completion queue ring.
+            struct completion_queue {
+                unsigned* head = nullptr;
+                unsigned* tail = nullptr;
+                unsigned* mask = nullptr;
+                ::io_uring_cqe* cqes = nullptr;
+            };
+
+            int m_fd = -1;
+
+            void* m_sq_ring = nullptr;
+            std::size_t m_sq_ring_size = 0;
+            void* m_cq_ring = nullptr;
+            std::size_t m_cq_ring_size = 0;
+            ::io_uring_sqe* m_sqes = nullptr;
+            std::size_t m_sqes_size = 0;
+
+            submission_queue m_sq{};
+            completion_queue m_cq{};
+
+            // Number of entries queued but not yet submitted to the kernel.
+            unsigned m_to_submit = 0;
+
+            // Number of submitted entries whose completion hasn't been
+            // collected yet.
+            std::size_t m_in_flight = 0;
+
+            bool m_buffers_registered = false;
+
+            static int setup(unsigned entries, ::io_uring_params* params) noexcept {
+                return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+            }
+
+            int enter(unsigned to_submit, unsigned min_complete, unsigned flags) noexcept {
+                return static_cast<int>(::syscall(__NR_io_uring_enter, m_fd, to_submit, min_complete, flags, nullptr, 0));
+            }
+
+            template <typename T>
+            static T* at(void* base, std::uint32_t offset) noexcept {
+                return reinterpret_cast<T*>(static_cast<char*>(base) + offset); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+            }
+
+            static void* map(std::size_t size, int fd, off_t offset) {
+                void* ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset); // NOLINT(hicpp-signed-bitwise)
+                if (ptr == MAP_FAILED) { // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
+                    throw std::system_error{errno, std::system_category(), "io_uring mmap failed: "};
+                }
+                return ptr;
+            }
+
+            void cleanup() noexcept {
+                if (m_sqes) {
+                    ::munmap(m_sqes, m_sqes_size);
+                }
+                if (m_cq_ring && m_cq_ring != m_sq_ring) {
+                    ::munmap(m_cq_ring, m_cq_ring_size);
+                }
+                if (m_sq_ring) {
+                    ::munmap(m_sq_ring, m_sq_ring_size);
+                }
+                if (m_fd >= 0) {
+                    ::close(m_fd);
+                }
+            }
+
+        public:
+
+            /**
+             * Create an io_uring with (at least) the specified number of
+             * submission queue entries.
+             *
+             * @throws std::system_error If io_uring is not available.
+             */
+            explicit io_uring(unsigned entries) {
+                ::io_uring_params params; // NOLINT(cppcoreguidelines-pro-type-member-init,hicpp-member-init)
+                std::memset(&params, 0, sizeof(params));
+
+                m_fd = setup(entries, &params);
+                if (m_fd < 0) {
+                    throw std::system_error{errno, std::system_category(), "io_uring_setup failed: "};
+                }
+
+                try {
+                    m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+                    m_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(::io_uring_cqe);
+
+                    if (params.features & IORING_FEAT_SINGLE_MMAP) { // NOLINT(hicpp-signed-bitwise)
+                        m_sq_ring_size = std::max(m_sq_ring_size, m_cq_ring_size);
+                        m_sq_ring = map(m_sq_ring_size, m_fd, IORING_OFF_SQ_RING);
+                        m_cq_ring = m_sq_ring;
+                    } else {
+                        m_sq_ring = map(m_sq_ring_size, m_fd, IORING_OFF_SQ_RING);
+                        m_cq_ring = map(m_cq_ring_size, m_fd, IORING_OFF_CQ_RING);
+                    }
+
+                    m_sqes_size = params.sq_entries * sizeof(::io_uring_sqe);
+                    m_sqes = static_cast<::io_uring_sqe*>(map(m_sqes_size, m_fd, IORING_OFF_SQES));
+                } catch (...) {
+                    cleanup();
+                    throw;
+                }
+
+                m_sq.head = at<unsigned>(m_sq_ring, params.sq_off.head);
+                m_sq.tail = at<unsigned>(m_sq_ring, params.sq_off.tail);
+                m_sq.mask = at<unsigned>(m_sq_ring, params.sq_off.ring_mask);
+                m_sq.array = at<unsigned>(m_sq_ring, params.sq_off.array);
+                m_sq.entries = params.sq_entries;
+
+                m_cq.head = at<unsigned>(m_cq_ring, params.cq_off.head);
+                m_cq.tail = at<unsigned>(m_cq_ring, params.cq_off.tail);
+                m_cq.mask = at<unsigned>(m_cq_ring, params.cq_off.ring_mask);
+                m_cq.cqes = at<::io_uring_cqe>(m_cq_ring, params.cq_off.cqes);
+            }
+
+            io_uring(const io_uring&) = delete;
+            io_uring& operator=(const io_uring&) = delete;
+
+            io_uring(io_uring&&) = delete;
+            io_uring& operator=(io_uring&&) = delete;
+
+            ~io_uring() noexcept {
+                cleanup();
+            }
+
+            /// The number of entries in the submission queue.
+            unsigned entries() const noexcept {
+                return m_sq.entries;
+            }
+
+            /// The number of operations submitted but not completed.
+            std::size_t in_flight() const noexcept {
+                return m_in_flight + m_to_submit;
+            }
+
+            /**
+             * Register buffers with the kernel for use with the fixed read
+             * and write operations.
+             *
+             * @returns false if the buffers could not be registered, for
+             *          instance because of resource limits. In that case
+             *          use the normal operations.
+             */
+            bool register_buffers(const std::vector<::iovec>& iovecs) noexcept {
+                const auto result = ::syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_BUFFERS,
+                                              iovecs.data(), static_cast<unsigned>(iovecs.size()));
+                m_buffers_registered = result == 0;
+                return m_buffers_registered;
+            }
+
+            bool buffers_registered() const noexcept {
+                return m_buffers_registered;
+            }
+
+            /**
+             * Queue a read or write operation. The operation is sent to the
+             * kernel with the next call to submit() or wait().
+             *
+             * @param opcode IORING_OP_READ, IORING_OP_WRITE,
+             *               IORING_OP_READ_FIXED, or IORING_OP_WRITE_FIXED.
+             * @param fd File descriptor to read from or write to.
+             * @param data Buffer to read into or write from.
+             * @param len Number of bytes.
+             * @param offset Offset in the file.
+             * @param user_data Returned with the completion.
+             * @param buf_index Index of the registered buffer for the
+             *                  fixed operations.
+             */
+            void queue(std::uint8_t opcode, int fd, const void* data, unsigned len, std::uint64_t offset, std::uint64_t user_data, unsigned buf_index = 0) {
+                const unsigned tail = *m_sq.tail;
+                if (tail - __atomic_load_n(m_sq.head, __ATOMIC_ACQUIRE) >= m_sq.entries) {
+                    submit();
+                    if (tail - __atomic_load_n(m_sq.head, __ATOMIC_ACQUIRE) >= m_sq.entries) {
+                        throw std::system_error{EBUSY, std::system_category(), "io_uring submission queue full: "};
+                    }
+                }
+
+                const unsigned index = tail & *m_sq.mask;
+                ::io_uring_sqe& sqe = m_sqes[index];
+                std::memset(&sqe, 0, sizeof(sqe));
+                sqe.opcode = opcode;
+                sqe.fd = fd;
+                sqe.addr = reinterpret_cast<std::uint64_t>(data); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+                sqe.len = len;
+                sqe.off = offset;
+                sqe.user_data = user_data;
+                sqe.buf_index = static_cast<std::uint16_t>(buf_index);
+
+                m_sq.array[index] = index;
+                __atomic_store_n(m_sq.tail, tail + 1, __ATOMIC_RELEASE);
+                ++m_to_submit;
+            }
+
+            /// Send all queued operations to the kernel.
+            void submit() {
+                while (m_to_submit > 0) {
+                    const auto result = enter(m_to_submit, 0, 0);
+                    if (result < 0) {
+                        if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                            continue;
+                        }
+                        throw std::system_error{errno, std::system_category(), "io_uring_enter failed: "};
+                    }
+                    m_to_submit -= static_cast<unsigned>(result);
+                    m_in_flight += static_cast<std::size_t>(result);
+                }
+            }
+
+            /**
+             * Submit all queued operations and wait for the next completion.
+             * Must only be called if there are operations in flight.
+             *
+             * @returns The completion queue entry.
+             */
+            ::io_uring_cqe wait() {
+                while (true) {
+                    const unsigned head = *m_cq.head;
+                    if (head != __atomic_load_n(m_cq.tail, __ATOMIC_ACQUIRE)) {
+                        const ::io_uring_cqe cqe = m_cq.cqes[head & *m_cq.mask];
+                        __atomic_store_n(m_cq.head, head + 1, __ATOMIC_RELEASE);
+                        --m_in_flight;
+                        return cqe;
+                    }
+
+                    const auto result = enter(m_to_submit, 1, IORING_ENTER_GETEVENTS);
+                    if (result < 0) {
+                        if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                            continue;
+                        }
+                        throw std::system_error{errno, std::system_category(), "io_uring_enter failed: "};
+                    }
+                    m_to_submit -= static_cast<unsigned>(result);
+                    m_in_flight += static_cast<std::size_t>(result);
+                }
+            }
+
+        }; // class io_uring
+
+    } // namespace detail
+
+    /**
+     * Check whether io_uring can be used on this system. It might not be
+     * available because the kernel is too old or because it has been
+     * disabled, for instance in containers.
+     */
+    inline bool io_uring_available() noexcept {
+        try {
+            detail::io_uring ring{1};
+            return true;
+        } catch (...) {
+            return false;
+        }
+    }
+
+} // namespace tgd_header
+
+#endif // TGD_HEADER_IO_URING_HPP
@@ -17,17 +17,18 @@ more documentation.
  */
 
 #include "buffer.hpp"
+#include "crc32c.hpp"
 #include "encoding.hpp"
 #include "exceptions.hpp"
 #include "tile.hpp"
 #include "types.hpp"
-
-#include <zlib.h>
+#include "zlib_context.hpp"
 
 #include <algorithm>
 #include <array>
 #include <cassert>
 #include <cstring>
+#include <functional>
 #include <limits>
 #include <string>
 #include <utility>
@@ -40,8 +41,132 @@ namespace tgd_header {
         output.append(data, size);
     }
 
+    // customization point for sinks that can write all parts of a layer
+    // in one go (see file_sink for an example)
+    template <typename TSink>
+    void write_layer_parts(TSink& sink, const buffer& header, const buffer& name, const buffer& content) {
+        sink.write(header);
+        sink.write(name);
+        sink.padding(detail::padding(name.size()));
+        sink.write(content);
+        sink.padding(detail::padding(content.size()));
+    }
+
+    class layer_view;
+
+    namespace detail {
+
+        // The zlib_context used by layer::load_content() if none is given.
+        // There is one per thread, so it is reused for all layers.
+        inline zlib_context& default_zlib_context() {
+            static thread_local zlib_context context;
+            return context;
+        }
+
+        /**
+         * Calculate the checksum of a layer record. It covers the header
+         * (with the checksum field set to zero), the name, the content,
+         * and the padding (which is always zero).
+         *
+         * @param header The header, header_size bytes.
+         * @param name The name including the '\0' at the end.
+         * @param name_size The length of the name including the '\0'.
+         * @param content The (encoded) content.
+         * @param content_size The length of the content without padding.
+         */
+        inline std::uint32_t record_checksum(const char* header, const char* name, std::size_t name_size, const char* content, std::size_t content_size) noexcept {
+            static const char zeros[align_bytes] = {0};
+
+            std::array<char, header_size> h; // NOLINT(cppcoreguidelines-pro-type-member-init,hicpp-member-init)
+            std::copy_n(header, header_size, h.begin());
+            set(std::uint32_t{0}, &h[offset::checksum]);
+
+            auto crc = crc32c(h.data(), h.size());
+            crc = crc32c(name, name_size, crc);
+            crc = crc32c(zeros, padding(name_size), crc);
+            crc = crc32c(content, content_size, crc);
+            return crc32c(zeros, padding(content_size), crc);
+        }
+
+        // The content of a reference record: the offset (uint64) and the
+        // length (uint32) of the referenced wire content in the same file
+        // and four unused bytes.
+        constexpr const std::size_t reference_size = 16;
+
+        inline std::array<char, reference_size> serialize_reference(std::uint64_t offset, content_length_type length) noexcept {
+            std::array<char, reference_size> data{};
+            set(offset, &data[0]);
+            set(length, &data[8]);
+            return data;
+        }
+
+        inline void parse_reference(const char* data, std::uint64_t* offset, content_length_type* length) noexcept {
+            get(data, offset);
+            get(data + 8, length);
+        }
+
+        // XXX needs to be decided in the specification
+        constexpr const std::size_t max_name_length = 1000;
+
+        /**
+         * Check the fields of the record header at data (header_size
+         * bytes) that can be checked without looking at the name or the
+         * content.
+         *
+         * @returns nullptr if the header is fine, an error message
+         *          otherwise.
+         */
+        inline const char* check_header(const char* data) noexcept {
+            if (std::memcmp(data, "TGD0", 4) != 0) {
+                return "magic error";
+            }
+
+            name_length_type name_length = 0;
+            get(data + offset::name_length, &name_length);
+            if (name_length > max_name_length) {
+                return "name too long";
+            }
+
+            layer_compression_type compression = layer_compression_type::uncompressed;
+            get(data + offset::compression_type, &compression);
+            if (compression != layer_compression_type::uncompressed &&
+                compression != layer_compression_type::zlib) {
+                return "unknown compression type";
+            }
+
+            layer_flags_type flags = 0;
+            get(data + offset::flags, &flags);
+            content_length_type content_length = 0;
+            get(data + offset::content_length, &content_length);
+            if ((flags & layer_flags::reference) != 0 && content_length != reference_size) {
+                return "invalid reference";
+            }
+
+            return nullptr;
+        }
+
+        /**
+         * Check the name of a record. There must be at least length + 1
+         * bytes at name.
+         *
+         * @returns nullptr if the name is fine, an error message otherwise.
+         */
+        inline const char* check_name(const char* name, name_length_type length) noexcept {
+            if (name[length] != '\0') {
+                return "name not terminated";
+            }
+            if (std::memchr(name, '\0', length) != nullptr) {
+                return "name contains zero byte";
+            }
+            return nullptr;
+        }
+
+    } // namespace detail
+
     class layer {
 
+        friend class layer_view;
+
         // XXX make sure that when this is set, there is always a zero-byte
         // at the end.
 
@@ -51,6 +176,9 @@ namespace tgd_header {
         buffer m_content{};
         buffer m_wire_content{};
 
+        // Called to get the wire content when it is first needed.
+        std::function<buffer()> m_wire_content_fetcher{};
+
         // XXX can we make sure that these are not too long internally, so
         // the user doesn't have to?
 
@@ -66,88 +194,89 @@ namespace tgd_header {
 
         tile_address m_tile{};
 
-        layer_content_type m_content_type = layer_content_type::unknown;
-
-        layer_compression_type m_compression_type = layer_compression_type::uncompressed;
+        // The checksum from the header of a layer that was read.
+        std::uint32_t m_checksum = 0;
 
-        bool m_valid = false;
+        // For reference records the offset of the wire content in the file.
+        std::uint64_t m_reference_offset = 0;
 
-        static void check_magic(const char* data) {
-            if (data[0] != 'T' ||
-                data[1] != 'G' ||
-                data[2] != 'D' ||
-                data[3] != '0') {
-                throw format_error{"magic error"};
-            }
-        }
+        layer_flags_type m_flags = 0;
 
-        static constexpr const size_t max_name_length = 1000; // XXX needs to be decided in the specification
+        layer_content_type m_content_type = layer_content_type::unknown;
 
-        // XXX shall we check that the content didn't get bigger and then use
-        // uncompressed data instead?
-        void encode_zlib() {
-            assert(m_content.size() < std::numeric_limits<unsigned long>::max());
-            unsigned long output_size = ::compressBound(static_cast<unsigned long>(m_content_length)); // NOLINT(google-runtime-int)
+        layer_compression_type m_compression_type = layer_compression_type::uncompressed;
 
-            mutable_buffer output{output_size};
+        bool m_valid = false;
 
-            const auto result = ::compress(
-                reinterpret_cast<unsigned char*>(output.data()), // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
-                &output_size,
-                reinterpret_cast<const unsigned char*>(m_content.data()), // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
-                static_cast<unsigned long>(m_content_length) // NOLINT(google-runtime-int)
-            );
+        bool m_checksum_verified = false;
 
-            if (result != Z_OK) {
-                throw zlib_error{std::string{"failed to compress data: "} + zError(result)};
-            }
+        void encode_zlib(zlib_context& context) {
+            auto output = context.compress(m_content.data(), m_content_length);
 
-            if (output_size > std::numeric_limits<content_length_type>::max()) {
+            if (output.size() > std::numeric_limits<content_length_type>::max()) {
                 throw zlib_error{"content too large for tile"};
             }
 
-            m_wire_content_length = static_cast<content_length_type>(output_size);
-            m_wire_content = buffer{std::move(output)};
+            m_wire_content_length = static_cast<content_length_type>(output.size());
+            m_wire_content = std::move(output);
         }
 
-        void decode_zlib() {
-            unsigned long raw_size = m_content_length; // NOLINT(google-runtime-int)
+        bool is_precompressed() const noexcept {
+            return m_content_type == layer_content_type::png ||
+                   m_content_type == layer_content_type::jpeg;
+        }
 
-            mutable_buffer mb{m_content_length};
+        bool saves_enough(unsigned int min_savings) const noexcept {
+            if (m_wire_content_length >= m_content_length) {
+                return false;
+            }
+            const std::uint64_t savings = m_content_length - m_wire_content_length;
+            return savings * 100 >= static_cast<std::uint64_t>(m_content_length) * min_savings;
+        }
 
-            const auto result = ::uncompress(
-                reinterpret_cast<unsigned char*>(mb.data()), // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
-                &raw_size,
-                reinterpret_cast<const unsigned char*>(m_wire_content.data()), // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
-                m_wire_content.size()
-            );
+        void encode_uncompressed() {
+            m_compression_type = layer_compression_type::uncompressed;
+            m_wire_content_length = m_content_length;
+            m_wire_content = buffer{m_content.data(), m_content.size()};
+        }
 
-            if (result != Z_OK) {
-                throw zlib_error{std::string{"failed to uncompress data: "} + zError(result)};
-            }
+        void decode_zlib(zlib_context& context) {
+            m_content = context.uncompress(m_wire_content.data(), m_wire_content.size(), m_content_length);
+        }
 
-            if (raw_size != m_content_length) {
-                throw format_error{"wrong original size on compressed data"};
+        // Fetch the referenced content and turn this layer into an
+        // ordinary layer with that content.
+        void resolve_reference() {
+            fetch_wire_content();
+            if (!is_reference()) {
+                return;
             }
-
-            m_content = buffer{std::move(mb)};
+            if (!m_wire_content && m_wire_content_length > 0) {
+                throw format_error{"content of reference not available"};
+            }
+            m_flags &= static_cast<layer_flags_type>(~layer_flags::reference);
+            m_reference_offset = 0;
         }
 
         std::array<char, detail::header_size> serialize_header() {
             std::array<char, detail::header_size> header{{'T', 'G', 'D', '0'}};
 
             detail::set(m_content_type, &header[detail::offset::content_type]);
+            detail::set(m_flags, &header[detail::offset::flags]);
             detail::set(m_name_length, &header[detail::offset::name_length]);
             detail::set(m_compression_type, &header[detail::offset::compression_type]);
             m_tile.serialize(header);
             detail::set(m_content_length, &header[detail::offset::original_length]);
-            detail::set(m_wire_content_length, &header[detail::offset::content_length]);
+            detail::set(is_reference() ? static_cast<content_length_type>(detail::reference_size) : m_wire_content_length,
+                        &header[detail::offset::content_length]);
 
             return header;
         }
 
     public:
 
+        static constexpr const size_t max_name_length = detail::max_name_length;
+
         layer() = default;
 
         layer(const char* data, std::uint64_t size) {
@@ -155,17 +284,18 @@ namespace tgd_header {
                 throw format_error{"incomplete header"};
             }
 
-            check_magic(data);
+            const char* error = detail::check_header(data);
+            if (error) {
+                throw format_error{error};
+            }
 
             detail::get(data + detail::offset::content_type, &m_content_type);
+            detail::get(data + detail::offset::flags, &m_flags);
+            detail::get(data + detail::offset::checksum, &m_checksum);
 
             m_tile = tile_address{data};
 
             detail::get(data + detail::offset::name_length, &m_name_length);
-            if (m_name_length > max_name_length) {
-                throw format_error{"name too long"};
-            }
-
             detail::get(data + detail::offset::compression_type, &m_compression_type);
             detail::get(data + detail::offset::original_length, &m_content_length);
             detail::get(data + detail::offset::content_length, &m_wire_content_length);
@@ -228,9 +358,16 @@ namespace tgd_header {
             return !std::strcmp(m_name.data(), str);
         }
 
+        // Set the name read from a record. The name length must already
+        // be set from the header.
         void set_name_internal(buffer&& buffer) {
-            assert(buffer.size() > 0);
-            assert(*(buffer.data() + buffer.size() - 1) == '\0');
+            if (buffer.size() <= m_name_length) {
+                throw format_error{"unexpected end of file"};
+            }
+            const char* error = detail::check_name(buffer.data(), m_name_length);
+            if (error) {
+                throw format_error{error};
+            }
             m_name = std::move(buffer);
         }
 
@@ -267,12 +404,51 @@ namespace tgd_header {
             return m_content;
         }
 
+        /**
+         * Load the content of the layer if it isn't there yet: The wire
+         * content is fetched (if needed) and decoded using the specified
+         * zlib_context. The result is cached, so this is only done once.
+         *
+         * For a layer from a reader the content can only be fetched while
+         * the layer is the current layer of that reader, see
+         * reader::next_layer().
+         *
+         * @throws std::logic_error If the content can't be fetched any more.
+         */
+        const buffer& load_content(zlib_context& context) {
+            decode_content(context);
+            return m_content;
+        }
+
+        /**
+         * Load the content of the layer if it isn't there yet: The wire
+         * content is fetched (if needed) and decoded. The result is
+         * cached, so this is only done once.
+         */
+        const buffer& load_content() {
+            return load_content(detail::default_zlib_context());
+        }
+
+        /**
+         * Move the content out of the layer. This is useful to turn it
+         * into a shared_buffer without copying it if the content is
+         * managed, for instance after decompression. The content of the
+         * layer is empty afterwards.
+         */
+        buffer release_content() noexcept {
+            buffer content;
+            swap(content, m_content);
+            return content;
+        }
+
         void set_content(buffer&& buffer) {
+            m_wire_content_fetcher = nullptr;
             m_content_length = static_cast<content_length_type>(buffer.size());
             m_content = std::move(buffer);
         }
 
         void set_content(const char* content, std::size_t length) {
+            m_wire_content_fetcher = nullptr;
             m_content_length = static_cast<content_length_type>(length);
             m_content = buffer{content, length};
         }
@@ -285,21 +461,163 @@ namespace tgd_header {
             return m_wire_content;
         }
 
+        /**
+         * Fetch the (still encoded) content if it isn't there yet and a
+         * fetcher is set.
+         */
+        const buffer& fetch_wire_content() {
+            if (m_wire_content_fetcher && !m_wire_content) {
+                auto fetcher = std::move(m_wire_content_fetcher);
+                m_wire_content_fetcher = nullptr;
+                m_wire_content = fetcher();
+            }
+            return m_wire_content;
+        }
+
         void set_wire_content(buffer&& buffer) {
+            m_wire_content_fetcher = nullptr;
             m_wire_content = std::move(buffer);
         }
 
+        /**
+         * Set a function that returns the wire content of this layer. It is
+         * called once when the wire content is first needed, for instance
+         * by load_content() or write(). The reader uses this so that
+         * content is only read from the source if it is used.
+         */
+        void set_wire_content_fetcher(std::function<buffer()> fetcher) {
+            m_wire_content_fetcher = std::move(fetcher);
+        }
+
+        /// Is there a fetcher for the wire content that hasn't been called?
+        bool has_wire_content_fetcher() const noexcept {
+            return static_cast<bool>(m_wire_content_fetcher);
+        }
+
+        layer_flags_type flags() const noexcept {
+            return m_flags;
+        }
+
+        /// Does (or will) the record of this layer contain a checksum?
+        bool has_checksum() const noexcept {
+            return (m_flags & layer_flags::checksum) != 0;
+        }
+
+        /**
+         * The checksum stored in the header of a layer that was read. Only
+         * meaningful if has_checksum() is true.
+         */
+        std::uint32_t checksum() const noexcept {
+            return m_checksum;
+        }
+
+        /**
+         * Enable or disable writing a checksum with this layer. The
+         * checksum is calculated in write().
+         */
+        void enable_checksum(bool enable = true) noexcept {
+            if (enable) {
+                m_flags |= layer_flags::checksum;
+            } else {
+                m_flags &= static_cast<layer_flags_type>(~layer_flags::checksum);
+            }
+        }
+
+        /**
+         * Check the checksum of a layer that was read against its data.
+         * The wire content is fetched if needed. This is done
+         * automatically when the content is decoded.
+         *
+         * @returns true if the checksum matches or there is no checksum.
+         */
+        bool verify_checksum() {
+            if (!has_checksum() || m_checksum_verified) {
+                return true;
+            }
+
+            const auto header = serialize_header();
+            if (is_reference()) {
+                const auto reference = detail::serialize_reference(m_reference_offset, m_wire_content_length);
+                m_checksum_verified = detail::record_checksum(header.data(), m_name.data(), m_name_length + 1UL,
+                                                              reference.data(), reference.size()) == m_checksum;
+                return m_checksum_verified;
+            }
+
+            fetch_wire_content();
+            m_checksum_verified = detail::record_checksum(header.data(), m_name.data(), m_name_length + 1UL,
+                                                          m_wire_content.data(), m_wire_content_length) == m_checksum;
+            return m_checksum_verified;
+        }
+
+        /**
+         * Is this a reference record? Its content is not stored in the
+         * record itself, but somewhere else in the same file (usually in
+         * an earlier record with identical content, see dedup_writer).
+         * When reading with the reader or read_layer_at() the content is
+         * fetched from there transparently, wire_content_length() is the
+         * length of the referenced content.
+         */
+        bool is_reference() const noexcept {
+            return (m_flags & layer_flags::reference) != 0;
+        }
+
+        /**
+         * The offset of the referenced wire content in the file. Only
+         * meaningful if is_reference() is true.
+         */
+        std::uint64_t reference_offset() const noexcept {
+            return m_reference_offset;
+        }
+
+        /**
+         * Turn this layer into a reference to wire content with the
+         * specified length at the offset in the file. This is used by the
+         * readers after reading a reference record.
+         */
+        void set_reference(std::uint64_t offset, content_length_type length) noexcept {
+            m_flags |= layer_flags::reference;
+            m_reference_offset = offset;
+            m_wire_content_length = length;
+        }
+
+        /**
+         * The number of bytes this layer takes up when written out
+         * including header, name, content, and padding. This is only
+         * correct once the wire content length is known, ie. after the
+         * content was encoded or the layer was read.
+         */
+        std::uint64_t record_size() const noexcept {
+            return detail::header_size +
+                   detail::padded_size(m_name_length + 1) +
+                   (is_reference() ? detail::reference_size : detail::padded_size(m_wire_content_length));
+        }
+
         // XXX it should be possible to do this magically in the background
         // when needed.
-        void encode_content() {
+        /**
+         * Encode the content (compressing it if needed) unless this was
+         * already done. Uses the specified zlib_context for compression,
+         * reuse it for many layers to save on initialization costs.
+         *
+         * If adaptive compression is enabled in the zlib_options of the
+         * context, the compression type might be changed to uncompressed
+         * if compression doesn't help.
+         */
+        void encode_content(zlib_context& context) {
             if (m_content && !m_wire_content) {
                 switch (m_compression_type) {
                     case layer_compression_type::uncompressed:
-                        m_wire_content_length = m_content_length;
-                        m_wire_content = buffer{m_content.data(), m_content.size()};
+                        encode_uncompressed();
                         break;
                     case layer_compression_type::zlib:
-                        encode_zlib();
+                        if (context.options().adaptive && is_precompressed()) {
+                            encode_uncompressed();
+                            break;
+                        }
+                        encode_zlib(context);
+                        if (context.options().adaptive && !saves_enough(context.options().min_savings)) {
+                            encode_uncompressed();
+                        }
                         break;
                     default:
                         throw format_error{"Unknown compression type (" + std::to_string(static_cast<int>(m_compression_type)) + ")"};
@@ -307,16 +625,33 @@ namespace tgd_header {
             }
         }
 
-        // XXX it should be possible to do this magically in the background
-        // when needed.
-        void decode_content() {
+        /**
+         * Encode the content (compressing it if needed) unless this was
+         * already done.
+         */
+        void encode_content() {
+            zlib_context context;
+            encode_content(context);
+        }
+
+        /**
+         * Decode the content (uncompressing it if needed) unless this was
+         * already done. The wire content is fetched first if needed. Uses
+         * the specified zlib_context for decompression, reuse it for many
+         * layers to save on initialization costs.
+         */
+        void decode_content(zlib_context& context) {
+            fetch_wire_content();
             if (m_wire_content && !m_content) {
+                if (!verify_checksum()) {
+                    throw format_error{"checksum mismatch"};
+                }
                 switch (m_compression_type) {
                     case layer_compression_type::uncompressed:
                         m_content = buffer{m_wire_content.data(), m_wire_content_length};
                         break;
                     case layer_compression_type::zlib:
-                        decode_zlib();
+                        decode_zlib(context);
                         break;
                     default:
                         throw format_error{"Unknown compression type (" + std::to_string(static_cast<int>(m_compression_type)) + ")"};
@@ -324,23 +659,88 @@ namespace tgd_header {
             }
         }
 
+        /**
+         * Decode the content (uncompressing it if needed) unless this was
+         * already done.
+         */
+        void decode_content() {
+            decode_content(detail::default_zlib_context());
+        }
+
+        /**
+         * Write the layer to the sink encoding the content first if needed
+         * using the specified zlib_context.
+         *
+         * References only make sense in the file they were read from, so
+         * if this is a reference, the referenced content is fetched and
+         * written out, and the layer isn't a reference any more.
+         *
+         * @returns The number of bytes written.
+         */
         template <typename TSink>
-        std::size_t write(TSink& sink) {
-            encode_content();
-
-            const auto header = serialize_header();
-            sink.write(buffer{header});
+        std::size_t write(TSink& sink, zlib_context& context) {
+            resolve_reference();
+            encode_content(context);
+
+            auto header = serialize_header();
+            if (has_checksum()) {
+                m_checksum = detail::record_checksum(header.data(), m_name.data(), m_name_length + 1UL,
+                                                     m_wire_content.data(), m_wire_content_length);
+                detail::set(m_checksum, &header[detail::offset::checksum]);
+            }
 
             assert(m_name_length > 0);
-            sink.write(m_name);
-            sink.padding(detail::padding(m_name.size()));
+            write_layer_parts(sink, buffer{header}, m_name, m_wire_content);
+
+            return detail::header_size +
+                   detail::padded_size(m_name.size()) +
+                   detail::padded_size(m_wire_content.size());
+        }
 
-            sink.write(m_wire_content);
-            sink.padding(detail::padding(m_wire_content.size()));
+        /**
+         * Write the layer to the sink encoding the content first if needed.
+         *
+         * @returns The number of bytes written.
+         */
+        template <typename TSink>
+        std::size_t write(TSink& sink) {
+            zlib_context context;
+            return write(sink, context);
+        }
+
+        /**
+         * Write a reference record for this layer to the sink instead of
+         * the layer itself. The reference points to wire content at the
+         * offset in the same file, which must be identical to the wire
+         * content of this layer (after encoding it using the specified
+         * zlib_context if needed). Usually this is called through the
+         * dedup_writer, which makes sure of that.
+         *
+         * @returns The number of bytes written.
+         */
+        template <typename TSink>
+        std::size_t write_reference(TSink& sink, std::uint64_t offset, zlib_context& context) {
+            resolve_reference();
+            encode_content(context);
+
+            const auto length = m_wire_content_length;
+            m_flags |= layer_flags::reference;
+            auto header = serialize_header();
+            m_flags &= static_cast<layer_flags_type>(~layer_flags::reference);
+
+            const auto reference = detail::serialize_reference(offset, length);
+            if (has_checksum()) {
+                const auto checksum = detail::record_checksum(header.data(), m_name.data(), m_name_length + 1UL,
+                                                              reference.data(), reference.size());
+                detail::set(checksum, &header[detail::offset::checksum]);
+            }
+
+            assert(m_name_length > 0);
+            write_layer_parts(sink, buffer{header}, m_name, buffer{reference.data(), reference.size()});
 
             return detail::header_size +
                    detail::padded_size(m_name.size()) +
-                   detail::padded_size(m_content.size());
+                   detail::reference_size;
         }
 
     }; // class layer
@@ -0,0 +1,356 @@
+#ifndef TGD_HEADER_LAYER_CACHE_HPP
+#define TGD_HEADER_LAYER_CACHE_HPP
+
+/*****************************************************************************
+
+tgd_header - Encoding and decoding the Tiled Geographic Data Common Header.
+
+This file is from https://github.com/mapbox/tgd-header-lib where you can find
+more documentation.
+
+*****************************************************************************/
+
+/**
+ * @file layer_cache.hpp
+ *
+ * @brief Contains the layer_cache class.
+ */
+
+#include "buffer.hpp"
+#include "layer.hpp"
+#include "shared_buffer.hpp"
+#include "tile.hpp"
+#include "zlib_context.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace tgd_header {
+
+    /**
+     * The key of a layer in the layer_cache. The file is any number the
+     * application uses to tell its files apart, for instance the position
+     * of the file in its list of open files.
+     */
+    struct layer_cache_key {
+
+        std::uint64_t file = 0;
+        tile_address tile{};
+        std::string name{};
+
+        layer_cache_key() = default;
+
+        layer_cache_key(std::uint64_t file_, const tile_address& tile_, std::string name_) :
+            file(file_),
+            tile(tile_),
+            name(std::move(name_)) {
+        }
+
+        /// The key for the layer in the file.
+        layer_cache_key(std::uint64_t file_, const layer& layer) :
+            file(file_),
+            tile(layer.tile()),
+            name(layer.name(), layer.name_length()) {
+        }
+
+        friend bool operator==(const layer_cache_key& lhs, const layer_cache_key& rhs) noexcept {
+            return lhs.file == rhs.file && lhs.tile == rhs.tile && lhs.name == rhs.name;
+        }
+
+        friend bool operator!=(const layer_cache_key& lhs, const layer_cache_key& rhs) noexcept {
+            return !(lhs == rhs);
+        }
+
+        std::size_t hash() const noexcept {
+            std::uint64_t h = std::hash<tile_address>{}(tile);
+            h ^= std::hash<std::string>{}(name) + 0x9e3779b97f4a7c15ULL + (h << 6U) + (h >> 2U);
+            h ^= (file + 0x9e3779b97f4a7c15ULL) * 0xbf58476d1ce4e5b9ULL;
+            return static_cast<std::size_t>(h ^ (h >> 31U));
+        }
+
+    }; // struct layer_cache_key
+
+    /// Counters of a layer_cache, see layer_cache::stats().
+    struct layer_cache_stats {
+
+        /// Number of lookups that found the layer.
+        std::uint64_t hits = 0;
+
+        /// Number of lookups that didn't find the layer.
+        std::uint64_t misses = 0;
+
+        /// Number of layers removed to stay inside the budget.
+        std::uint64_t evictions = 0;
+
+        /// Number of layers in the cache now.
+        std::size_t entries = 0;
+
+        /// Number of content bytes in the cache now.
+        std::size_t bytes = 0;
+
+    }; // struct layer_cache_stats
+
+    /**
+     * A thread-safe cache for decoded layer content with a budget for the
+     * memory used. Servers that read the same layers again and again can
+     * use it so that they don't have to uncompress them every time.
+     *
+     * The content is stored as shared_buffer, so it can be handed out to
+     * any number of threads without copying. Evicted content stays alive
+     * as long as somebody still uses it, it is then not counted in the
+     * budget any more.
+     *
+     * The cache is split into shards, each with its own lock and its own
+     * part of the budget, so that threads rarely wait for each other. In
+     * each shard the least recently used layers are evicted first. Only
+     * the size of the content is counted in the budget, not the overhead
+     * for managing it. Content larger than the budget of a shard is never
+     * cached.
+     *
+     * @code
+     * layer_cache cache{256 * 1024 * 1024};
+     * auto layer = read_layer_at(source, offset, false);
+     * auto content = cache.content(file_id, layer, context);
+     * @endcode
+     */
+    class layer_cache {
+
+        struct entry {
+            layer_cache_key key;
+            shared_buffer content;
+        };
+
+        struct key_hash {
+            std::size_t operator()(const layer_cache_key& key) const noexcept {
+                return key.hash();
+            }
+        };
+
+        using lru_list = std::list<entry>;
+
+        struct shard {
+            std::mutex mutex;
+
+            // most recently used entry first
+            lru_list entries;
+
+            std::unordered_map<layer_cache_key, lru_list::iterator, key_hash> map;
+
+            std::size_t bytes = 0;
+            std::uint64_t hits = 0;
+            std::uint64_t misses = 0;
+            std::uint64_t evictions = 0;
+        };
+
+        std::unique_ptr<shard[]> m_shards;
+        std::size_t m_num_shards;
+        std::size_t m_shard_budget;
+
+        shard& shard_for(const layer_cache_key& key) const noexcept {
+            // Use the high bits, the low bits select the bucket in the map.
+            const auto h = static_cast<std::uint64_t>(key.hash());
+            return m_shards[static_cast<std::size_t>((h >> 32U) ^ (h >> 16U)) & (m_num_shards - 1)];
+        }
+
+        // Remove entries from the end of the list until the shard is in
+        // its budget. Must be called with the lock held.
+        void evict(shard& s) {
+            while (s.bytes > m_shard_budget && !s.entries.empty()) {
+                auto& last = s.entries.back();
+                s.bytes -= last.content.size();
+                s.map.erase(last.key);
+                s.entries.pop_back();
+                ++s.evictions;
+            }
+        }
+
+    public:
+
+        /**
+         * Construct a layer_cache.
+         *
+         * @param max_bytes The budget for the content of all layers in the
+         *                  cache.
+         * @param num_shards The number of shards. Must be a power of two.
+         * @throws std::invalid_argument If num_shards is not a power of
+         *                               two.
+         */
+        explicit layer_cache(std::size_t max_bytes, std::size_t num_shards = 16) :
+            m_num_shards(num_shards),
+            m_shard_budget(num_shards == 0 ? 0 : max_bytes / num_shards) {
+            if (num_shards == 0 || (num_shards & (num_shards - 1)) != 0) {
+                throw std::invalid_argument{"number of shards must be a power of two"};
+            }
+            m_shards.reset(new shard[num_shards]);
+        }
+
+        /// The budget for the content of all layers.
+        std::size_t max_bytes() const noexcept {
+            return m_shard_budget * m_num_shards;
+        }
+
+        std::size_t num_shards() const noexcept {
+            return m_num_shards;
+        }
+
+        /**
+         * Look up the content of a layer.
+         *
+         * @param key The key of the layer.
+         * @param content Set to the content if the layer was found.
+         * @returns true if the layer is in the cache. Its content might
+         *          still be empty.
+         */
+        bool get(const layer_cache_key& key, shared_buffer* content) {
+            auto& s = shard_for(key);
+            std::lock_guard<std::mutex> lock{s.mutex};
+
+            const auto it = s.map.find(key);
+            if (it == s.map.end()) {
+                ++s.misses;
+                return false;
+            }
+
+            ++s.hits;
+            s.entries.splice(s.entries.begin(), s.entries, it->second);
+            *content = it->second->content;
+            return true;
+        }
+
+        /**
+         * Look up the content of a layer.
+         *
+         * @returns The content or an empty shared_buffer if the layer is
+         *          not in the cache. Use the other get() to tell a layer
+         *          that isn't there from one with empty content.
+         */
+        shared_buffer get(const layer_cache_key& key) {
+            shared_buffer content;
+            get(key, &content);
+            return content;
+        }
+
+        /**
+         * Put the content of a layer into the cache replacing content with
+         * the same key. Less recently used layers are evicted if needed.
+         *
+         * @returns true if the content was stored, false if it is too
+         *          large for the cache.
+         */
+        bool put(const layer_cache_key& key, const shared_buffer& content) {
+            auto& s = shard_for(key);
+            if (content.size() > m_shard_budget) {
+                return false;
+            }
+
+            std::lock_guard<std::mutex> lock{s.mutex};
+
+            const auto it = s.map.find(key);
+            if (it != s.map.end()) {
+                s.bytes -= it->second->content.size();
+                it->second->content = content;
+                s.entries.splice(s.entries.begin(), s.entries, it->second);
+            } else {
+                s.entries.push_front(entry{key, content});
+                s.map.emplace(key, s.entries.begin());
+            }
+
+            s.bytes += content.size();
+            evict(s);
+
+            return true;
+        }
+
+        /**
+         * Get the decoded content of a layer from the cache. If it isn't
+         * in there, the layer is decoded using the specified zlib_context
+         * and its content is moved into the cache. This way the (still
+         * encoded) content of the layer is only read from its source if
+         * needed, when the layer was read without it (see read_layer_at()).
+         *
+         * @param file The number identifying the file of the layer.
+         * @param layer The layer.
+         * @param context The zlib_context used for decoding.
+         * @returns The decoded content.
+         * @throws format_error If the layer can't be decoded.
+         * @throws zlib_error If the content can't be uncompressed.
+         */
+        shared_buffer content(std::uint64_t file, layer& layer, zlib_context& context) {
+            const layer_cache_key key{file, layer};
+
+            shared_buffer content;
+            if (get(key, &content)) {
+                return content;
+            }
+
+            layer.decode_content(context);
+            content = shared_buffer{layer.release_content()};
+            put(key, content);
+
+            return content;
+        }
+
+        /**
+         * Get the decoded content of a layer from the cache, decoding it
+         * if it isn't in there.
+         */
+        shared_buffer content(std::uint64_t file, layer& layer) {
+            return content(file, layer, detail::default_zlib_context());
+        }
+
+        /// Remove the layer from the cache.
+        void erase(const layer_cache_key& key) {
+            auto& s = shard_for(key);
+            std::lock_guard<std::mutex> lock{s.mutex};
+
+            const auto it = s.map.find(key);
+            if (it != s.map.end()) {
+                s.bytes -= it->second->content.size();
+                s.entries.erase(it->second);
+                s.map.erase(it);
+            }
+        }
+
+        /// Remove all layers from the cache. The counters are kept.
+        void clear() {
+            for (std::size_t n = 0; n < m_num_shards; ++n) {
+                auto& s = m_shards[n];
+                std::lock_guard<std::mutex> lock{s.mutex};
+                s.map.clear();
+                s.entries.clear();
+                s.bytes = 0;
+            }
+        }
+
+        /**
+         * The counters summed up over all shards. Other threads can use
+         * the cache while this is running, so the numbers are not
+         * necessarily from the same point in time.
+         */
+        layer_cache_stats stats() const {
+            layer_cache_stats result;
+            for (std::size_t n = 0; n < m_num_shards; ++n) {
+                auto& s = m_shards[n];
+                std::lock_guard<std::mutex> lock{s.mutex};
+                result.hits += s.hits;
+                result.misses += s.misses;
+                result.evictions += s.evictions;
+                result.entries += s.map.size();
+                result.bytes += s.bytes;
+            }
+            return result;
+        }
+
+    }; // class layer_cache
+
+} // namespace tgd_header
+
+#endif // TGD_HEADER_LAYER_CACHE_HPP
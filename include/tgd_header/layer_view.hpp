@@ -0,0 +1,401 @@
+#ifndef TGD_HEADER_LAYER_VIEW_HPP
+#define TGD_HEADER_LAYER_VIEW_HPP
+
+/*****************************************************************************
+
+tgd_header - Encoding and decoding the Tiled Geographic Data Common Header.
+
+This file is from https://github.com/mapbox/tgd-header-lib where you can find
+more documentation.
+
+*****************************************************************************/
+
+/**
+ * @file layer_view.hpp
+ *
+ * @brief Contains the layer_view class and a range to iterate over the
+ *        layers in contiguous memory.
+ */
+
+#include "buffer.hpp"
+#include "encoding.hpp"
+#include "exceptions.hpp"
+#include "layer.hpp"
+#include "shared_buffer.hpp"
+#include "tile.hpp"
+#include "types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+
+namespace tgd_header {
+
+    /**
+     * A read-only view of a layer record in memory. Unlike a layer this
+     * doesn't own or copy anything, all accessors read directly from the
+     * record. It is only valid as long as the memory it points to is.
+     *
+     * Use the layer_view_range to get views of all layers in a buffer or
+     * memory mapped file.
+     */
+    class layer_view {
+
+        const char* m_data = nullptr;
+
+        template <typename T>
+        T get(std::size_t offset) const noexcept {
+            T value;
+            detail::get(m_data + offset, &value);
+            return value;
+        }
+
+    public:
+
+        /// Construct an invalid layer_view.
+        layer_view() noexcept = default;
+
+        /**
+         * Construct a layer_view of the record at data. There must be at
+         * least size bytes available.
+         *
+         * @throws format_error If there is no valid record there or if it
+         *                      is larger than size.
+         */
+        layer_view(const char* data, std::uint64_t size) :
+            m_data(data) {
+            if (size < detail::header_size) {
+                throw format_error{"incomplete header"};
+            }
+
+            const char* error = detail::check_header(data);
+            if (error) {
+                throw format_error{error};
+            }
+
+            if (record_size() > size) {
+                throw format_error{"unexpected end of data"};
+            }
+
+            error = detail::check_name(name(), name_length());
+            if (error) {
+                throw format_error{error};
+            }
+        }
+
+        explicit operator bool() const noexcept {
+            return m_data != nullptr;
+        }
+
+        /// Pointer to the start of the record.
+        const char* data() const noexcept {
+            return m_data;
+        }
+
+        layer_content_type content_type() const noexcept {
+            return get<layer_content_type>(detail::offset::content_type);
+        }
+
+        layer_compression_type compression_type() const noexcept {
+            return get<layer_compression_type>(detail::offset::compression_type);
+        }
+
+        tile_address tile() const noexcept {
+            return tile_address{m_data};
+        }
+
+        name_length_type name_length() const noexcept {
+            return get<name_length_type>(detail::offset::name_length);
+        }
+
+        /// The name of the layer. Always ends with a '\0' byte.
+        const char* name() const noexcept {
+            return m_data + detail::header_size;
+        }
+
+        bool has_name(const std::string& str) const noexcept {
+            if (name_length() != str.size()) {
+                return false;
+            }
+            return !std::memcmp(name(), str.data(), str.size());
+        }
+
+        bool has_name(const char* str) const noexcept {
+            return !std::strcmp(name(), str);
+        }
+
+        content_length_type content_length() const noexcept {
+            return get<content_length_type>(detail::offset::original_length);
+        }
+
+        content_length_type wire_content_length() const noexcept {
+            return get<content_length_type>(detail::offset::content_length);
+        }
+
+        /**
+         * The (still encoded) content of the layer including padding as
+         * a buffer not managing its memory.
+         */
+        buffer wire_content() const noexcept {
+            return buffer{m_data + detail::header_size + detail::padded_size(name_length() + 1),
+                          detail::padded_size(wire_content_length())};
+        }
+
+        layer_flags_type flags() const noexcept {
+            return get<layer_flags_type>(detail::offset::flags);
+        }
+
+        /// Does the record contain a checksum?
+        bool has_checksum() const noexcept {
+            return (flags() & layer_flags::checksum) != 0;
+        }
+
+        /// The checksum stored in the header.
+        std::uint32_t checksum() const noexcept {
+            return get<std::uint32_t>(detail::offset::checksum);
+        }
+
+        /**
+         * Is this a reference record? Its wire content is then not the
+         * content of the layer but a reference to content elsewhere in
+         * the file, use layer_view_range::wire_content() to resolve it.
+         */
+        bool is_reference() const noexcept {
+            return (flags() & layer_flags::reference) != 0;
+        }
+
+        /**
+         * The offset of the referenced wire content in the file. Only
+         * meaningful if is_reference() is true.
+         */
+        std::uint64_t reference_offset() const noexcept {
+            std::uint64_t offset = 0;
+            content_length_type length = 0;
+            detail::parse_reference(wire_content().data(), &offset, &length);
+            return offset;
+        }
+
+        /**
+         * The length of the referenced wire content. Only meaningful if
+         * is_reference() is true.
+         */
+        content_length_type reference_length() const noexcept {
+            std::uint64_t offset = 0;
+            content_length_type length = 0;
+            detail::parse_reference(wire_content().data(), &offset, &length);
+            return length;
+        }
+
+        /**
+         * Check the checksum against the data of the record.
+         *
+         * @returns true if the checksum matches or there is no checksum.
+         */
+        bool verify_checksum() const noexcept {
+            if (!has_checksum()) {
+                return true;
+            }
+            return detail::record_checksum(m_data, name(), name_length() + 1UL,
+                                           wire_content().data(), wire_content_length()) == checksum();
+        }
+
+        /// The number of bytes the record takes up including all padding.
+        std::uint64_t record_size() const noexcept {
+            return detail::header_size +
+                   detail::padded_size(name_length() + 1) +
+                   detail::padded_size(wire_content_length());
+        }
+
+        /**
+         * Create a layer from this view. The name and content of the layer
+         * are not copied, they point into the same memory as the view.
+         *
+         * The view doesn't know where the content of a reference record
+         * is, so in that case the layer has no content. Use
+         * layer_view_range::to_layer() to resolve references.
+         */
+        layer to_layer() const {
+            layer result{m_data, detail::header_size};
+            result.set_name_internal(buffer{name(), detail::padded_size(name_length() + 1)});
+            if (is_reference()) {
+                result.set_reference(reference_offset(), reference_length());
+            } else {
+                result.set_wire_content(wire_content());
+            }
+            return result;
+        }
+
+    }; // class layer_view
+
+    /**
+     * Forward iterator over the layer records in contiguous memory. It
+     * yields layer_views, so iterating doesn't allocate any memory.
+     */
+    class layer_view_iterator {
+
+        const char* m_begin = nullptr;
+        const char* m_end = nullptr;
+        layer_view m_view{};
+
+        void update() {
+            const auto size = static_cast<std::size_t>(m_end - m_begin);
+            if (size < detail::header_size) {
+                m_begin = m_end;
+                m_view = layer_view{};
+                return;
+            }
+            m_view = layer_view{m_begin, size};
+        }
+
+    public:
+
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = layer_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const layer_view*;
+        using reference = const layer_view&;
+
+        /// Construct an end iterator.
+        layer_view_iterator() noexcept = default;
+
+        /**
+         * Construct an iterator pointing to the first record in the memory
+         * from begin to end.
+         *
+         * @throws format_error If there is no valid record there.
+         */
+        layer_view_iterator(const char* begin, const char* end) :
+            m_begin(begin),
+            m_end(end) {
+            update();
+        }
+
+        reference operator*() const noexcept {
+            return m_view;
+        }
+
+        pointer operator->() const noexcept {
+            return &m_view;
+        }
+
+        /**
+         * Go to the next record. Less than a header worth of data at the
+         * end is ignored like the reader does.
+         *
+         * @throws format_error If the next record is not valid.
+         */
+        layer_view_iterator& operator++() {
+            m_begin += m_view.record_size();
+            update();
+            return *this;
+        }
+
+        layer_view_iterator operator++(int) {
+            layer_view_iterator tmp{*this};
+            ++*this;
+            return tmp;
+        }
+
+        friend bool operator==(const layer_view_iterator& lhs, const layer_view_iterator& rhs) noexcept {
+            return lhs.m_view.data() == rhs.m_view.data();
+        }
+
+        friend bool operator!=(const layer_view_iterator& lhs, const layer_view_iterator& rhs) noexcept {
+            return !(lhs == rhs);
+        }
+
+    }; // class layer_view_iterator
+
+    /**
+     * A range of all layer records in contiguous memory, for instance in a
+     * buffer or a memory mapped file:
+     *
+     * @code
+     * tgd_header::mmap_source source{filename};
+     * for (const auto& view : tgd_header::layer_view_range{source.mapping()}) {
+     *     ...
+     * }
+     * @endcode
+     *
+     * The range doesn't keep the memory alive, it must stay valid while
+     * the range and its iterators are used.
+     */
+    class layer_view_range {
+
+        const char* m_begin;
+        const char* m_end;
+
+    public:
+
+        layer_view_range(const char* data, std::size_t size) noexcept :
+            m_begin(data),
+            m_end(data + size) {
+        }
+
+        explicit layer_view_range(const buffer& data) noexcept :
+            layer_view_range(data.data(), data.size()) {
+        }
+
+        explicit layer_view_range(const shared_buffer& data) noexcept :
+            layer_view_range(data.data(), data.size()) {
+        }
+
+        /// @throws format_error If the first record is not valid.
+        layer_view_iterator begin() const {
+            return layer_view_iterator{m_begin, m_end};
+        }
+
+        layer_view_iterator end() const noexcept {
+            return layer_view_iterator{};
+        }
+
+        /**
+         * The offset of the record the view points to from the start of
+         * the range. Use this to build an index.
+         */
+        std::uint64_t offset(const layer_view& view) const noexcept {
+            return static_cast<std::uint64_t>(view.data() - m_begin);
+        }
+
+        /**
+         * The (still encoded) content of the layer the view points to
+         * including padding. For reference records this is the referenced
+         * content in the range.
+         *
+         * @throws format_error If the reference points outside the range.
+         */
+        buffer wire_content(const layer_view& view) const {
+            if (!view.is_reference()) {
+                return view.wire_content();
+            }
+
+            const auto size = static_cast<std::uint64_t>(m_end - m_begin);
+            const auto offset = view.reference_offset();
+            const auto length = detail::padded_size(view.reference_length());
+            if (offset > size || length > size - offset) {
+                throw format_error{"invalid reference"};
+            }
+            return buffer{m_begin + offset, static_cast<std::size_t>(length)};
+        }
+
+        /**
+         * Create a layer from the view like layer_view::to_layer(), but
+         * resolve references to content in this range.
+         *
+         * @throws format_error If the reference points outside the range.
+         */
+        layer to_layer(const layer_view& view) const {
+            auto result = view.to_layer();
+            if (view.is_reference()) {
+                result.set_wire_content(wire_content(view));
+            }
+            return result;
+        }
+
+    }; // class layer_view_range
+
+} // namespace tgd_header
+
+#endif // TGD_HEADER_LAYER_VIEW_HPP
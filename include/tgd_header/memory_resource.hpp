@@ -0,0 +1,341 @@
+#ifndef TGD_HEADER_MEMORY_RESOURCE_HPP
+#define TGD_HEADER_MEMORY_RESOURCE_HPP
+
+/*****************************************************************************
+
+tgd_header - Encoding and decoding the Tiled Geographic Data Common Header.
+
+This file is from https://github.com/mapbox/tgd-header-lib where you can find
+more documentation.
+
+*****************************************************************************/
+
+/**
+ * @file memory_resource.hpp
+ *
+ * @brief Contains the memory_resource class and its implementations
+ *        new_delete_resource, pool_resource, and arena_resource.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace tgd_header {
+
+    /**
+     * Interface for classes that hand out the memory used by managed
+     * buffers. Use new_delete_resource() for the default resource using
+     * new[] and delete[], pool_resource or arena_resource for cheaper
+     * allocations in special cases, or derive your own class from this.
+     *
+     * All memory is aligned to at least alignof(std::max_align_t).
+     */
+    class memory_resource {
+
+    public:
+
+        memory_resource() noexcept = default;
+
+        memory_resource(const memory_resource&) = delete;
+        memory_resource& operator=(const memory_resource&) = delete;
+
+        memory_resource(memory_resource&&) = delete;
+        memory_resource& operator=(memory_resource&&) = delete;
+
+        virtual ~memory_resource() noexcept = default;
+
+        /**
+         * Allocate size bytes of memory.
+         *
+         * @throws std::bad_alloc If no memory is available.
+         */
+        virtual char* allocate(std::size_t size) = 0;
+
+        /**
+         * Give back memory returned from allocate(). The size must be the
+         * same as the one used when allocating.
+         */
+        virtual void deallocate(char* data, std::size_t size) noexcept = 0;
+
+    }; // class memory_resource
+
+    namespace detail {
+
+        class new_delete_resource : public memory_resource {
+
+        public:
+
+            char* allocate(std::size_t size) override {
+                return new char[size];
+            }
+
+            void deallocate(char* data, std::size_t /*size*/) noexcept override {
+                delete[] data;
+            }
+
+        }; // class new_delete_resource
+
+        constexpr const std::size_t max_align = alignof(std::max_align_t);
+
+        inline std::size_t aligned_size(std::size_t size) noexcept {
+            return (size + max_align - 1) & ~(max_align - 1);
+        }
+
+    } // namespace detail
+
+    /**
+     * The default memory resource using new[] and delete[]. This is
+     * thread-safe.
+     */
+    inline memory_resource* new_delete_resource() noexcept {
+        static detail::new_delete_resource resource;
+        return &resource;
+    }
+
+    /**
+     * A memory resource that keeps freed memory blocks around for reuse.
+     * Requests are rounded up to size classes (powers of two) and served
+     * from a free list for each class, so repeatedly allocating and freeing
+     * similar sized buffers doesn't need any calls to the upstream
+     * resource. Requests larger than the maximum block size go to the
+     * upstream resource directly.
+     *
+     * Memory is taken from the upstream resource in large chunks which are
+     * only given back when the pool is destructed. All buffers allocated
+     * from a pool_resource must be released before the pool is destructed.
+     *
+     * A pool_resource is not thread-safe. Use one pool per thread.
+     */
+    class pool_resource : public memory_resource {
+
+        static constexpr const std::size_t min_block_size = 16;
+        static constexpr const std::size_t num_size_classes = 28;
+
+        struct free_block {
+            free_block* next;
+        };
+
+        memory_resource* m_upstream;
+        std::size_t m_max_block_size;
+        std::size_t m_chunk_size;
+
+        std::array<free_block*, num_size_classes> m_free_lists{};
+        std::vector<char*> m_chunks{};
+
+        // Unused space in the current chunk.
+        char* m_chunk_begin = nullptr;
+        char* m_chunk_end = nullptr;
+
+        static std::size_t size_class(std::size_t size) noexcept {
+            std::size_t n = 0;
+            std::size_t block_size = min_block_size;
+            while (block_size < size) {
+                block_size <<= 1U;
+                ++n;
+            }
+            return n;
+        }
+
+        static std::size_t block_size(std::size_t size_class) noexcept {
+            return min_block_size << size_class;
+        }
+
+        char* allocate_from_chunk(std::size_t size) {
+            if (static_cast<std::size_t>(m_chunk_end - m_chunk_begin) < size) {
+                m_chunks.reserve(m_chunks.size() + 1);
+                char* chunk = m_upstream->allocate(m_chunk_size);
+                m_chunks.push_back(chunk);
+                m_chunk_begin = chunk;
+                m_chunk_end = chunk + m_chunk_size;
+            }
+            char* data = m_chunk_begin;
+            m_chunk_begin += size;
+            return data;
+        }
+
+    public:
+
+        /// The default for the largest block size handled by the pool.
+        static constexpr const std::size_t default_max_block_size = 64UL * 1024UL;
+
+        /**
+         * Create a pool resource.
+         *
+         * @param max_block_size Allocations larger than this are handed
+         *                       to the upstream resource directly. This is
+         *                       rounded up to a power of two.
+         * @param upstream Where the pool gets its memory from.
+         */
+        explicit pool_resource(std::size_t max_block_size = default_max_block_size,
+                               memory_resource* upstream = new_delete_resource()) :
+            m_upstream(upstream),
+            m_max_block_size(block_size(std::min(size_class(max_block_size), num_size_classes - 1))),
+            m_chunk_size(std::max<std::size_t>(m_max_block_size, 256UL * 1024UL)) {
+            assert(upstream);
+        }
+
+        ~pool_resource() noexcept override {
+            for (auto* chunk : m_chunks) {
+                m_upstream->deallocate(chunk, m_chunk_size);
+            }
+        }
+
+        /// The largest block size handled by the pool.
+        std::size_t max_block_size() const noexcept {
+            return m_max_block_size;
+        }
+
+        char* allocate(std::size_t size) override {
+            if (size > m_max_block_size) {
+                return m_upstream->allocate(size);
+            }
+
+            const auto n = size_class(size);
+            auto* block = m_free_lists[n];
+            if (block) {
+                m_free_lists[n] = block->next;
+                return reinterpret_cast<char*>(block); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+            }
+
+            return allocate_from_chunk(block_size(n));
+        }
+
+        void deallocate(char* data, std::size_t size) noexcept override {
+            if (!data) {
+                return;
+            }
+
+            if (size > m_max_block_size) {
+                m_upstream->deallocate(data, size);
+                return;
+            }
+
+            const auto n = size_class(size);
+            auto* block = reinterpret_cast<free_block*>(data); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+            block->next = m_free_lists[n];
+            m_free_lists[n] = block;
+        }
+
+    }; // class pool_resource
+
+    /**
+     * A memory resource handing out memory from large blocks by simply
+     * bumping a pointer. Deallocating memory does nothing, instead all
+     * memory is released at once by calling reset(). This is useful if
+     * many buffers with the same lifetime are needed, for instance while
+     * working on one tile.
+     *
+     * All buffers allocated from an arena_resource must be released before
+     * reset() is called or the arena is destructed.
+     *
+     * An arena_resource is not thread-safe. Use one arena per thread.
+     */
+    class arena_resource : public memory_resource {
+
+        struct block {
+            char* data;
+            std::size_t size;
+        };
+
+        memory_resource* m_upstream;
+        std::size_t m_block_size;
+
+        std::vector<block> m_blocks{};
+
+        // Index of the block currently used and offset into that block.
+        std::size_t m_current = 0;
+        std::size_t m_offset = 0;
+
+        std::size_t m_bytes_allocated = 0;
+
+        void add_block(std::size_t size) {
+            m_blocks.reserve(m_blocks.size() + 1);
+            m_blocks.push_back(block{m_upstream->allocate(size), size});
+        }
+
+    public:
+
+        /// The default size of the blocks taken from upstream.
+        static constexpr const std::size_t default_block_size = 256UL * 1024UL;
+
+        /**
+         * Create an arena resource.
+         *
+         * @param block_size Size of the blocks of memory taken from
+         *                   upstream. Larger allocations get a block of
+         *                   their own.
+         * @param upstream Where the arena gets its memory from.
+         */
+        explicit arena_resource(std::size_t block_size = default_block_size,
+                                memory_resource* upstream = new_delete_resource()) :
+            m_upstream(upstream),
+            m_block_size(detail::aligned_size(std::max<std::size_t>(block_size, 1))) {
+            assert(upstream);
+        }
+
+        ~arena_resource() noexcept override {
+            for (const auto& b : m_blocks) {
+                m_upstream->deallocate(b.data, b.size);
+            }
+        }
+
+        /**
+         * The number of bytes handed out since construction or the last
+         * call to reset().
+         */
+        std::size_t bytes_allocated() const noexcept {
+            return m_bytes_allocated;
+        }
+
+        char* allocate(std::size_t size) override {
+            size = detail::aligned_size(std::max<std::size_t>(size, 1));
+
+            // Find a block with enough space left. Blocks are filled in
+            // order, so only the current and later blocks have space.
+            while (m_current < m_blocks.size() &&
+                   m_blocks[m_current].size - m_offset < size) {
+                ++m_current;
+                m_offset = 0;
+            }
+
+            if (m_current == m_blocks.size()) {
+                add_block(std::max(size, m_block_size));
+            }
+
+            char* data = m_blocks[m_current].data + m_offset;
+            m_offset += size;
+            m_bytes_allocated += size;
+            return data;
+        }
+
+        void deallocate(char* /*data*/, std::size_t /*size*/) noexcept override {
+        }
+
+        /**
+         * Release all memory allocated from this arena in one go. The
+         * blocks of the default size are kept for reuse, larger blocks are
+         * given back to upstream.
+         */
+        void reset() noexcept {
+            const auto it = std::partition(m_blocks.begin(), m_blocks.end(), [this](const block& b) {
+                return b.size == m_block_size;
+            });
+            for (auto i = it; i != m_blocks.end(); ++i) {
+                m_upstream->deallocate(i->data, i->size);
+            }
+            m_blocks.erase(it, m_blocks.end());
+
+            m_current = 0;
+            m_offset = 0;
+            m_bytes_allocated = 0;
+        }
+
+    }; // class arena_resource
+
+} // namespace tgd_header
+
+#endif // TGD_HEADER_MEMORY_RESOURCE_HPP
@@ -13,14 +13,19 @@ more documentation.
 /**
  * @file mmap_source.hpp
  *
- * @brief Contains the mmap_source class.
+ * @brief Contains the mmap_options struct and the mmap_source class.
  */
 
 #include "buffer.hpp"
 #include "file.hpp"
+#include "shared_buffer.hpp"
 
+#include <algorithm>
+#include <cerrno>
 #include <cstddef>
+#include <cstdint>
 #include <fcntl.h>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <sys/mman.h>
@@ -32,32 +37,170 @@ more documentation.
 
 namespace tgd_header {
 
+    /// How the data in an mmap_source will be accessed.
+    enum class mmap_access {
+        normal     = 0, ///< no special access pattern (MADV_NORMAL)
+        sequential = 1, ///< full scan from beginning to end (MADV_SEQUENTIAL)
+        random     = 2  ///< random lookups, for instance using an index (MADV_RANDOM)
+    }; // enum class mmap_access
+
+    /**
+     * Options for the mmap_source. These are all hints to the kernel on
+     * how to handle the memory mapping. They don't change the results,
+     * only the performance. Errors from the kernel are ignored.
+     */
+    struct mmap_options {
+
+        /// Expected access pattern, used for madvise().
+        mmap_access access = mmap_access::normal;
+
+        /**
+         * Read the whole file into memory when mapping it (MAP_POPULATE).
+         * Only available on Linux.
+         */
+        bool populate = false;
+
+        /**
+         * Ask the kernel to read this many bytes ahead of the current read
+         * position (MADV_WILLNEED) while reading. 0 to disable.
+         */
+        std::size_t readahead = 0;
+
+        /**
+         * Tell the kernel that data already read will not be needed again
+         * (MADV_DONTNEED and POSIX_FADV_DONTNEED). This keeps scans of
+         * files larger than the available memory from pushing everything
+         * else out of the page cache. Data which is accessed again anyway
+         * is re-read from the file.
+         */
+        bool drop_behind = false;
+
+        /**
+         * Ask for transparent huge pages (MADV_HUGEPAGE). This only works
+         * on Linux with file systems supporting it.
+         */
+        bool huge_pages = false;
+
+    }; // struct mmap_options
+
     /**
      * Source for a tgd_header::reader based on a file. The file is opened
      * and mmaped on construction and unmapped and closed on destruction.
      *
      * Keeps track of where in the buffer we have been reading from.
+     *
+     * The mapping is reference counted. Use read_shared() or mapping() to
+     * get shared_buffers pointing into the mapping. The memory stays mapped
+     * as long as any of those buffers is still around, even if the
+     * mmap_source is closed or destructed.
+     *
+     * Use mmap_options to tell the kernel how the data will be accessed.
      */
     class mmap_source : public detail::file {
 
+        // Consumed data is dropped in chunks of this size if drop_behind
+        // is set.
+        static constexpr const std::size_t drop_behind_chunk_size = 4UL * 1024UL * 1024UL;
+
         std::size_t m_size = 0;
         char* m_mapping = nullptr;
+        std::shared_ptr<const char> m_owner{};
         std::size_t m_offset = 0;
 
+        mmap_options m_options;
+        std::size_t m_page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+
+        // End of the range for which readahead was requested.
+        std::size_t m_prefetched = 0;
+
+        // End of the range which was dropped.
+        std::size_t m_dropped = 0;
+
+        static int map_flags(const mmap_options& options) noexcept {
+            int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+            if (options.populate) {
+                flags |= MAP_POPULATE; // NOLINT(hicpp-signed-bitwise)
+            }
+#else
+            (void)options;
+#endif
+            return flags;
+        }
+
+        static char* map_file(int fd, std::size_t size, const mmap_options& options, const std::string& filename) {
+            void* mapping = ::mmap(nullptr, size, PROT_READ, map_flags(options), fd, 0);
+            if (mapping == MAP_FAILED) { // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
+                throw std::system_error{errno, std::system_category(), std::string{"Error mmapping file '"} + filename + "': "};
+            }
+            return static_cast<char*>(mapping);
+        }
+
+        std::size_t page_start(std::size_t offset) const noexcept {
+            return offset - offset % m_page_size;
+        }
+
+        void advise_range(std::size_t begin, std::size_t end, int advice) const noexcept {
+            begin = page_start(begin);
+            if (begin < end) {
+                ::madvise(m_mapping + begin, end - begin, advice);
+            }
+        }
+
+        // Called whenever the read position changes to update readahead
+        // and drop-behind.
+        void update_readahead() noexcept {
+            if (!m_mapping) {
+                return;
+            }
+
+            // Request more data when half of the readahead range has been
+            // consumed.
+            if (m_options.readahead > 0 && m_offset + m_options.readahead / 2 >= m_prefetched && m_prefetched < m_size) {
+                const auto end = std::min(m_size, m_offset + m_options.readahead);
+                advise_range(m_offset, end, MADV_WILLNEED);
+                m_prefetched = end;
+            }
+
+            if (m_options.drop_behind && m_offset >= m_dropped + drop_behind_chunk_size) {
+                const auto end = page_start(m_offset);
+                advise_range(m_dropped, end, MADV_DONTNEED);
+#ifdef POSIX_FADV_DONTNEED
+                ::posix_fadvise(fd(), static_cast<off_t>(m_dropped), static_cast<off_t>(end - m_dropped), POSIX_FADV_DONTNEED);
+#endif
+                m_dropped = end;
+            }
+        }
+
+        static std::shared_ptr<const char> own_mapping(char* mapping, std::size_t size) {
+            return std::shared_ptr<const char>{mapping, [size](const char* data) {
+                ::munmap(const_cast<char*>(data), size); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+            }};
+        }
+
     public:
 
         /**
          * Construct mmap_source from contents of the specified file.
          *
          * @param filename Name of the input file.
+         * @param options Hints on how the data will be accessed.
+         * @throws std::system_error If the file can't be opened or mapped.
+         *                           Files of size zero can't be mapped.
          */
-        explicit mmap_source(const std::string& filename) :
+        explicit mmap_source(const std::string& filename, const mmap_options& options = mmap_options{}) :
             file(open_file(filename, O_RDONLY | O_CLOEXEC)), // NOLINT(hicpp-signed-bitwise)
             m_size(file_size()),
-            m_mapping(static_cast<char*>(::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd(), 0))) {
-            if (!m_mapping) {
-                throw std::system_error{errno, std::system_category(), std::string{"Error mmapping file '"} + filename + "': "};
+            m_mapping(map_file(fd(), m_size, options, filename)),
+            m_owner(own_mapping(m_mapping, m_size)),
+            m_options(options) {
+            advise(options.access);
+#ifdef MADV_HUGEPAGE
+            if (options.huge_pages) {
+                ::madvise(m_mapping, m_size, MADV_HUGEPAGE);
             }
+#endif
+            update_readahead();
         }
 
         mmap_source(const mmap_source&) = delete;
@@ -67,7 +210,12 @@ namespace tgd_header {
             file(std::move(other)),
             m_size(other.m_size),
             m_mapping(other.m_mapping),
-            m_offset(other.m_offset) {
+            m_owner(std::move(other.m_owner)),
+            m_offset(other.m_offset),
+            m_options(other.m_options),
+            m_page_size(other.m_page_size),
+            m_prefetched(other.m_prefetched),
+            m_dropped(other.m_dropped) {
             other.m_size = 0;
             other.m_mapping = nullptr;
         }
@@ -90,13 +238,63 @@ namespace tgd_header {
             using std::swap;
             swap(m_size, other.m_size);
             swap(m_mapping, other.m_mapping);
+            swap(m_owner, other.m_owner);
             swap(m_offset, other.m_offset);
+            swap(m_options, other.m_options);
+            swap(m_page_size, other.m_page_size);
+            swap(m_prefetched, other.m_prefetched);
+            swap(m_dropped, other.m_dropped);
         }
 
-        void close() {
-            if (m_mapping) {
-                ::munmap(m_mapping, m_size);
+        /// The options used for this source.
+        const mmap_options& options() const noexcept {
+            return m_options;
+        }
+
+        /**
+         * Change the access pattern. For instance, use sequential access
+         * while building an index and random access for lookups after that.
+         */
+        void advise(mmap_access access) noexcept {
+            m_options.access = access;
+            if (!m_mapping) {
+                return;
+            }
+            switch (access) {
+                case mmap_access::sequential:
+                    ::madvise(m_mapping, m_size, MADV_SEQUENTIAL);
+                    break;
+                case mmap_access::random:
+                    ::madvise(m_mapping, m_size, MADV_RANDOM);
+                    break;
+                default:
+                    ::madvise(m_mapping, m_size, MADV_NORMAL);
+                    break;
             }
+        }
+
+        /**
+         * Ask the kernel to read the specified range of the file into
+         * memory in the background (MADV_WILLNEED), because it will be
+         * needed soon. Use this with offsets and sizes from a layer_index
+         * to prefetch the next layers before reading them. Ranges outside
+         * the file are ignored.
+         */
+        void prefetch(std::size_t offset, std::size_t len) const noexcept {
+            if (!m_mapping || offset >= m_size) {
+                return;
+            }
+            advise_range(offset, offset + std::min(len, m_size - offset), MADV_WILLNEED);
+        }
+
+        /**
+         * Close the file. The memory is unmapped once no shared_buffers
+         * pointing into it are left.
+         */
+        void close() {
+            m_owner.reset();
+            m_mapping = nullptr;
+            m_size = 0;
             file::close();
         }
 
@@ -107,14 +305,64 @@ namespace tgd_header {
                 return buffer;
             }
             m_offset += len;
+            update_readahead();
             return buffer;
         }
 
+        /**
+         * Read len bytes from the source and return them in a shared_buffer
+         * which keeps the mapping alive. Works like read() otherwise.
+         */
+        shared_buffer read_shared(const std::size_t len) {
+            if (m_offset + len > m_size) {
+                return shared_buffer{};
+            }
+            shared_buffer buffer{m_owner, m_mapping + m_offset, len};
+            m_offset += len;
+            update_readahead();
+            return buffer;
+        }
+
+        /**
+         * Read exactly len bytes starting at offset and return the
+         * results. This doesn't change the read position and can be
+         * called from several threads at the same time. If there aren't
+         * len bytes at that offset, an empty buffer is returned.
+         */
+        buffer read_at(const std::uint64_t offset, const std::size_t len) const noexcept {
+            if (offset > m_size || len > m_size - offset) {
+                return buffer{};
+            }
+            return buffer{m_mapping + offset, len};
+        }
+
+        /// Return a shared_buffer with the contents of the whole file.
+        shared_buffer mapping() const noexcept {
+            return shared_buffer{m_owner, m_mapping, m_size};
+        }
+
         void skip(const std::size_t len) {
             if (m_offset + len > m_size) {
                 throw std::range_error{"Out of range"};
             }
             m_offset += len;
+            update_readahead();
+        }
+
+        /**
+         * Set the read position to the specified offset.
+         *
+         * @throws std::range_error If the offset is beyond the end of the
+         *                          file
+         */
+        void seek(const std::size_t offset) {
+            if (offset > m_size) {
+                throw std::range_error{"Out of range"};
+            }
+            m_offset = offset;
+            m_prefetched = offset;
+            m_dropped = std::min(m_dropped, page_start(offset));
+            update_readahead();
         }
 
     }; // mmap_source
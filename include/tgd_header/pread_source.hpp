@@ -0,0 +1,112 @@
+#ifndef TGD_HEADER_PREAD_SOURCE_HPP
+#define TGD_HEADER_PREAD_SOURCE_HPP
+
+/*****************************************************************************
+
+tgd_header - Encoding and decoding the Tiled Geographic Data Common Header.
+
+This file is from https://github.com/mapbox/tgd-header-lib where you can find
+more documentation.
+
+*****************************************************************************/
+
+/**
+ * @file pread_source.hpp
+ *
+ * @brief Contains the pread_source class.
+ */
+
+#include "buffer.hpp"
+#include "exceptions.hpp"
+#include "file.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
+
+namespace tgd_header {
+
+    namespace detail {
+
+        // Read exactly len bytes from the file descriptor starting at
+        // offset. See pread_source::read_at().
+        inline buffer pread_buffer(int fd, const std::uint64_t offset, const std::size_t len) {
+            mutable_buffer mb{len};
+
+            std::size_t done = 0;
+            while (done < len) {
+                const auto read_length = ::pread(fd, mb.data() + done, len - done, static_cast<off_t>(offset + done));
+                if (read_length < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw std::system_error{errno, std::system_category(), "Read error: "};
+                }
+                if (read_length == 0) {
+                    break;
+                }
+                done += static_cast<std::size_t>(read_length);
+            }
+
+            if (done == 0 && len > 0) {
+                return buffer{};
+            }
+
+            if (done != len) {
+                throw format_error{"unexpected end of file"};
+            }
+
+            return buffer{std::move(mb)};
+        }
+
+    } // namespace detail
+
+    /**
+     * Positional source based on a file. Unlike the other sources this
+     * doesn't have a current read position, all data is read with
+     * read_at() from an explicit offset using pread(). It has no mutable
+     * state, so many threads can read from the same pread_source at the
+     * same time.
+     *
+     * Use read_layer_at() to read a layer from a known offset (for
+     * instance from a layer_index), or wrap the source in a cursor to read
+     * it sequentially with a reader.
+     */
+    class pread_source : public detail::file {
+
+    public:
+
+        /**
+         * Construct pread_source for the specified file.
+         *
+         * @param filename Name of the input file.
+         */
+        explicit pread_source(const std::string& filename) :
+            file(open_file(filename, O_RDONLY | O_CLOEXEC)) { // NOLINT(hicpp-signed-bitwise)
+        }
+
+        /**
+         * Read exactly len bytes from the file starting at offset and return
+         * them in a managed buffer. If the offset is at or beyond the end of
+         * the file, an empty buffer is returned. This can be called from
+         * several threads at the same time.
+         *
+         * @throws format_error If the file ends in the middle of the data.
+         * @throws std::system_error If there was an error reading the file.
+         */
+        buffer read_at(const std::uint64_t offset, const std::size_t len) const {
+            return detail::pread_buffer(fd(), offset, len);
+        }
+
+    }; // pread_source
+
+} // namespace tgd_header
+
+#endif // TGD_HEADER_PREAD_SOURCE_HPP
@@ -17,37 +17,208 @@ more documentation.
  */
 
 #include "encoding.hpp"
+#include "exceptions.hpp"
 #include "layer.hpp"
 
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 
 namespace tgd_header {
 
+    namespace detail {
+
+        // Is there a read_at(offset, len) function on the source?
+        template <typename TSource, typename = void>
+        struct has_read_at : std::false_type {
+        };
+
+        template <typename TSource>
+        struct has_read_at<TSource, decltype(void(std::declval<TSource&>().read_at(std::uint64_t{}, std::size_t{})))> : std::true_type {
+        };
+
+        // Set up the layer so that the referenced content is fetched from
+        // the source using read_at() when needed.
+        template <typename TSource>
+        void set_reference_fetcher(TSource& source, layer& layer, std::uint64_t offset, std::size_t len, std::true_type /*has_read_at*/) {
+            layer.set_wire_content_fetcher([&source, offset, len]() {
+                auto content = source.read_at(offset, len);
+                if (content.size() != len) {
+                    throw format_error{"invalid reference"};
+                }
+                return content;
+            });
+        }
+
+        // Sources without read_at() can't get at the referenced content.
+        // Reading the headers still works, but asking for the content is
+        // an error.
+        template <typename TSource>
+        void set_reference_fetcher(TSource& /*source*/, layer& layer, std::uint64_t /*offset*/, std::size_t /*len*/, std::false_type /*has_read_at*/) {
+            layer.set_wire_content_fetcher([]() -> buffer {
+                throw format_error{"content of reference record can not be read from this source (needs read_at())"};
+            });
+        }
+
+        // Read the content of a reference record and set up the layer so
+        // that the referenced content is fetched from the source when
+        // needed.
+        template <typename TSource>
+        void resolve_reference(TSource& source, layer& layer, const buffer& data) {
+            if (data.size() < reference_size) {
+                throw format_error{"unexpected end of file"};
+            }
+
+            std::uint64_t offset = 0;
+            content_length_type length = 0;
+            parse_reference(data.data(), &offset, &length);
+            layer.set_reference(offset, length);
+
+            set_reference_fetcher(source, layer, offset, padded_size(length), has_read_at<TSource>{});
+        }
+
+    } // namespace detail
+
+    /**
+     * Reads layers one after the other from a source.
+     *
+     * Calling next_layer() only reads the header and the name of the next
+     * layer. The content is only read if read_content() is called, it is
+     * skipped over otherwise. So if you are only interested in the metadata
+     * of the layers, don't call read_content() and the reader will never
+     * touch the content. (For file sources this means the content is not
+     * even read from disk.)
+     *
+     * The content is also read automatically when it is first needed, for
+     * instance when layer::load_content() or layer::write() is called on
+     * the current layer. After the next call to next_layer() this isn't
+     * possible any more. The layers refer back to the reader for this, so
+     * a reader can not be copied or moved.
+     *
+     * Reference records (see layer::is_reference()) are resolved
+     * transparently, the referenced content is read using read_at() on the
+     * source when it is needed. All sources in this library have a
+     * read_at() function, a source without one can be used, but getting
+     * the content of a reference record throws a format_error. Sources
+     * that can't read at arbitrary positions, like a file_source on STDIN,
+     * report the error from read_at() at that point.
+     *
+     * The reader keeps track of the offsets of the layers in the source. For
+     * this to work the source must be at its beginning when the reader is
+     * created or you have to tell the reader where the source is.
+     *
+     * To read from many threads at the same time use a positional source
+     * like the pread_source and give each thread its own cursor on it. Or
+     * use read_layer_at() to read single layers.
+     */
     template <typename TSource>
     class reader {
 
         TSource& m_source;
         layer m_layer{};
+
+        // Offset of the current layer in the source.
+        std::uint64_t m_layer_offset = 0;
+
+        // Offset of the next byte to be read from the source.
+        std::uint64_t m_offset = 0;
+
         bool m_content_is_read = false;
 
+        // The content fetchers of the layers only hold a weak_ptr to this,
+        // so they can tell when the reader is gone.
+        std::shared_ptr<reader*> m_self{std::make_shared<reader*>(this)};
+
+        // Read the content of the layer at layer_offset, which must be the
+        // current layer, from the source.
+        buffer fetch_content(std::uint64_t layer_offset) {
+            if (!m_layer || layer_offset != m_layer_offset || m_content_is_read) {
+                throw std::logic_error{"layer content is not available from the reader any more"};
+            }
+
+            const auto len = detail::padded_size(m_layer.wire_content_length());
+            auto content = m_source.read(len);
+            m_offset += len;
+            m_content_is_read = true;
+            return content;
+        }
+
     public:
 
         explicit reader(TSource& source) :
             m_source(source) {
         }
 
+        /**
+         * Create a reader for a source which is currently at the specified
+         * offset.
+         */
+        reader(TSource& source, std::uint64_t offset) :
+            m_source(source),
+            m_layer_offset(offset),
+            m_offset(offset) {
+        }
+
+        reader(const reader&) = delete;
+        reader& operator=(const reader&) = delete;
+
+        reader(reader&&) = delete;
+        reader& operator=(reader&&) = delete;
+
+        /**
+         * Read the header and name of the next layer. Skips the content of
+         * the current layer if it wasn't read.
+         *
+         * @returns A reference to the layer. The layer object is reused
+         *          for all layers, so it is only valid until the next
+         *          call to next_layer(). Evaluates to false if there are
+         *          no more layers.
+         *
+         * The layer can be copied or moved out, but its content can only
+         * be loaded (with layer::load_content() and the like) as long as
+         * it is the current layer of this reader. After that loading the
+         * content throws a std::logic_error, also if the reader doesn't
+         * exist any more. The content of a reference record is read from
+         * the source, so the source must still be there in that case.
+         */
         layer& next_layer() {
             if (m_layer && !m_content_is_read) {
-                m_source.skip(detail::padded_size(m_layer.wire_content_length()));
+                const auto len = detail::padded_size(m_layer.wire_content_length());
+                m_source.skip(len);
+                m_offset += len;
             }
             m_content_is_read = false;
+            m_layer_offset = m_offset;
             const auto buffer = m_source.read(detail::header_size);
 
             if (buffer) {
                 m_layer = layer{buffer};
+                m_offset += detail::header_size;
 
                 if (m_layer) {
-                    m_layer.set_name_internal(m_source.read(detail::padded_size(m_layer.name_length() + 1)));
+                    const auto len = detail::padded_size(m_layer.name_length() + 1);
+                    m_layer.set_name_internal(m_source.read(len));
+                    m_offset += len;
+
+                    if (m_layer.is_reference()) {
+                        detail::resolve_reference(m_source, m_layer, m_source.read(detail::reference_size));
+                        m_offset += detail::reference_size;
+                        m_content_is_read = true;
+                    } else {
+                        const auto layer_offset = m_layer_offset;
+                        const std::weak_ptr<reader*> self{m_self};
+                        m_layer.set_wire_content_fetcher([self, layer_offset]() {
+                            const auto r = self.lock();
+                            if (!r) {
+                                throw std::logic_error{"layer content is not available, the reader is gone"};
+                            }
+                            return (*r)->fetch_content(layer_offset);
+                        });
+                    }
                 }
             } else {
                 m_layer = {};
@@ -56,17 +227,106 @@ namespace tgd_header {
             return m_layer;
         }
 
+        /**
+         * Read the (still encoded) content of the current layer. Call
+         * layer::decode_content() after this to decode it.
+         */
         void read_content() {
             assert(m_layer && "You have to call next_layer() first");
 
             if (!m_content_is_read) {
-                m_layer.set_wire_content(m_source.read(detail::padded_size(m_layer.wire_content_length())));
-                m_content_is_read = true;
+                m_layer.set_wire_content(fetch_content(m_layer_offset));
             }
         }
 
+        /**
+         * The offset of the current layer in the source. Together with
+         * layer::record_size() this describes where the layer is stored.
+         */
+        std::uint64_t layer_offset() const noexcept {
+            return m_layer_offset;
+        }
+
+        /**
+         * Continue reading at the specified offset in the source. This
+         * must be the offset of a layer, for instance one returned by
+         * layer_offset() earlier or one found in an index. The source must
+         * support seeking. Call next_layer() to read the layer there.
+         */
+        void seek(std::uint64_t offset) {
+            m_source.seek(offset);
+            m_layer = {};
+            m_layer_offset = offset;
+            m_offset = offset;
+            m_content_is_read = false;
+        }
+
     }; // class reader
 
+    /**
+     * Read the layer at the specified offset from a positional source
+     * (one with a read_at() function like the pread_source). This doesn't
+     * change the read position of the source. Whether it can be used from
+     * several threads at the same time depends on the read_at() function
+     * of the source: The one of the pread_source is const and thread-safe,
+     * the one of the uring_source is not.
+     *
+     * @param source The source to read from.
+     * @param offset The offset of the layer, for instance from a
+     *               layer_index.
+     * @param with_content Read the (still encoded) content, too. Call
+     *                     layer::decode_content() to decode it. If this
+     *                     is false, the content is read from the source
+     *                     when it is first needed, so the source must
+     *                     still be around then.
+     * @returns The layer. Evaluates to false if there is no layer at that
+     *          offset because it is at the end of the source.
+     * @throws format_error If the data is not a valid layer.
+     */
+    template <typename TSource>
+    layer read_layer_at(TSource& source, std::uint64_t offset, bool with_content = true) {
+        const auto header = source.read_at(offset, detail::header_size);
+        if (!header) {
+            return layer{};
+        }
+
+        layer layer{header};
+        offset += detail::header_size;
+
+        const auto name_len = detail::padded_size(layer.name_length() + 1);
+        auto name = source.read_at(offset, name_len);
+        if (!name) {
+            throw format_error{"unexpected end of file"};
+        }
+        layer.set_name_internal(std::move(name));
+        offset += name_len;
+
+        if (layer.is_reference()) {
+            detail::resolve_reference(source, layer, source.read_at(offset, detail::reference_size));
+            if (with_content) {
+                layer.fetch_wire_content();
+            }
+            return layer;
+        }
+
+        const auto content_len = detail::padded_size(layer.wire_content_length());
+        const auto fetch = [&source, offset, content_len]() {
+            auto content = source.read_at(offset, content_len);
+            if (!content && content_len > 0) {
+                throw format_error{"unexpected end of file"};
+            }
+            return content;
+        };
+
+        if (with_content) {
+            layer.set_wire_content(fetch());
+        } else {
+            layer.set_wire_content_fetcher(fetch);
+        }
+
+        return layer;
+    }
+
 } // namespace tgd_header
 
 #endif // TGD_HEADER_READER_HPP
@@ -0,0 +1,158 @@
+#ifndef TGD_HEADER_SCANNER_HPP
+#define TGD_HEADER_SCANNER_HPP
+
+/*****************************************************************************
+
+tgd_header - Encoding and decoding the Tiled Geographic Data Common Header.
+
+This file is from https://github.com/mapbox/tgd-header-lib where you can find
+more documentation.
+
+*****************************************************************************/
+
+/**
+ * @file scanner.hpp
+ *
+ * @brief Contains functions to find layer records in damaged data.
+ */
+
+#include "encoding.hpp"
+#include "layer.hpp"
+#include "layer_view.hpp"
+#include "types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+# define TGD_HEADER_SCANNER_SSE2
+# include <emmintrin.h>
+#endif
+
+namespace tgd_header {
+
+    namespace detail {
+
+        // The magic bytes "TGD0" as they appear in memory read as one
+        // 32 bit value.
+        inline std::uint32_t magic_value() noexcept {
+            std::uint32_t value = 0;
+            std::memcpy(&value, "TGD0", sizeof(value));
+            return value;
+        }
+
+        inline bool has_magic_at(const char* data) noexcept {
+            std::uint32_t value = 0;
+            std::memcpy(&value, data, sizeof(value));
+            return value == magic_value();
+        }
+
+    } // namespace detail
+
+    /**
+     * Find the next occurrence of the magic bytes "TGD0" at an offset
+     * that is a multiple of 8 (where records have to start) in the data.
+     * Uses SSE2 to check eight offsets at once if available.
+     *
+     * @param data Pointer to the start of the data. Offsets are relative
+     *             to this.
+     * @param size Size of the data.
+     * @param offset Offset to start searching at. It is rounded up to a
+     *               multiple of 8.
+     * @returns The offset of the magic bytes or size if there are none.
+     */
+    inline std::uint64_t find_magic(const char* data, std::uint64_t size, std::uint64_t offset) noexcept {
+        offset = detail::padded_size(offset);
+        if (size < 4) {
+            return size;
+        }
+        const std::uint64_t last = size - 4;
+
+#ifdef TGD_HEADER_SCANNER_SSE2
+        // Every 16 byte block has two candidate offsets: in the 32 bit
+        // lanes 0 and 2.
+        const __m128i magic = _mm_set1_epi32(static_cast<int>(detail::magic_value()));
+        while (offset + 64 <= size) {
+            const char* p = data + offset;
+            const __m128i c0 = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), magic);      // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+            const __m128i c1 = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16)), magic); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+            const __m128i c2 = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 32)), magic); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+            const __m128i c3 = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 48)), magic); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+            const __m128i any = _mm_or_si128(_mm_or_si128(c0, c1), _mm_or_si128(c2, c3));
+            if ((_mm_movemask_ps(_mm_castsi128_ps(any)) & 0x5) != 0) {
+                break; // found something in this block, locate it below
+            }
+            offset += 64;
+        }
+#endif
+
+        for (; offset <= last; offset += detail::align_bytes) {
+            if (detail::has_magic_at(data + offset)) {
+                return offset;
+            }
+        }
+
+        return size;
+    }
+
+    /**
+     * Check whether there is a plausible layer record at data. Beyond the
+     * magic bytes the name length, name, and compression type must be
+     * valid, reference records must have the right size, and the whole
+     * record must fit into size bytes. If the record has a checksum, it
+     * must match.
+     *
+     * @returns The size of the record or 0 if there is no valid record.
+     */
+    inline std::uint64_t check_record(const char* data, std::uint64_t size) noexcept {
+        if (size < detail::header_size || !detail::has_magic_at(data) ||
+            detail::check_header(data) != nullptr) {
+            return 0;
+        }
+
+        name_length_type name_length = 0;
+        detail::get(data + detail::offset::name_length, &name_length);
+        if (name_length == 0 || detail::header_size + name_length + 1 > size ||
+            detail::check_name(data + detail::header_size, name_length) != nullptr) {
+            return 0;
+        }
+
+        content_length_type content_length = 0;
+        detail::get(data + detail::offset::content_length, &content_length);
+
+        const auto record_size = detail::header_size +
+                                 detail::padded_size(name_length + 1) +
+                                 detail::padded_size(content_length);
+        if (record_size > size) {
+            return 0;
+        }
+
+        if (!layer_view{data, record_size}.verify_checksum()) {
+            return 0;
+        }
+
+        return record_size;
+    }
+
+    /**
+     * Find the next plausible layer record (see check_record()) in the
+     * data at or after offset.
+     *
+     * @returns The offset of the record or size if there is none.
+     */
+    inline std::uint64_t find_record(const char* data, std::uint64_t size, std::uint64_t offset) noexcept {
+        while ((offset = find_magic(data, size, offset)) < size) {
+            if (check_record(data + offset, size - offset) > 0) {
+                return offset;
+            }
+            offset += detail::align_bytes;
+        }
+        return size;
+    }
+
+} // namespace tgd_header
+
+#undef TGD_HEADER_SCANNER_SSE2
+
+#endif // TGD_HEADER_SCANNER_HPP
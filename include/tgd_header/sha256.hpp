@@ -0,0 +1,152 @@
+#ifndef TGD_HEADER_SHA256_HPP
+#define TGD_HEADER_SHA256_HPP
+
+/*****************************************************************************
+
+tgd_header - Encoding and decoding the Tiled Geographic Data Common Header.
+
+This file is from https://github.com/mapbox/tgd-header-lib where you can find
+more documentation.
+
+*****************************************************************************/
+
+/**
+ * @file sha256.hpp
+ *
+ * @brief Contains the sha256() function used by the dedup_writer to
+ *        identify layer content.
+ *
+ * This is a straightforward implementation of SHA-256 (FIPS 180-4). It is
+ * not hardened against side channels, it is only meant for identifying
+ * content.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace tgd_header {
+
+    using sha256_digest = std::array<unsigned char, 32>;
+
+    namespace detail {
+
+        inline std::uint32_t sha256_rotr(std::uint32_t x, unsigned int n) noexcept {
+            return (x >> n) | (x << (32U - n));
+        }
+
+        inline std::uint32_t sha256_load(const unsigned char* p) noexcept {
+            return (static_cast<std::uint32_t>(p[0]) << 24U) |
+                   (static_cast<std::uint32_t>(p[1]) << 16U) |
+                   (static_cast<std::uint32_t>(p[2]) << 8U) |
+                    static_cast<std::uint32_t>(p[3]);
+        }
+
+        // Process one 64 byte block.
+        inline void sha256_block(std::uint32_t* state, const unsigned char* block) noexcept {
+            static const std::uint32_t k[64] = {
+                0x428a2f98U, 0x71374491U, 0xb5c0fbcfU, 0xe9b5dba5U, 0x3956c25bU, 0x59f111f1U, 0x923f82a4U, 0xab1c5ed5U,
+                0xd807aa98U, 0x12835b01U, 0x243185beU, 0x550c7dc3U, 0x72be5d74U, 0x80deb1feU, 0x9bdc06a7U, 0xc19bf174U,
+                0xe49b69c1U, 0xefbe4786U, 0x0fc19dc6U, 0x240ca1ccU, 0x2de92c6fU, 0x4a7484aaU, 0x5cb0a9dcU, 0x76f988daU,
+                0x983e5152U, 0xa831c66dU, 0xb00327c8U, 0xbf597fc7U, 0xc6e00bf3U, 0xd5a79147U, 0x06ca6351U, 0x14292967U,
+                0x27b70a85U, 0x2e1b2138U, 0x4d2c6dfcU, 0x53380d13U, 0x650a7354U, 0x766a0abbU, 0x81c2c92eU, 0x92722c85U,
+                0xa2bfe8a1U, 0xa81a664bU, 0xc24b8b70U, 0xc76c51a3U, 0xd192e819U, 0xd6990624U, 0xf40e3585U, 0x106aa070U,
+                0x19a4c116U, 0x1e376c08U, 0x2748774cU, 0x34b0bcb5U, 0x391c0cb3U, 0x4ed8aa4aU, 0x5b9cca4fU, 0x682e6ff3U,
+                0x748f82eeU, 0x78a5636fU, 0x84c87814U, 0x8cc70208U, 0x90befffaU, 0xa4506cebU, 0xbef9a3f7U, 0xc67178f2U
+            };
+
+            std::uint32_t w[64]; // NOLINT(cppcoreguidelines-pro-type-member-init,hicpp-member-init)
+            for (std::size_t i = 0; i < 16; ++i) {
+                w[i] = sha256_load(block + i * 4);
+            }
+            for (std::size_t i = 16; i < 64; ++i) {
+                const auto s0 = sha256_rotr(w[i - 15], 7) ^ sha256_rotr(w[i - 15], 18) ^ (w[i - 15] >> 3U);
+                const auto s1 = sha256_rotr(w[i - 2], 17) ^ sha256_rotr(w[i - 2], 19) ^ (w[i - 2] >> 10U);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+
+            std::uint32_t a = state[0];
+            std::uint32_t b = state[1];
+            std::uint32_t c = state[2];
+            std::uint32_t d = state[3];
+            std::uint32_t e = state[4];
+            std::uint32_t f = state[5];
+            std::uint32_t g = state[6];
+            std::uint32_t h = state[7];
+
+            for (std::size_t i = 0; i < 64; ++i) {
+                const auto s1 = sha256_rotr(e, 6) ^ sha256_rotr(e, 11) ^ sha256_rotr(e, 25);
+                const auto ch = (e & f) ^ (~e & g);
+                const auto t1 = h + s1 + ch + k[i] + w[i];
+                const auto s0 = sha256_rotr(a, 2) ^ sha256_rotr(a, 13) ^ sha256_rotr(a, 22);
+                const auto maj = (a & b) ^ (a & c) ^ (b & c);
+                const auto t2 = s0 + maj;
+                h = g;
+                g = f;
+                f = e;
+                e = d + t1;
+                d = c;
+                c = b;
+                b = a;
+                a = t1 + t2;
+            }
+
+            state[0] += a;
+            state[1] += b;
+            state[2] += c;
+            state[3] += d;
+            state[4] += e;
+            state[5] += f;
+            state[6] += g;
+            state[7] += h;
+        }
+
+    } // namespace detail
+
+    /**
+     * Calculate the SHA-256 digest of the data.
+     */
+    inline sha256_digest sha256(const char* data, std::size_t size) noexcept {
+        std::uint32_t state[8] = {
+            0x6a09e667U, 0xbb67ae85U, 0x3c6ef372U, 0xa54ff53aU,
+            0x510e527fU, 0x9b05688cU, 0x1f83d9abU, 0x5be0cd19U
+        };
+
+        const auto* p = reinterpret_cast<const unsigned char*>(data); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        const std::uint64_t bits = static_cast<std::uint64_t>(size) * 8U;
+
+        while (size >= 64) {
+            detail::sha256_block(state, p);
+            p += 64;
+            size -= 64;
+        }
+
+        // The rest of the data, a 1 bit, zeros, and the length in bits
+        // fill up one or two final blocks.
+        unsigned char tail[128] = {0};
+        std::memcpy(tail, p, size);
+        tail[size] = 0x80U;
+        const std::size_t tail_size = size < 56 ? 64 : 128;
+        for (std::size_t i = 0; i < 8; ++i) {
+            tail[tail_size - 1 - i] = static_cast<unsigned char>(bits >> (i * 8U));
+        }
+
+        detail::sha256_block(state, tail);
+        if (tail_size == 128) {
+            detail::sha256_block(state, tail + 64);
+        }
+
+        sha256_digest digest; // NOLINT(cppcoreguidelines-pro-type-member-init,hicpp-member-init)
+        for (std::size_t i = 0; i < 8; ++i) {
+            digest[i * 4] = static_cast<unsigned char>(state[i] >> 24U);
+            digest[i * 4 + 1] = static_cast<unsigned char>(state[i] >> 16U);
+            digest[i * 4 + 2] = static_cast<unsigned char>(state[i] >> 8U);
+            digest[i * 4 + 3] = static_cast<unsigned char>(state[i]);
+        }
+        return digest;
+    }
+
+} // namespace tgd_header
+
+#endif // TGD_HEADER_SHA256_HPP
@@ -0,0 +1,186 @@
+#ifndef TGD_HEADER_SHARED_BUFFER_HPP
+#define TGD_HEADER_SHARED_BUFFER_HPP
+
+/*****************************************************************************
+
+tgd_header - Encoding and decoding the Tiled Geographic Data Common Header.
+
+This file is from https://github.com/mapbox/tgd-header-lib where you can find
+more documentation.
+
+*****************************************************************************/
+
+/**
+ * @file shared_buffer.hpp
+ *
+ * @brief Contains the shared_buffer class.
+ */
+
+#include "buffer.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace tgd_header {
+
+    /**
+     * A shared_buffer is a piece of read-only memory that can be shared
+     * between several owners. Unlike a buffer it can be copied cheaply,
+     * the memory is released when the last shared_buffer referring to it
+     * is gone. The reference count is updated atomically, so copies can be
+     * handed to other threads.
+     *
+     * A shared_buffer can refer to part of the memory it keeps alive.
+     * Use slice() to get such a sub-range without copying any data. Slices
+     * keep the whole memory block alive.
+     */
+    class shared_buffer {
+
+        std::shared_ptr<const char> m_owner{};
+        const char* m_data = nullptr;
+        std::size_t m_size = 0;
+
+    public:
+
+        /// Construct an empty shared_buffer.
+        shared_buffer() noexcept = default;
+
+        /**
+         * Construct a shared_buffer from a buffer. If the buffer is managed,
+         * the management of the memory is taken over without copying.
+         * Otherwise the data is copied, because there is no way to tell how
+         * long the memory the buffer points to stays valid.
+         */
+        explicit shared_buffer(buffer&& buffer) {
+            if (!buffer) {
+                return;
+            }
+            if (!buffer.managed()) {
+                buffer = buffer.copy();
+            }
+            m_data = buffer.data();
+            m_size = buffer.size();
+            auto* resource = buffer.resource();
+            const auto capacity = buffer.capacity();
+            m_owner = std::shared_ptr<const char>{buffer.release(), [resource, capacity](const char* data) {
+                resource->deallocate(const_cast<char*>(data), capacity); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+            }};
+        }
+
+        /**
+         * Construct a shared_buffer from memory that will be released by
+         * calling the deleter with the data pointer when the last
+         * shared_buffer referring to it is gone.
+         */
+        template <typename TDeleter>
+        shared_buffer(const char* data, std::size_t size, TDeleter deleter) :
+            m_owner(data, std::move(deleter)),
+            m_data(data),
+            m_size(size) {
+        }
+
+        /**
+         * Construct a shared_buffer pointing to memory that is kept alive
+         * by the owner.
+         */
+        template <typename T>
+        shared_buffer(const std::shared_ptr<T>& owner, const char* data, std::size_t size) noexcept :
+            m_owner(owner, data),
+            m_data(data),
+            m_size(size) {
+        }
+
+        /**
+         * Return a shared_buffer referring to len bytes of this buffer
+         * starting at offset. No data is copied.
+         *
+         * @throws std::range_error If the slice is not inside this buffer.
+         */
+        shared_buffer slice(std::size_t offset, std::size_t len) const {
+            if (offset > m_size || len > m_size - offset) {
+                throw std::range_error{"Out of range"};
+            }
+            return shared_buffer{m_owner, m_data + offset, len};
+        }
+
+        /**
+         * Return a buffer pointing to the same memory. The buffer doesn't
+         * manage the memory, so you have to keep this shared_buffer (or a
+         * copy of it) around while the buffer is used.
+         */
+        buffer view() const noexcept {
+            return buffer{m_data, m_size};
+        }
+
+        /**
+         * Release the reference to the memory. The memory is freed if this
+         * was the last reference.
+         */
+        void clear() noexcept {
+            m_owner.reset();
+            m_data = nullptr;
+            m_size = 0;
+        }
+
+        /// Swap the contents of this buffer with the specified buffer.
+        void swap(shared_buffer& other) noexcept {
+            using std::swap;
+            swap(m_owner, other.m_owner);
+            swap(m_data, other.m_data);
+            swap(m_size, other.m_size);
+        }
+
+        /// Does this buffer contain some data.
+        explicit operator bool() const noexcept {
+            return m_data != nullptr;
+        }
+
+        /**
+         * The number of shared_buffers referring to the same memory. Zero
+         * if this is empty.
+         */
+        long use_count() const noexcept {
+            return m_owner.use_count();
+        }
+
+        /// Return pointer to buffer contents.
+        const char* data() const noexcept {
+            return m_data;
+        }
+
+        /// Return the size of the buffer contents.
+        std::size_t size() const noexcept {
+            return m_size;
+        }
+
+        /// Iterator pointing to the beginning of the data.
+        const char* cbegin() const noexcept {
+            return m_data;
+        }
+
+        /// Iterator pointing to the end of the data.
+        const char* cend() const noexcept {
+            return m_data + m_size;
+        }
+
+        /// Iterator pointing to the beginning of the data.
+        const char* begin() const noexcept {
+            return cbegin();
+        }
+
+        /// Iterator pointing to the end of the data.
+        const char* end() const noexcept {
+            return cend();
+        }
+
+    }; // class shared_buffer
+
+    inline void swap(shared_buffer& a, shared_buffer& b) noexcept {
+        a.swap(b);
+    }
+
+} // namespace tgd_header
+
+#endif // TGD_HEADER_SHARED_BUFFER_HPP
@@ -19,7 +19,9 @@ more documentation.
 #include "encoding.hpp"
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 
 namespace tgd_header {
 
@@ -76,6 +78,51 @@ namespace tgd_header {
         return !(lhs == rhs);
     }
 
+    /**
+     * Tiles are ordered by zoom, then x, then y. This is the order used in
+     * the layer index. For an order that keeps nearby tiles together see
+     * morton_order and hilbert_order in tile_key.hpp.
+     */
+    inline bool operator<(const tile_address& lhs, const tile_address& rhs) noexcept {
+        if (lhs.zoom() != rhs.zoom()) {
+            return lhs.zoom() < rhs.zoom();
+        }
+        if (lhs.x() != rhs.x()) {
+            return lhs.x() < rhs.x();
+        }
+        return lhs.y() < rhs.y();
+    }
+
+    inline bool operator>(const tile_address& lhs, const tile_address& rhs) noexcept {
+        return rhs < lhs;
+    }
+
+    inline bool operator<=(const tile_address& lhs, const tile_address& rhs) noexcept {
+        return !(rhs < lhs);
+    }
+
+    inline bool operator>=(const tile_address& lhs, const tile_address& rhs) noexcept {
+        return !(lhs < rhs);
+    }
+
 } // namespace tgd_header
 
+namespace std {
+
+    template <>
+    struct hash<tgd_header::tile_address> {
+
+        std::size_t operator()(const tgd_header::tile_address& tile) const noexcept {
+            // splitmix64 finalizer over all bits of the address
+            std::uint64_t h = (static_cast<std::uint64_t>(tile.x()) << 32U) | tile.y();
+            h ^= static_cast<std::uint64_t>(tile.zoom()) * 0x9e3779b97f4a7c15ULL;
+            h = (h ^ (h >> 30U)) * 0xbf58476d1ce4e5b9ULL;
+            h = (h ^ (h >> 27U)) * 0x94d049bb133111ebULL;
+            return static_cast<std::size_t>(h ^ (h >> 31U));
+        }
+
+    }; // struct hash<tgd_header::tile_address>
+
+} // namespace std
+
 #endif // TGD_HEADER_TILE_HPP
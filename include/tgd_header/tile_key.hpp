@@ -0,0 +1,338 @@
+#ifndef TGD_HEADER_TILE_KEY_HPP
+#define TGD_HEADER_TILE_KEY_HPP
+
+/*****************************************************************************
+
+tgd_header - Encoding and decoding the Tiled Geographic Data Common Header.
+
+This file is from https://github.com/mapbox/tgd-header-lib where you can find
+more documentation.
+
+*****************************************************************************/
+
+/**
+ * @file tile_key.hpp
+ *
+ * @brief Contains functions to convert tile addresses to and from keys on
+ *        space-filling curves (Morton/Z-order and Hilbert) and quadkeys.
+ *
+ * Keys are only meaningful together with the zoom level, tiles on
+ * different zoom levels can have the same key. All functions need
+ * zoom <= max_key_zoom and x and y smaller than 2^zoom.
+ *
+ * The encode and decode functions are constexpr. The key functions do
+ * the same at runtime, but faster: Morton keys are calculated with the
+ * pdep/pext instructions if the code is compiled for a CPU with BMI2, the
+ * Hilbert keys are calculated from the Morton keys using tables that
+ * handle four levels at once.
+ */
+
+#include "exceptions.hpp"
+#include "tile.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(__BMI2__) && defined(__x86_64__)
+# define TGD_HEADER_USE_BMI2
+# include <immintrin.h>
+#endif
+
+namespace tgd_header {
+
+    /// The largest zoom level for which keys can be calculated.
+    constexpr const unsigned int max_key_zoom = 32;
+
+    namespace detail {
+
+        constexpr std::uint64_t spread_step(std::uint64_t value, unsigned int shift, std::uint64_t mask) noexcept {
+            return (value | (value << shift)) & mask;
+        }
+
+        constexpr std::uint64_t compact_step(std::uint64_t value, unsigned int shift, std::uint64_t mask) noexcept {
+            return (value | (value >> shift)) & mask;
+        }
+
+        // Move bit n of the value to bit 2n.
+        constexpr std::uint64_t spread_bits(std::uint32_t value) noexcept {
+            return spread_step(spread_step(spread_step(spread_step(spread_step(value,
+                       16U, 0x0000ffff0000ffffULL),
+                        8U, 0x00ff00ff00ff00ffULL),
+                        4U, 0x0f0f0f0f0f0f0f0fULL),
+                        2U, 0x3333333333333333ULL),
+                        1U, 0x5555555555555555ULL);
+        }
+
+        // Move bit 2n of the value to bit n, the inverse of spread_bits().
+        constexpr std::uint32_t compact_bits(std::uint64_t value) noexcept {
+            return static_cast<std::uint32_t>(
+                compact_step(compact_step(compact_step(compact_step(compact_step(value & 0x5555555555555555ULL,
+                     1U, 0x3333333333333333ULL),
+                     2U, 0x0f0f0f0f0f0f0f0fULL),
+                     4U, 0x00ff00ff00ff00ffULL),
+                     8U, 0x0000ffff0000ffffULL),
+                    16U, 0x00000000ffffffffULL));
+        }
+
+        // The Hilbert curve functions follow the well-known xy2d/d2xy
+        // algorithms, written recursively to be constexpr in C++11. At
+        // every level the remaining lower bits are rotated/flipped.
+
+        constexpr std::uint64_t hilbert_encode_impl(std::uint32_t s, std::uint32_t x, std::uint32_t y, std::uint64_t d) noexcept;
+
+        constexpr std::uint64_t hilbert_encode_step(std::uint32_t s, std::uint32_t x, std::uint32_t y, std::uint64_t d, std::uint32_t rx, std::uint32_t ry) noexcept {
+            return hilbert_encode_impl(s >> 1U,
+                                       ry ? x : (rx ? ~y : y),
+                                       ry ? y : (rx ? ~x : x),
+                                       d + static_cast<std::uint64_t>(s) * s * ((3U * rx) ^ ry));
+        }
+
+        constexpr std::uint64_t hilbert_encode_impl(std::uint32_t s, std::uint32_t x, std::uint32_t y, std::uint64_t d) noexcept {
+            return s == 0 ? d : hilbert_encode_step(s, x, y, d, (x & s) ? 1U : 0U, (y & s) ? 1U : 0U);
+        }
+
+        constexpr tile_address hilbert_decode_impl(std::uint8_t zoom, unsigned int level, std::uint64_t t, std::uint32_t x, std::uint32_t y) noexcept;
+
+        constexpr tile_address hilbert_decode_step(std::uint8_t zoom, unsigned int level, std::uint64_t t, std::uint32_t x, std::uint32_t y, std::uint32_t rx, std::uint32_t ry) noexcept {
+            return hilbert_decode_impl(zoom, level + 1, t >> 2U,
+                                       (ry ? x : (rx ? ((1U << level) - 1U) ^ y : y)) + (rx << level),
+                                       (ry ? y : (rx ? ((1U << level) - 1U) ^ x : x)) + (ry << level));
+        }
+
+        constexpr tile_address hilbert_decode_impl(std::uint8_t zoom, unsigned int level, std::uint64_t t, std::uint32_t x, std::uint32_t y) noexcept {
+            return level == zoom ? tile_address{zoom, x, y}
+                                 : hilbert_decode_step(zoom, level, t, x, y,
+                                                       static_cast<std::uint32_t>((t >> 1U) & 1U),
+                                                       static_cast<std::uint32_t>((t ^ (t >> 1U)) & 1U));
+        }
+
+        // Tables for converting between Morton and Hilbert keys four
+        // levels (8 bits) at a time. The state has bit 0 set if x and y
+        // are swapped and bit 1 set if both are flipped. Entries contain
+        // the output byte in the lower 8 bits and the next state above.
+        class hilbert_tables {
+
+            std::uint16_t m_encode[4][256];
+            std::uint16_t m_decode[4][256];
+
+        public:
+
+            hilbert_tables() noexcept {
+                for (unsigned int state = 0; state < 4; ++state) {
+                    for (unsigned int byte = 0; byte < 256; ++byte) {
+                        unsigned int enc_state = state;
+                        unsigned int dec_state = state;
+                        unsigned int enc_out = 0;
+                        unsigned int dec_out = 0;
+                        for (int shift = 6; shift >= 0; shift -= 2) {
+                            const unsigned int digit = (byte >> static_cast<unsigned int>(shift)) & 3U;
+
+                            // Morton digit (bit 0: x, bit 1: y) -> Hilbert digit
+                            unsigned int q = digit ^ ((enc_state & 2U) ? 3U : 0U);
+                            if (enc_state & 1U) {
+                                q = ((q & 1U) << 1U) | (q >> 1U);
+                            }
+                            unsigned int rx = q & 1U;
+                            unsigned int ry = q >> 1U;
+                            enc_out = (enc_out << 2U) | ((3U * rx) ^ ry);
+                            if (!ry) {
+                                enc_state ^= rx ? 3U : 1U;
+                            }
+
+                            // Hilbert digit -> Morton digit
+                            rx = (digit >> 1U) & 1U;
+                            ry = (digit ^ rx) & 1U;
+                            q = (ry << 1U) | rx;
+                            if (dec_state & 1U) {
+                                q = ((q & 1U) << 1U) | (q >> 1U);
+                            }
+                            q ^= (dec_state & 2U) ? 3U : 0U;
+                            dec_out = (dec_out << 2U) | q;
+                            if (!ry) {
+                                dec_state ^= rx ? 3U : 1U;
+                            }
+                        }
+                        m_encode[state][byte] = static_cast<std::uint16_t>(enc_out | (enc_state << 8U));
+                        m_decode[state][byte] = static_cast<std::uint16_t>(dec_out | (dec_state << 8U));
+                    }
+                }
+            }
+
+            std::uint64_t convert(bool encode, std::uint64_t key, unsigned int zoom) const noexcept {
+                const auto& table = encode ? m_encode : m_decode;
+
+                // Pad to a multiple of four levels by adding levels at the
+                // bottom, they don't change the result for the upper ones.
+                const unsigned int bytes = (zoom + 3U) / 4U;
+                const unsigned int pad = bytes * 4U - zoom;
+                key <<= 2U * pad;
+
+                std::uint64_t result = 0;
+                unsigned int state = 0;
+                for (unsigned int n = bytes; n > 0; --n) {
+                    const auto entry = table[state][(key >> (8U * (n - 1U))) & 0xffU];
+                    result = (result << 8U) | (entry & 0xffU);
+                    state = static_cast<unsigned int>(entry >> 8U);
+                }
+
+                return result >> (2U * pad);
+            }
+
+        }; // class hilbert_tables
+
+        inline const hilbert_tables& get_hilbert_tables() noexcept {
+            static const hilbert_tables tables;
+            return tables;
+        }
+
+    } // namespace detail
+
+    /**
+     * Calculate the Morton (Z-order) key of the tile with coordinates x
+     * and y. The bits of x end up in the even bits of the key, the bits of
+     * y in the odd bits.
+     */
+    constexpr std::uint64_t morton_encode(std::uint32_t x, std::uint32_t y) noexcept {
+        return detail::spread_bits(x) | (detail::spread_bits(y) << 1U);
+    }
+
+    /**
+     * Get the tile with the specified Morton key on the zoom level.
+     */
+    constexpr tile_address morton_decode(std::uint8_t zoom, std::uint64_t key) noexcept {
+        return tile_address{zoom, detail::compact_bits(key), detail::compact_bits(key >> 1U)};
+    }
+
+    /**
+     * Calculate the Hilbert key of the tile with coordinates x and y on
+     * the zoom level. Tiles with consecutive keys are always neighbours.
+     */
+    constexpr std::uint64_t hilbert_encode(std::uint8_t zoom, std::uint32_t x, std::uint32_t y) noexcept {
+        return detail::hilbert_encode_impl(zoom == 0 ? 0U : 1U << (zoom - 1U), x, y, 0);
+    }
+
+    /**
+     * Get the tile with the specified Hilbert key on the zoom level.
+     */
+    constexpr tile_address hilbert_decode(std::uint8_t zoom, std::uint64_t key) noexcept {
+        return detail::hilbert_decode_impl(zoom, 0, key, 0, 0);
+    }
+
+    /**
+     * Calculate the Morton (Z-order) key of the tile. Same result as
+     * morton_encode(), but faster if BMI2 is available.
+     */
+    inline std::uint64_t morton_key(const tile_address& tile) noexcept {
+        assert(tile.zoom() <= max_key_zoom);
+#ifdef TGD_HEADER_USE_BMI2
+        return _pdep_u64(tile.x(), 0x5555555555555555ULL) |
+               _pdep_u64(tile.y(), 0xaaaaaaaaaaaaaaaaULL);
+#else
+        return morton_encode(tile.x(), tile.y());
+#endif
+    }
+
+    /**
+     * Get the tile with the specified Morton key on the zoom level. Same
+     * result as morton_decode(), but faster if BMI2 is available.
+     */
+    inline tile_address tile_from_morton_key(std::uint8_t zoom, std::uint64_t key) noexcept {
+        assert(zoom <= max_key_zoom);
+#ifdef TGD_HEADER_USE_BMI2
+        return tile_address{zoom,
+                            static_cast<std::uint32_t>(_pext_u64(key, 0x5555555555555555ULL)),
+                            static_cast<std::uint32_t>(_pext_u64(key, 0xaaaaaaaaaaaaaaaaULL))};
+#else
+        return morton_decode(zoom, key);
+#endif
+    }
+
+    /**
+     * Calculate the Hilbert key of the tile. Same result as
+     * hilbert_encode(), but faster.
+     */
+    inline std::uint64_t hilbert_key(const tile_address& tile) noexcept {
+        return detail::get_hilbert_tables().convert(true, morton_key(tile), tile.zoom());
+    }
+
+    /**
+     * Get the tile with the specified Hilbert key on the zoom level. Same
+     * result as hilbert_decode(), but faster.
+     */
+    inline tile_address tile_from_hilbert_key(std::uint8_t zoom, std::uint64_t key) noexcept {
+        assert(zoom <= max_key_zoom);
+        return tile_from_morton_key(zoom, detail::get_hilbert_tables().convert(false, key, zoom));
+    }
+
+    /**
+     * Get the quadkey of the tile as used by Bing Maps: one digit from 0
+     * to 3 per zoom level, the empty string for zoom level 0.
+     */
+    inline std::string quadkey(const tile_address& tile) {
+        const auto key = morton_key(tile);
+        std::string out(tile.zoom(), '0');
+        for (unsigned int n = 0; n < tile.zoom(); ++n) {
+            out[n] = static_cast<char>('0' + ((key >> (2U * (tile.zoom() - 1U - n))) & 3U));
+        }
+        return out;
+    }
+
+    /**
+     * Get the tile with the specified quadkey.
+     *
+     * @throws format_error If the quadkey contains other characters than
+     *         0 to 3 or is too long.
+     */
+    inline tile_address tile_from_quadkey(const std::string& quadkey) {
+        if (quadkey.size() > max_key_zoom) {
+            throw format_error{"quadkey too long"};
+        }
+        std::uint64_t key = 0;
+        for (const char c : quadkey) {
+            if (c < '0' || c > '3') {
+                throw format_error{"invalid character in quadkey"};
+            }
+            key = (key << 2U) | static_cast<std::uint64_t>(c - '0');
+        }
+        return tile_from_morton_key(static_cast<std::uint8_t>(quadkey.size()), key);
+    }
+
+    /**
+     * Order tiles by zoom level, then by Morton key. Can be used with
+     * std::sort. For large numbers of tiles it is faster to calculate the
+     * keys once and sort by them.
+     */
+    struct morton_order {
+
+        bool operator()(const tile_address& lhs, const tile_address& rhs) const noexcept {
+            if (lhs.zoom() != rhs.zoom()) {
+                return lhs.zoom() < rhs.zoom();
+            }
+            return morton_key(lhs) < morton_key(rhs);
+        }
+
+    }; // struct morton_order
+
+    /**
+     * Order tiles by zoom level, then by Hilbert key. Can be used with
+     * std::sort. For large numbers of tiles it is faster to calculate the
+     * keys once and sort by them.
+     */
+    struct hilbert_order {
+
+        bool operator()(const tile_address& lhs, const tile_address& rhs) const noexcept {
+            if (lhs.zoom() != rhs.zoom()) {
+                return lhs.zoom() < rhs.zoom();
+            }
+            return hilbert_key(lhs) < hilbert_key(rhs);
+        }
+
+    }; // struct hilbert_order
+
+} // namespace tgd_header
+
+#undef TGD_HEADER_USE_BMI2
+
+#endif // TGD_HEADER_TILE_KEY_HPP
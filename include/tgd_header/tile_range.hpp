@@ -0,0 +1,155 @@
+#ifndef TGD_HEADER_TILE_RANGE_HPP
+#define TGD_HEADER_TILE_RANGE_HPP
+
+/*****************************************************************************
+
+tgd_header - Encoding and decoding the Tiled Geographic Data Common Header.
+
+This file is from https://github.com/mapbox/tgd-header-lib where you can find
+more documentation.
+
+*****************************************************************************/
+
+/**
+ * @file tile_range.hpp
+ *
+ * @brief Contains the geo_bbox and tile_range classes.
+ *
+ * Tiles are assumed to be in the usual Web Mercator scheme: On zoom level
+ * z there are 2^z x 2^z tiles, x grows from west to east, y from north to
+ * south.
+ */
+
+#include "tile.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace tgd_header {
+
+    /**
+     * A bounding box in geographic coordinates (WGS84 longitude and
+     * latitude in degrees). Bounding boxes crossing the antimeridian are
+     * not supported.
+     */
+    struct geo_bbox {
+
+        /// The largest latitude covered by Web Mercator tiles.
+        static constexpr double max_latitude() noexcept {
+            return 85.0511287798066;
+        }
+
+        double min_lon = -180.0;
+        double min_lat = -max_latitude();
+        double max_lon = 180.0;
+        double max_lat = max_latitude();
+
+        /// The default bounding box covers the whole world.
+        constexpr geo_bbox() noexcept = default;
+
+        constexpr geo_bbox(double min_lon_, double min_lat_, double max_lon_, double max_lat_) noexcept :
+            min_lon(min_lon_),
+            min_lat(min_lat_),
+            max_lon(max_lon_),
+            max_lat(max_lat_) {
+        }
+
+        /**
+         * Is this a valid bounding box? The coordinates must be in range
+         * and the minimum must not be larger than the maximum.
+         */
+        bool valid() const noexcept {
+            return min_lon >= -180.0 && max_lon <= 180.0 &&
+                   min_lat >= -90.0 && max_lat <= 90.0 &&
+                   min_lon <= max_lon && min_lat <= max_lat;
+        }
+
+    }; // struct geo_bbox
+
+    /**
+     * A rectangular range of tiles on one zoom level. Minimum and maximum
+     * are inclusive.
+     */
+    class tile_range {
+
+        std::uint32_t m_min_x = 0;
+        std::uint32_t m_min_y = 0;
+        std::uint32_t m_max_x = 0;
+        std::uint32_t m_max_y = 0;
+        std::uint8_t m_zoom = 0;
+
+        static std::uint32_t clamp(double value, std::uint8_t zoom) noexcept {
+            const double max = std::min(std::ldexp(1.0, zoom) - 1.0, 4294967295.0);
+            return static_cast<std::uint32_t>(std::min(std::max(std::floor(value), 0.0), max));
+        }
+
+        static double lon_to_x(double lon, std::uint8_t zoom) noexcept {
+            return (lon + 180.0) / 360.0 * std::ldexp(1.0, zoom);
+        }
+
+        static double lat_to_y(double lat, std::uint8_t zoom) noexcept {
+            lat = std::min(std::max(lat, -geo_bbox::max_latitude()), geo_bbox::max_latitude());
+            const double rad = lat * 3.14159265358979323846 / 180.0;
+            return (1.0 - std::log(std::tan(rad) + 1.0 / std::cos(rad)) / 3.14159265358979323846) / 2.0 * std::ldexp(1.0, zoom);
+        }
+
+    public:
+
+        /// All tiles on the zoom level.
+        constexpr explicit tile_range(std::uint8_t zoom) noexcept :
+            m_max_x(zoom >= 32 ? 0xffffffffU : (1U << zoom) - 1U),
+            m_max_y(zoom >= 32 ? 0xffffffffU : (1U << zoom) - 1U),
+            m_zoom(zoom) {
+        }
+
+        /// The tiles from (min_x, min_y) to (max_x, max_y) on the zoom level.
+        constexpr tile_range(std::uint8_t zoom, std::uint32_t min_x, std::uint32_t min_y, std::uint32_t max_x, std::uint32_t max_y) noexcept :
+            m_min_x(min_x),
+            m_min_y(min_y),
+            m_max_x(max_x),
+            m_max_y(max_y),
+            m_zoom(zoom) {
+        }
+
+        /// All tiles on the zoom level intersecting the bounding box.
+        tile_range(std::uint8_t zoom, const geo_bbox& bbox) noexcept :
+            m_min_x(clamp(lon_to_x(bbox.min_lon, zoom), zoom)),
+            m_min_y(clamp(lat_to_y(bbox.max_lat, zoom), zoom)),
+            m_max_x(clamp(lon_to_x(bbox.max_lon, zoom), zoom)),
+            m_max_y(clamp(lat_to_y(bbox.min_lat, zoom), zoom)),
+            m_zoom(zoom) {
+        }
+
+        constexpr std::uint8_t zoom() const noexcept {
+            return m_zoom;
+        }
+
+        constexpr std::uint32_t min_x() const noexcept {
+            return m_min_x;
+        }
+
+        constexpr std::uint32_t min_y() const noexcept {
+            return m_min_y;
+        }
+
+        constexpr std::uint32_t max_x() const noexcept {
+            return m_max_x;
+        }
+
+        constexpr std::uint32_t max_y() const noexcept {
+            return m_max_y;
+        }
+
+        /// Is the tile in this range?
+        constexpr bool contains(const tile_address& tile) const noexcept {
+            return tile.zoom() == m_zoom &&
+                   tile.x() >= m_min_x && tile.x() <= m_max_x &&
+                   tile.y() >= m_min_y && tile.y() <= m_max_y;
+        }
+
+    }; // class tile_range
+
+} // namespace tgd_header
+
+#endif // TGD_HEADER_TILE_RANGE_HPP
@@ -46,6 +46,19 @@ namespace tgd_header {
 
     using content_length_type = std::uint32_t;
 
+    using layer_flags_type = std::uint16_t;
+
+    /// Bits in the flags field of the layer header.
+    namespace layer_flags {
+
+        /// The checksum field contains a CRC-32C of the record.
+        constexpr const layer_flags_type checksum = 0x0001;
+
+        /// The content is a reference to content elsewhere in the file.
+        constexpr const layer_flags_type reference = 0x0002;
+
+    } // namespace layer_flags
+
 } // namespace tgd_header
 
 #endif // TGD_HEADER_TYPES_HPP
@@ -0,0 +1,242 @@
+#ifndef TGD_HEADER_URING_SINK_HPP
+#define TGD_HEADER_URING_SINK_HPP
+
+/*****************************************************************************
+
+tgd_header - Encoding and decoding the Tiled Geographic Data Common Header.
+
+This file is from https://github.com/mapbox/tgd-header-lib where you can find
+more documentation.
+
+*****************************************************************************/
+
+/**
+ * @file uring_sink.hpp
+ *
+ * @brief Contains the uring_sink class.
+ */
+
+#include "buffer.hpp"
+#include "encoding.hpp"
+#include "file.hpp"
+#include "io_uring.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <string>
+#include <sys/uio.h>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace tgd_header {
+
+    /**
+     * Sink for writing layers into a file using io_uring (Linux only).
+     *
+     * Data is collected in one of several batch buffers. Once a buffer is
+     * full, it is handed to the kernel to be written asynchronously and
+     * the next buffer is filled in the meantime. Only if all buffers are
+     * in flight, the sink waits for a write to complete. The buffers are
+     * registered with the kernel if possible.
+     *
+     * You have to call flush() or close() to make sure everything is
+     * written. The destructor will try to flush the data, but errors are
+     * ignored there.
+     *
+     * Unlike the file_sink this can only write to regular files, not to
+     * STDOUT.
+     */
+    class uring_sink : public detail::file {
+
+        // A batch buffer and the state of the write in flight from it.
+        struct batch {
+            std::size_t size = 0;
+            std::size_t written = 0;
+            std::uint64_t offset = 0;
+            bool in_flight = false;
+        };
+
+        std::unique_ptr<detail::io_uring> m_ring;
+        std::size_t m_batch_size;
+        std::unique_ptr<char[]> m_data;
+        std::vector<batch> m_batches;
+        std::size_t m_current = 0;
+        std::uint64_t m_offset = 0;
+
+        char* batch_data(std::size_t n) const noexcept {
+            return m_data.get() + n * m_batch_size;
+        }
+
+        void queue_write(std::size_t n) {
+            auto& b = m_batches[n];
+            const char* data = batch_data(n) + b.written;
+            const auto len = static_cast<unsigned>(b.size - b.written);
+            if (m_ring->buffers_registered()) {
+                m_ring->queue(IORING_OP_WRITE_FIXED, fd(), data, len, b.offset + b.written, n, static_cast<unsigned>(n));
+            } else {
+                m_ring->queue(IORING_OP_WRITE, fd(), data, len, b.offset + b.written, n);
+            }
+            b.in_flight = true;
+        }
+
+        // Wait for the next write to complete. Short writes are queued
+        // again with the rest of the data.
+        void wait_one() {
+            const auto cqe = m_ring->wait();
+            auto& b = m_batches[static_cast<std::size_t>(cqe.user_data)];
+            if (cqe.res <= 0) {
+                b.in_flight = false;
+                throw std::system_error{cqe.res < 0 ? -cqe.res : EIO, std::system_category(), "Error writing to file: "};
+            }
+
+            b.written += static_cast<std::size_t>(cqe.res);
+            if (b.written < b.size) {
+                queue_write(static_cast<std::size_t>(cqe.user_data));
+                m_ring->submit();
+                return;
+            }
+
+            b.size = 0;
+            b.written = 0;
+            b.in_flight = false;
+        }
+
+        // Hand the current batch to the kernel and switch to the next one,
+        // waiting until it is free.
+        void submit_current() {
+            auto& b = m_batches[m_current];
+            if (b.size == 0) {
+                return;
+            }
+
+            b.offset = m_offset;
+            m_offset += b.size;
+            queue_write(m_current);
+            m_ring->submit();
+
+            m_current = (m_current + 1) % m_batches.size();
+            while (m_batches[m_current].in_flight) {
+                wait_one();
+            }
+        }
+
+        void append(const char* data, std::size_t size) {
+            while (size > 0) {
+                auto& b = m_batches[m_current];
+                const auto len = std::min(size, m_batch_size - b.size);
+                std::memcpy(batch_data(m_current) + b.size, data, len);
+                b.size += len;
+                data += len;
+                size -= len;
+                if (b.size == m_batch_size) {
+                    submit_current();
+                }
+            }
+        }
+
+    public:
+
+        /// The default number of batch buffers.
+        static constexpr const unsigned default_queue_depth = 4;
+
+        /// The default size of each batch buffer.
+        static constexpr const std::size_t default_batch_size = 1024UL * 1024UL;
+
+        /**
+         * Construct uring_sink writing into the specified file.
+         *
+         * @param filename Name of the output file.
+         * @param queue_depth Number of batch buffers, at most one less
+         *                    than this are written at the same time.
+         * @param batch_size Size of each batch buffer.
+         * @throws std::system_error If the file can't be opened or
+         *                           io_uring is not available.
+         */
+        explicit uring_sink(const std::string& filename, unsigned queue_depth = default_queue_depth, std::size_t batch_size = default_batch_size) :
+            file(open_file(filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)), // NOLINT(hicpp-signed-bitwise)
+            m_ring(new detail::io_uring{std::max(queue_depth, 2U)}), // NOLINT(modernize-make-unique) (not available in C++11)
+            m_batch_size(detail::padded_size(std::max<std::size_t>(batch_size, detail::align_bytes))),
+            m_data(new char[std::max(queue_depth, 2U) * m_batch_size]), // NOLINT(modernize-make-unique) (not available in C++11)
+            m_batches(std::max(queue_depth, 2U)) {
+            std::vector<::iovec> iovecs;
+            for (std::size_t n = 0; n < m_batches.size(); ++n) {
+                iovecs.push_back(::iovec{batch_data(n), m_batch_size});
+            }
+            m_ring->register_buffers(iovecs);
+        }
+
+        uring_sink(const uring_sink&) = delete;
+        uring_sink& operator=(const uring_sink&) = delete;
+
+        uring_sink(uring_sink&& other) noexcept = default;
+        uring_sink& operator=(uring_sink&& other) = delete;
+
+        ~uring_sink() noexcept {
+            try {
+                flush();
+            } catch (...) {
+                // ignore errors so that the destructor can be noexcept
+            }
+            // The kernel must be done with the buffers before they are freed.
+            try {
+                while (m_ring && m_ring->in_flight() > 0) {
+                    m_ring->wait();
+                }
+            } catch (...) {
+                // ignore errors so that the destructor can be noexcept
+            }
+        }
+
+        /// Are the batch buffers registered with the kernel?
+        bool uses_registered_buffers() const noexcept {
+            return m_ring && m_ring->buffers_registered();
+        }
+
+        /// Write out all collected data and wait until it is written.
+        void flush() {
+            if (!m_ring) {
+                return;
+            }
+
+            if (m_batches[m_current].size > 0) {
+                auto& b = m_batches[m_current];
+                b.offset = m_offset;
+                m_offset += b.size;
+                queue_write(m_current);
+                m_current = (m_current + 1) % m_batches.size();
+            }
+
+            while (m_ring->in_flight() > 0) {
+                wait_one();
+            }
+        }
+
+        /// Flush data and close the file.
+        void close() {
+            flush();
+            file::close();
+        }
+
+        /// Write the contents of the buffer to the file.
+        void write(const buffer& buffer) {
+            append(buffer.data(), buffer.size());
+        }
+
+        /// Write size zero bytes to the file for padding.
+        void padding(std::size_t size) {
+            assert(size < detail::align_bytes);
+            static const char pad[detail::align_bytes] = {0};
+            append(pad, size);
+        }
+
+    }; // uring_sink
+
+} // namespace tgd_header
+
+#endif // TGD_HEADER_URING_SINK_HPP
@@ -0,0 +1,317 @@
+#ifndef TGD_HEADER_URING_SOURCE_HPP
+#define TGD_HEADER_URING_SOURCE_HPP
+
+/*****************************************************************************
+
+tgd_header - Encoding and decoding the Tiled Geographic Data Common Header.
+
+This file is from https://github.com/mapbox/tgd-header-lib where you can find
+more documentation.
+
+*****************************************************************************/
+
+/**
+ * @file uring_source.hpp
+ *
+ * @brief Contains the uring_source class.
+ */
+
+#include "buffer.hpp"
+#include "encoding.hpp"
+#include "exceptions.hpp"
+#include "file.hpp"
+#include "io_uring.hpp"
+#include "layer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <fcntl.h>
+#include <memory>
+#include <string>
+#include <sys/uio.h>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace tgd_header {
+
+    /**
+     * Positional source based on a file using io_uring (Linux only). Use
+     * read_layers() to read many layers at known offsets (for instance from
+     * a layer_index) with many reads in flight at the same time. The
+     * layers are handed to a callback in the order the reads complete.
+     *
+     * Each of the queue_depth reads in flight has a slot buffer of its own
+     * which is registered with the kernel if possible. The first read for a
+     * layer reads a whole slot which gets the header, the name, and, for
+     * small layers, the content in one go. The rest of larger layers is read
+     * with a second read.
+     *
+     * Unlike the pread_source a uring_source must not be used from several
+     * threads at the same time. Use one per thread.
+     */
+    class uring_source : public detail::file {
+
+        // Information about a read in flight.
+        struct request {
+            std::size_t index = 0;
+            std::uint64_t offset = 0;
+            layer result{};
+            mutable_buffer content{0};
+            std::size_t done = 0;
+            bool reading_content = false;
+        };
+
+        std::unique_ptr<detail::io_uring> m_ring;
+        unsigned m_queue_depth;
+        std::size_t m_slot_size;
+        std::unique_ptr<char[]> m_slots;
+
+        char* slot(std::size_t n) const noexcept {
+            return m_slots.get() + n * m_slot_size;
+        }
+
+        void queue_slot_read(std::size_t n, std::uint64_t offset) {
+            if (m_ring->buffers_registered()) {
+                m_ring->queue(IORING_OP_READ_FIXED, fd(), slot(n), static_cast<unsigned>(m_slot_size), offset, n, static_cast<unsigned>(n));
+            } else {
+                m_ring->queue(IORING_OP_READ, fd(), slot(n), static_cast<unsigned>(m_slot_size), offset, n);
+            }
+        }
+
+        void queue_content_read(std::size_t n, const request& r) {
+            const auto content_offset = r.offset + detail::header_size + detail::padded_size(r.result.name_length() + 1);
+            m_ring->queue(IORING_OP_READ, fd(), r.content.data() + r.done,
+                          static_cast<unsigned>(r.content.size() - r.done),
+                          content_offset + r.done, n);
+        }
+
+        // Wait for all reads in flight. Used on errors, because the kernel
+        // might still write into the buffers.
+        void drain() noexcept {
+            try {
+                while (m_ring->in_flight() > 0) {
+                    m_ring->wait();
+                }
+            } catch (...) {
+                // ignore errors, we are already handling one
+            }
+        }
+
+        // Handle the completion of the first read of a layer into a slot.
+        // Returns true if the layer is complete.
+        bool handle_slot_read(std::size_t n, request& r, std::size_t len, bool with_content) {
+            if (len == 0) {
+                // no layer here, leave the layer invalid
+                r.result = layer{};
+                return true;
+            }
+
+            const char* data = slot(n);
+            r.result = layer{data, len};
+
+            const auto name_len = detail::padded_size(r.result.name_length() + 1);
+            if (detail::header_size + name_len > len) {
+                throw format_error{"unexpected end of file"};
+            }
+            r.result.set_name_internal(buffer{data + detail::header_size, name_len}.copy());
+
+            if (!with_content) {
+                return true;
+            }
+
+            const auto content_len = detail::padded_size(r.result.wire_content_length());
+            const auto have = std::min<std::size_t>(len - detail::header_size - name_len, content_len);
+
+            r.content = mutable_buffer{content_len};
+            std::copy_n(data + detail::header_size + name_len, have, r.content.data());
+            r.done = have;
+
+            if (have < content_len) {
+                if (len < m_slot_size) {
+                    throw format_error{"unexpected end of file"};
+                }
+                r.reading_content = true;
+                queue_content_read(n, r);
+                return false;
+            }
+
+            r.result.set_wire_content(buffer{std::move(r.content)});
+            return true;
+        }
+
+        // Handle the completion of a read of the rest of the content.
+        // Returns true if the layer is complete.
+        bool handle_content_read(std::size_t n, request& r, std::size_t len) {
+            if (len == 0) {
+                throw format_error{"unexpected end of file"};
+            }
+
+            r.done += len;
+            if (r.done < r.content.size()) {
+                queue_content_read(n, r);
+                return false;
+            }
+
+            r.reading_content = false;
+            r.result.set_wire_content(buffer{std::move(r.content)});
+            return true;
+        }
+
+    public:
+
+        /// The default number of reads in flight.
+        static constexpr const unsigned default_queue_depth = 32;
+
+        /// The default size of the slot buffer for each read.
+        static constexpr const std::size_t default_slot_size = 16UL * 1024UL;
+
+        /**
+         * The minimum size of the slot buffers. The header and name of a
+         * layer must always fit into a slot.
+         */
+        static constexpr const std::size_t min_slot_size = 4096;
+
+        /**
+         * Construct uring_source for the specified file.
+         *
+         * @param filename Name of the input file.
+         * @param queue_depth Maximum number of reads in flight.
+         * @param slot_size Size of the buffer for the first read of each
+         *                  layer (at least min_slot_size).
+         * @throws std::system_error If the file can't be opened or
+         *                           io_uring is not available.
+         */
+        explicit uring_source(const std::string& filename, unsigned queue_depth = default_queue_depth, std::size_t slot_size = default_slot_size) :
+            file(open_file(filename, O_RDONLY | O_CLOEXEC)), // NOLINT(hicpp-signed-bitwise)
+            m_ring(new detail::io_uring{std::max(queue_depth, 1U)}), // NOLINT(modernize-make-unique) (not available in C++11)
+            m_queue_depth(std::max(queue_depth, 1U)),
+            m_slot_size(detail::padded_size(std::max(slot_size, std::size_t{min_slot_size}))),
+            m_slots(new char[m_queue_depth * m_slot_size]) { // NOLINT(modernize-make-unique) (not available in C++11)
+            std::vector<::iovec> iovecs;
+            for (std::size_t n = 0; n < m_queue_depth; ++n) {
+                iovecs.push_back(::iovec{slot(n), m_slot_size});
+            }
+            m_ring->register_buffers(iovecs);
+        }
+
+        /// The maximum number of reads in flight.
+        unsigned queue_depth() const noexcept {
+            return m_queue_depth;
+        }
+
+        /// Are the slot buffers registered with the kernel?
+        bool uses_registered_buffers() const noexcept {
+            return m_ring->buffers_registered();
+        }
+
+        /**
+         * Read exactly len bytes from the file starting at offset and return
+         * them in a managed buffer. If the offset is at or beyond the end of
+         * the file, an empty buffer is returned. This waits for the read to
+         * finish, so it must not be called from a read_layers() callback.
+         *
+         * Unlike pread_source::read_at() this is not const and not
+         * thread-safe, because it uses the ring of this source.
+         *
+         * @throws format_error If the file ends in the middle of the data.
+         * @throws std::system_error If there was an error reading the file.
+         */
+        buffer read_at(const std::uint64_t offset, const std::size_t len) {
+            assert(m_ring->in_flight() == 0);
+            mutable_buffer mb{len};
+
+            std::size_t done = 0;
+            while (done < len) {
+                m_ring->queue(IORING_OP_READ, fd(), mb.data() + done, static_cast<unsigned>(len - done), offset + done, 0);
+                const auto cqe = m_ring->wait();
+                if (cqe.res < 0) {
+                    throw std::system_error{-cqe.res, std::system_category(), "Read error: "};
+                }
+                if (cqe.res == 0) {
+                    break;
+                }
+                done += static_cast<std::size_t>(cqe.res);
+            }
+
+            if (done == 0 && len > 0) {
+                return buffer{};
+            }
+
+            if (done != len) {
+                throw format_error{"unexpected end of file"};
+            }
+
+            return buffer{std::move(mb)};
+        }
+
+        /**
+         * Read the layers at the specified offsets keeping up to
+         * queue_depth() reads in flight. For each layer the callback is
+         * called with the index of the offset in the offsets vector and the
+         * layer as parameters. Layers are handed to the callback in the
+         * order the reads complete, not in the order of the offsets. If
+         * there is no layer at an offset (because it is at the end of the
+         * file), the layer evaluates to false.
+         *
+         * @param offsets The offsets of the layers in the file.
+         * @param func Callback of the form void(std::size_t, layer&).
+         * @param with_content Also read the (still encoded) content. Call
+         *                     layer::decode_content() to decode it.
+         * @throws format_error If the data is not a valid layer.
+         * @throws std::system_error If there was an error reading the file.
+         */
+        template <typename TFunc>
+        void read_layers(const std::vector<std::uint64_t>& offsets, TFunc&& func, bool with_content = true) {
+            assert(m_ring->in_flight() == 0);
+
+            std::vector<request> requests(m_queue_depth);
+            std::size_t next = 0;
+
+            const auto start = [&](std::size_t n) {
+                auto& r = requests[n];
+                r.index = next;
+                r.offset = offsets[next];
+                r.reading_content = false;
+                ++next;
+                queue_slot_read(n, r.offset);
+            };
+
+            try {
+                for (std::size_t n = 0; n < m_queue_depth && next < offsets.size(); ++n) {
+                    start(n);
+                }
+
+                while (m_ring->in_flight() > 0) {
+                    const auto cqe = m_ring->wait();
+                    if (cqe.res < 0) {
+                        throw std::system_error{-cqe.res, std::system_category(), "Read error: "};
+                    }
+
+                    const auto n = static_cast<std::size_t>(cqe.user_data);
+                    auto& r = requests[n];
+                    const auto len = static_cast<std::size_t>(cqe.res);
+
+                    const bool complete = r.reading_content ? handle_content_read(n, r, len)
+                                                            : handle_slot_read(n, r, len, with_content);
+                    if (complete) {
+                        std::forward<TFunc>(func)(r.index, r.result);
+                        r.result = layer{};
+                        if (next < offsets.size()) {
+                            start(n);
+                        }
+                    }
+                }
+            } catch (...) {
+                drain();
+                throw;
+            }
+        }
+
+    }; // uring_source
+
+} // namespace tgd_header
+
+#endif // TGD_HEADER_URING_SOURCE_HPP
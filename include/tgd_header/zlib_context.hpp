@@ -0,0 +1,284 @@
+#ifndef TGD_HEADER_ZLIB_CONTEXT_HPP
+#define TGD_HEADER_ZLIB_CONTEXT_HPP
+
+/*****************************************************************************
+
+tgd_header - Encoding and decoding the Tiled Geographic Data Common Header.
+
+This file is from https://github.com/mapbox/tgd-header-lib where you can find
+more documentation.
+
+*****************************************************************************/
+
+/**
+ * @file zlib_context.hpp
+ *
+ * @brief Contains the zlib_options struct and the zlib_context class.
+ */
+
+#include "buffer.hpp"
+#include "exceptions.hpp"
+#include "memory_resource.hpp"
+
+#include <zlib.h>
+
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <utility>
+
+namespace tgd_header {
+
+    /**
+     * Options for zlib compression. See the documentation of the
+     * deflateInit2() function in the zlib manual for details on level,
+     * window_bits, mem_level, and strategy.
+     */
+    struct zlib_options {
+
+        /// Compression level from 0 (none) to 9 (best).
+        int level = Z_DEFAULT_COMPRESSION;
+
+        /**
+         * Base two logarithm of the window size (9 to 15). Must not be
+         * negative or larger than 15, because the layer format always uses
+         * the zlib wrapper around the compressed data.
+         */
+        int window_bits = MAX_WBITS;
+
+        /// How much memory to use for the compression state (1 to 9).
+        int mem_level = 8;
+
+        /// Compression strategy (Z_DEFAULT_STRATEGY, Z_FILTERED, Z_RLE, ...).
+        int strategy = Z_DEFAULT_STRATEGY;
+
+        /**
+         * Use adaptive compression when encoding layers: Layers that
+         * should be compressed are stored uncompressed if compression
+         * doesn't save at least min_savings percent. Layers with content
+         * types that are already compressed (png, jpeg) are not even
+         * tried.
+         */
+        bool adaptive = false;
+
+        /// Minimum savings in percent for adaptive compression.
+        unsigned int min_savings = 0;
+
+    }; // struct zlib_options
+
+    /**
+     * Keeps the state of the zlib compressor and decompressor around so
+     * that it can be reused for many layers. Initializing the zlib state
+     * allocates quite a bit of memory (about 256 kB for compression), so
+     * this is much faster than the one-shot compress() and uncompress()
+     * functions of zlib if you are working on many (small) layers.
+     *
+     * The compressor and decompressor are initialized on first use and
+     * reset before each use after that.
+     *
+     * The compression settings can be changed using zlib_options.
+     *
+     * The buffers returned from compress() and uncompress() are allocated
+     * from the memory resource set on the context. Use, for instance, an
+     * arena_resource to avoid many small allocations when (de)compressing
+     * lots of layers.
+     *
+     * A zlib_context must not be used from several threads at the same
+     * time. Use one context per thread.
+     */
+    class zlib_context {
+
+        zlib_options m_options{};
+        memory_resource* m_resource = new_delete_resource();
+        z_stream m_deflate_stream{};
+        z_stream m_inflate_stream{};
+        bool m_deflate_initialized = false;
+        bool m_inflate_initialized = false;
+
+        static unsigned char* to_bytes(const char* data) noexcept {
+            // zlib doesn't change the input data, but the pointer isn't
+            // const in older versions of zlib.
+            return reinterpret_cast<unsigned char*>(const_cast<char*>(data)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-type-const-cast)
+        }
+
+        static uInt to_uint(std::size_t size) {
+            if (size > std::numeric_limits<uInt>::max()) {
+                throw zlib_error{"data too large for zlib"};
+            }
+            return static_cast<uInt>(size);
+        }
+
+        z_stream& deflate_stream() {
+            if (m_deflate_initialized) {
+                const auto result = ::deflateReset(&m_deflate_stream);
+                if (result != Z_OK) {
+                    throw zlib_error{std::string{"failed to compress data: "} + zError(result)};
+                }
+            } else {
+                const auto result = ::deflateInit2(&m_deflate_stream,
+                                                   m_options.level,
+                                                   Z_DEFLATED,
+                                                   m_options.window_bits,
+                                                   m_options.mem_level,
+                                                   m_options.strategy);
+                if (result != Z_OK) {
+                    throw zlib_error{std::string{"failed to compress data: "} + zError(result)};
+                }
+                m_deflate_initialized = true;
+            }
+            return m_deflate_stream;
+        }
+
+        z_stream& inflate_stream() {
+            if (m_inflate_initialized) {
+                const auto result = ::inflateReset(&m_inflate_stream);
+                if (result != Z_OK) {
+                    throw zlib_error{std::string{"failed to uncompress data: "} + zError(result)};
+                }
+            } else {
+                const auto result = ::inflateInit(&m_inflate_stream);
+                if (result != Z_OK) {
+                    throw zlib_error{std::string{"failed to uncompress data: "} + zError(result)};
+                }
+                m_inflate_initialized = true;
+            }
+            return m_inflate_stream;
+        }
+
+    public:
+
+        zlib_context() noexcept = default;
+
+        /// Create a context using the specified compression options.
+        explicit zlib_context(const zlib_options& options) noexcept :
+            m_options(options) {
+        }
+
+        /**
+         * Create a context using the specified compression options and
+         * memory resource.
+         */
+        zlib_context(const zlib_options& options, memory_resource* resource) noexcept :
+            m_options(options),
+            m_resource(resource) {
+            assert(resource);
+        }
+
+        // The z_stream structs can't be copied or moved, because zlib keeps
+        // pointers to them in its internal state.
+        zlib_context(const zlib_context&) = delete;
+        zlib_context& operator=(const zlib_context&) = delete;
+
+        zlib_context(zlib_context&&) = delete;
+        zlib_context& operator=(zlib_context&&) = delete;
+
+        ~zlib_context() noexcept {
+            if (m_deflate_initialized) {
+                ::deflateEnd(&m_deflate_stream);
+            }
+            if (m_inflate_initialized) {
+                ::inflateEnd(&m_inflate_stream);
+            }
+        }
+
+        /// The compression options used.
+        const zlib_options& options() const noexcept {
+            return m_options;
+        }
+
+        /**
+         * Change the compression options. They will be used from the next
+         * call to compress() on.
+         */
+        void set_options(const zlib_options& options) noexcept {
+            m_options = options;
+            if (m_deflate_initialized) {
+                ::deflateEnd(&m_deflate_stream);
+                m_deflate_stream = z_stream{};
+                m_deflate_initialized = false;
+            }
+        }
+
+        /// The memory resource used for the output buffers.
+        memory_resource* resource() const noexcept {
+            return m_resource;
+        }
+
+        /**
+         * Set the memory resource used for the output buffers of
+         * compress() and uncompress().
+         */
+        void set_resource(memory_resource* resource) noexcept {
+            assert(resource);
+            m_resource = resource;
+        }
+
+        /**
+         * Compress the data.
+         *
+         * @returns A managed buffer with the compressed data.
+         * @throws zlib_error If there is a problem compressing the data
+         *                    or the compression options are invalid.
+         */
+        buffer compress(const char* data, std::size_t size) {
+            auto& stream = deflate_stream();
+
+            mutable_buffer output{::deflateBound(&stream, static_cast<uLong>(size)), m_resource};
+
+            stream.next_in = to_bytes(data);
+            stream.avail_in = to_uint(size);
+            stream.next_out = reinterpret_cast<unsigned char*>(output.data()); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+            stream.avail_out = to_uint(output.size());
+
+            const auto result = ::deflate(&stream, Z_FINISH);
+            if (result != Z_STREAM_END) {
+                throw zlib_error{std::string{"failed to compress data: "} + zError(result == Z_OK ? Z_BUF_ERROR : result)};
+            }
+
+            return buffer{std::move(output), static_cast<std::size_t>(stream.total_out)};
+        }
+
+        /**
+         * Uncompress the data. The size of the uncompressed data must be
+         * known beforehand.
+         *
+         * @returns A managed buffer with the uncompressed data.
+         * @throws zlib_error If there is a problem uncompressing the data
+         *                    or it is larger than raw_size.
+         * @throws format_error If the uncompressed data is smaller than
+         *                      raw_size.
+         */
+        buffer uncompress(const char* data, std::size_t size, std::size_t raw_size) {
+            auto& stream = inflate_stream();
+
+            mutable_buffer output{raw_size, m_resource};
+
+            stream.next_in = to_bytes(data);
+            stream.avail_in = to_uint(size);
+            stream.next_out = reinterpret_cast<unsigned char*>(output.data()); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+            stream.avail_out = to_uint(raw_size);
+
+            auto result = ::inflate(&stream, Z_FINISH);
+
+            // Report errors the same way zlib's uncompress() does.
+            if (result == Z_NEED_DICT || (result == Z_BUF_ERROR && stream.avail_out > 0)) {
+                result = Z_DATA_ERROR;
+            }
+
+            if (result != Z_STREAM_END) {
+                throw zlib_error{std::string{"failed to uncompress data: "} + zError(result == Z_OK ? Z_BUF_ERROR : result)};
+            }
+
+            if (stream.total_out != raw_size) {
+                throw format_error{"wrong original size on compressed data"};
+            }
+
+            return buffer{std::move(output)};
+        }
+
+    }; // class zlib_context
+
+} // namespace tgd_header
+
+#endif // TGD_HEADER_ZLIB_CONTEXT_HPP
@@ -0,0 +1,57 @@
+#ifndef TEST_LAYERS_HPP
+#define TEST_LAYERS_HPP
+
+// Layers for tests reading many layers at known offsets. Layer i is named
+// "layerI", is in tile 10/i/2 and its content is content_size(i) times the
+// same letter.
+
+#include <tgd_header/layer.hpp>
+#include <tgd_header/string_sink.hpp>
+#include <tgd_header/tile.hpp>
+#include <tgd_header/types.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using test_content_size_func = std::size_t (*)(std::size_t);
+
+inline std::string test_layer_content(std::size_t i, test_content_size_func content_size) {
+    return std::string(content_size(i), static_cast<char>('a' + i % 26));
+}
+
+// Write count layers into a string and add their offsets to offsets.
+inline std::string make_test_layers(std::vector<std::uint64_t>& offsets,
+                                    std::size_t count,
+                                    test_content_size_func content_size,
+                                    tgd_header::layer_compression_type compression) {
+    std::string out;
+    tgd_header::string_sink sink{out};
+    for (std::size_t i = 0; i < count; ++i) {
+        offsets.push_back(out.size());
+        const auto name = "layer" + std::to_string(i);
+        const auto content = test_layer_content(i, content_size);
+        tgd_header::layer layer;
+        layer.set_name(name.c_str());
+        layer.set_tile(tgd_header::tile_address{10, static_cast<std::uint32_t>(i), 2});
+        layer.set_compression_type(compression);
+        layer.set_content(content.data(), content.size());
+        layer.write(sink);
+    }
+    return out;
+}
+
+// Check that this is layer i written by make_test_layers(). Loads the
+// content if needed.
+inline bool check_test_layer(tgd_header::layer& layer, std::size_t i, test_content_size_func content_size) {
+    if (!layer ||
+        !layer.has_name("layer" + std::to_string(i)) ||
+        layer.tile() != tgd_header::tile_address(10, static_cast<std::uint32_t>(i), 2)) {
+        return false;
+    }
+    const auto& content = layer.load_content();
+    return std::string(content.data(), content.size()) == test_layer_content(i, content_size);
+}
+
+#endif // TEST_LAYERS_HPP
@@ -0,0 +1,132 @@
+
+#include <catch.hpp>
+
+#include <tgd_header/archive_writer.hpp>
+#include <tgd_header/buffer.hpp>
+#include <tgd_header/index.hpp>
+#include <tgd_header/layer.hpp>
+#include <tgd_header/layer_view.hpp>
+#include <tgd_header/pread_source.hpp>
+#include <tgd_header/string_sink.hpp>
+#include <tgd_header/tile_key.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+static tgd_header::layer make_layer(const tgd_header::tile_address& tile, const char* name) {
+    tgd_header::layer layer;
+    layer.set_name(name);
+    layer.set_tile(tile);
+    layer.set_content_type(tgd_header::layer_content_type::vt2);
+    layer.set_content(name, std::strlen(name));
+    return layer;
+}
+
+TEST_CASE("Write archive") {
+    const auto filename = "test_file_26";
+    const std::string staging_filename = std::string{filename} + ".tmp";
+
+    std::string index_data;
+    std::uint64_t size = 0;
+    {
+        tgd_header::archive_writer writer{filename};
+
+        // add tiles in row-major order, layers of a tile not together
+        for (const char* name : {"water", "roads"}) {
+            for (std::uint32_t y = 0; y < 8; ++y) {
+                for (std::uint32_t x = 0; x < 8; ++x) {
+                    auto layer = make_layer(tgd_header::tile_address{3, x, y}, name);
+                    writer.add(layer);
+                }
+            }
+        }
+
+        // add one layer from memory
+        std::string record;
+        tgd_header::string_sink sink{record};
+        auto layer = make_layer(tgd_header::tile_address{}, "world");
+        layer.write(sink);
+        writer.add(tgd_header::layer_view{record.data(), record.size()});
+
+        REQUIRE(writer.size() == 129);
+        REQUIRE(access(staging_filename.c_str(), F_OK) == 0);
+
+        tgd_header::string_sink index_sink{index_data};
+        size = writer.close(index_sink);
+
+        REQUIRE_THROWS_AS(writer.add(layer), const std::logic_error&);
+    }
+
+    REQUIRE(access(staging_filename.c_str(), F_OK) != 0);
+
+    const tgd_header::pread_source source{filename};
+    REQUIRE(source.file_size() == size);
+    const auto data = source.read_at(0, size);
+
+    std::vector<tgd_header::layer_view> views;
+    for (const auto& view : tgd_header::layer_view_range{data}) {
+        views.push_back(view);
+    }
+    REQUIRE(views.size() == 129);
+
+    REQUIRE(views[0].tile() == tgd_header::tile_address{});
+    REQUIRE(views[0].has_name("world"));
+
+    for (std::size_t n = 1; n < views.size(); n += 2) {
+        // all layers of a tile are together
+        REQUIRE(views[n].tile() == views[n + 1].tile());
+        REQUIRE(views[n].has_name("roads"));
+        REQUIRE(views[n + 1].has_name("water"));
+
+        // tiles follow the Hilbert curve
+        REQUIRE(tgd_header::hilbert_key(views[n].tile()) == (n - 1) / 2);
+    }
+
+    const tgd_header::layer_index index{tgd_header::buffer{index_data.data(), index_data.size()}};
+    REQUIRE(index.size() == 129);
+    for (const auto& view : views) {
+        const auto entry = index.find(view.tile(), std::string(view.name(), view.name_length()));
+        REQUIRE(entry);
+        REQUIRE(entry.offset() == static_cast<std::uint64_t>(view.data() - data.data()));
+        REQUIRE(entry.size() == view.record_size());
+    }
+
+    unlink(filename);
+}
+
+TEST_CASE("Empty archive") {
+    const auto filename = "test_file_27";
+
+    std::string index_data;
+    {
+        tgd_header::archive_writer writer{filename};
+        tgd_header::string_sink index_sink{index_data};
+        REQUIRE(writer.close(index_sink) == 0);
+    }
+
+    REQUIRE(tgd_header::pread_source{filename}.file_size() == 0);
+    const tgd_header::layer_index index{tgd_header::buffer{index_data.data(), index_data.size()}};
+    REQUIRE(index.empty());
+
+    unlink(filename);
+}
+
+TEST_CASE("Archive writer removes staging file if not closed") {
+    const auto filename = "test_file_28";
+    const std::string staging_filename = std::string{filename} + ".tmp";
+
+    {
+        tgd_header::archive_writer writer{filename};
+        auto layer = make_layer(tgd_header::tile_address{1, 1, 1}, "water");
+        writer.add(layer);
+        REQUIRE(access(staging_filename.c_str(), F_OK) == 0);
+    }
+
+    REQUIRE(access(staging_filename.c_str(), F_OK) != 0);
+    REQUIRE(access(filename, F_OK) != 0);
+}
+
@@ -26,7 +26,7 @@ TEST_CASE("Empty buffer") {
 }
 
 TEST_CASE("Non-managed buffer") {
-    char a;
+    char a = 0;
     tgd_header::buffer b{&a, 1};
 
     REQUIRE(b);
@@ -45,7 +45,7 @@ TEST_CASE("Non-managed buffer") {
 }
 
 TEST_CASE("Non-managed buffer (explicit)") {
-    char a;
+    char a = 0;
     tgd_header::buffer b{&a, 1, false};
 
     REQUIRE(b);
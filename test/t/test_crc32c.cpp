@@ -0,0 +1,46 @@
+#include <catch.hpp>
+
+#include <tgd_header/crc32c.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+TEST_CASE("CRC-32C of known data") {
+    REQUIRE(tgd_header::crc32c("", 0) == 0);
+    REQUIRE(tgd_header::crc32c("123456789", 9) == 0xe3069283U);
+
+    const std::string zeros(32, '\0');
+    REQUIRE(tgd_header::crc32c(zeros.data(), zeros.size()) == 0x8a9136aaU);
+
+    const std::string ones(32, '\xff');
+    REQUIRE(tgd_header::crc32c(ones.data(), ones.size()) == 0x62a8ab43U);
+}
+
+TEST_CASE("CRC-32C of data in pieces is the same as in one go") {
+    std::string data;
+    for (int i = 0; i < 1000; ++i) {
+        data += std::to_string(i * 7919);
+    }
+
+    const auto crc = tgd_header::crc32c(data.data(), data.size());
+
+    for (std::size_t split : {0, 1, 3, 8, 13, 100, 1001}) {
+        const auto first = tgd_header::crc32c(data.data(), split);
+        REQUIRE(tgd_header::crc32c(data.data() + split, data.size() - split, first) == crc);
+    }
+}
+
+TEST_CASE("CRC-32C implementations give the same results") {
+    std::string data;
+    for (int i = 0; i < 300; ++i) {
+        data += static_cast<char>(i * 37);
+    }
+
+    for (std::size_t offset = 0; offset < 8; ++offset) {
+        for (std::size_t size = 0; size < data.size() - offset; size += 7) {
+            const auto expected = ~tgd_header::detail::crc32c_software(~0U, data.data() + offset, size);
+            REQUIRE(tgd_header::crc32c(data.data() + offset, size) == expected);
+        }
+    }
+}
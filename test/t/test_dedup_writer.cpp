@@ -0,0 +1,304 @@
+
+#include <catch.hpp>
+
+#include <tgd_header/buffer.hpp>
+#include <tgd_header/buffer_source.hpp>
+#include <tgd_header/buffered_file_source.hpp>
+#include <tgd_header/dedup_writer.hpp>
+#include <tgd_header/file_sink.hpp>
+#include <tgd_header/index.hpp>
+#include <tgd_header/layer.hpp>
+#include <tgd_header/layer_view.hpp>
+#include <tgd_header/reader.hpp>
+#include <tgd_header/scanner.hpp>
+#include <tgd_header/string_sink.hpp>
+
+#include <cstdint>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+static const std::string ocean(100, 'o');
+static const std::string land(100, 'l');
+
+static tgd_header::layer make_layer(std::uint32_t x, const std::string& content, bool checksum = false) {
+    tgd_header::layer layer;
+    layer.set_name("water");
+    layer.set_tile(tgd_header::tile_address{4, x, 3});
+    layer.set_content_type(tgd_header::layer_content_type::vt2);
+    layer.set_content(content.data(), content.size());
+    layer.enable_checksum(checksum);
+    return layer;
+}
+
+static std::string content_of(tgd_header::layer& layer) {
+    const auto& content = layer.load_content();
+    return std::string(content.data(), content.size());
+}
+
+// Writes ocean, land, ocean, ocean, land, and a small layer twice.
+static std::string write_layers(std::vector<std::uint64_t>& offsets, bool checksum = false) {
+    std::string data;
+    tgd_header::string_sink sink{data};
+    tgd_header::dedup_writer<tgd_header::string_sink> writer{sink};
+
+    std::uint32_t x = 0;
+    for (const auto* content : {&ocean, &land, &ocean, &ocean, &land}) {
+        auto layer = make_layer(x++, *content, checksum);
+        offsets.push_back(writer.offset());
+        writer.write(layer);
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        auto layer = make_layer(x++, "tiny", checksum);
+        offsets.push_back(writer.offset());
+        writer.write(layer);
+    }
+
+    REQUIRE(writer.offset() == data.size());
+    REQUIRE(writer.layers() == 7);
+    REQUIRE(writer.references() == 3);
+    REQUIRE(writer.unique_contents() == 2);
+    REQUIRE(writer.bytes_saved() == 3 * (104 - tgd_header::detail::reference_size));
+
+    return data;
+}
+
+TEST_CASE("Dedup writer stores identical content once") {
+    std::vector<std::uint64_t> offsets;
+    const auto data = write_layers(offsets);
+
+    const tgd_header::buffer b{data.data(), data.size()};
+    const tgd_header::layer_view_range range{b};
+
+    std::vector<tgd_header::layer_view> views;
+    for (const auto& view : range) {
+        views.push_back(view);
+    }
+    REQUIRE(views.size() == 7);
+
+    REQUIRE_FALSE(views[0].is_reference());
+    REQUIRE_FALSE(views[1].is_reference());
+    REQUIRE(views[2].is_reference());
+    REQUIRE(views[3].is_reference());
+    REQUIRE(views[4].is_reference());
+    REQUIRE_FALSE(views[5].is_reference());
+    REQUIRE_FALSE(views[6].is_reference());
+
+    REQUIRE(views[2].record_size() == 32 + 8 + 16);
+    REQUIRE(views[2].reference_offset() == offsets[0] + 32 + 8);
+    REQUIRE(views[2].reference_length() == 100);
+    REQUIRE(views[4].reference_offset() == offsets[1] + 32 + 8);
+
+    REQUIRE(range.wire_content(views[3]).data() == views[0].wire_content().data());
+    REQUIRE(range.wire_content(views[1]).data() == views[1].wire_content().data());
+
+    auto layer = range.to_layer(views[4]);
+    REQUIRE(layer.is_reference());
+    REQUIRE(layer.tile() == (tgd_header::tile_address{4, 4, 3}));
+    REQUIRE(content_of(layer) == land);
+}
+
+TEST_CASE("Reader resolves references") {
+    std::vector<std::uint64_t> offsets;
+    const auto data = write_layers(offsets);
+
+    const tgd_header::buffer b{data.data(), data.size()};
+    tgd_header::buffer_source source{b};
+    tgd_header::reader<tgd_header::buffer_source> reader{source};
+
+    const std::vector<std::string> expected{ocean, land, ocean, ocean, land, "tiny", "tiny"};
+    std::size_t n = 0;
+    while (auto& layer = reader.next_layer()) {
+        REQUIRE(reader.layer_offset() == offsets[n]);
+        REQUIRE(layer.wire_content_length() == expected[n].size());
+        REQUIRE(content_of(layer) == expected[n]);
+        ++n;
+    }
+    REQUIRE(n == 7);
+
+    for (std::size_t i = 0; i < offsets.size(); ++i) {
+        auto layer = tgd_header::read_layer_at(source, offsets[i], i % 2 == 0);
+        REQUIRE(layer.is_reference() == (i >= 2 && i <= 4));
+        REQUIRE(content_of(layer) == expected[i]);
+    }
+}
+
+TEST_CASE("Index marks reference records") {
+    std::vector<std::uint64_t> offsets;
+    const auto data = write_layers(offsets);
+
+    const tgd_header::buffer b{data.data(), data.size()};
+    tgd_header::buffer_source source{b};
+    tgd_header::reader<tgd_header::buffer_source> reader{source};
+
+    tgd_header::layer_index_builder builder;
+    while (auto& layer = reader.next_layer()) {
+        builder.add(layer, reader.layer_offset());
+    }
+
+    std::string index_data;
+    tgd_header::string_sink sink{index_data};
+    builder.write(sink);
+
+    const tgd_header::layer_index index{tgd_header::buffer{index_data.data(), index_data.size()}};
+    REQUIRE(index.size() == 7);
+    for (std::size_t i = 0; i < index.size(); ++i) {
+        const auto entry = index[i];
+        REQUIRE(entry.tile().x() == i);
+        REQUIRE(entry.is_reference() == (i >= 2 && i <= 4));
+    }
+}
+
+namespace {
+
+    // A source with only read() and skip(), no read_at().
+    class sequential_source {
+
+        tgd_header::buffer_source m_source;
+
+    public:
+
+        explicit sequential_source(const tgd_header::buffer& data) :
+            m_source(data) {
+        }
+
+        tgd_header::buffer read(const std::size_t len) {
+            return m_source.read(len);
+        }
+
+        void skip(const std::size_t len) {
+            m_source.skip(len);
+        }
+
+    }; // class sequential_source
+
+} // anonymous namespace
+
+static_assert(!tgd_header::detail::has_read_at<sequential_source>(), "sequential_source has no read_at()");
+static_assert(tgd_header::detail::has_read_at<tgd_header::buffer_source>(), "buffer_source has read_at()");
+
+TEST_CASE("Reader on source without read_at() can't get content of references") {
+    std::vector<std::uint64_t> offsets;
+    const auto data = write_layers(offsets);
+
+    const tgd_header::buffer b{data.data(), data.size()};
+    sequential_source source{b};
+    tgd_header::reader<sequential_source> reader{source};
+
+    const std::vector<std::string> expected{ocean, land, ocean, ocean, land, "tiny", "tiny"};
+    std::size_t n = 0;
+    while (auto& layer = reader.next_layer()) {
+        REQUIRE(layer.wire_content_length() == expected[n].size());
+        if (layer.is_reference()) {
+            REQUIRE_THROWS_AS(layer.load_content(), const tgd_header::format_error&);
+        } else {
+            REQUIRE(content_of(layer) == expected[n]);
+        }
+        ++n;
+    }
+    REQUIRE(n == 7);
+}
+
+TEST_CASE("Reader resolves references in files") {
+    const auto filename = "test_file_29";
+
+    std::vector<std::uint64_t> offsets;
+    {
+        const auto data = write_layers(offsets);
+        tgd_header::file_sink sink{filename};
+        sink.write(tgd_header::buffer{data.data(), data.size()});
+        sink.close();
+    }
+
+    tgd_header::buffered_file_source source{filename};
+    tgd_header::reader<decltype(source)> reader{source};
+
+    // skip over the first layers without reading their content
+    reader.next_layer();
+    reader.next_layer();
+
+    auto& layer = reader.next_layer();
+    REQUIRE(layer.is_reference());
+    REQUIRE(content_of(layer) == ocean);
+
+    REQUIRE(content_of(reader.next_layer()) == ocean);
+    REQUIRE(content_of(reader.next_layer()) == land);
+
+    unlink(filename);
+}
+
+TEST_CASE("Writing a reference writes the content") {
+    std::vector<std::uint64_t> offsets;
+    const auto data = write_layers(offsets, true);
+
+    const tgd_header::buffer b{data.data(), data.size()};
+    const tgd_header::buffer_source source{b};
+
+    auto layer = tgd_header::read_layer_at(source, offsets[3]);
+    REQUIRE(layer.is_reference());
+    REQUIRE(layer.has_checksum());
+    REQUIRE(layer.verify_checksum());
+    REQUIRE(layer.record_size() == 32 + 8 + 16);
+
+    std::string out;
+    tgd_header::string_sink sink{out};
+    const auto size = layer.write(sink);
+    REQUIRE_FALSE(layer.is_reference());
+    REQUIRE(size == 32 + 8 + 104);
+    REQUIRE(out.size() == size);
+
+    const tgd_header::layer_view view{out.data(), out.size()};
+    REQUIRE_FALSE(view.is_reference());
+    REQUIRE(view.verify_checksum());
+    REQUIRE(view.tile() == (tgd_header::tile_address{4, 3, 3}));
+    REQUIRE(std::string(view.wire_content().data(), view.wire_content_length()) == ocean);
+}
+
+TEST_CASE("Checksums of reference records") {
+    std::vector<std::uint64_t> offsets;
+    auto data = write_layers(offsets, true);
+
+    for (const auto& view : tgd_header::layer_view_range{data.data(), data.size()}) {
+        REQUIRE(view.verify_checksum());
+    }
+    REQUIRE(tgd_header::check_record(data.data() + offsets[2], data.size() - offsets[2]) == 32 + 8 + 16);
+
+    // change the offset in the reference
+    data[offsets[2] + 32 + 8] ^= 1;
+    REQUIRE_FALSE(tgd_header::layer_view(data.data() + offsets[2], 56).verify_checksum());
+    REQUIRE(tgd_header::check_record(data.data() + offsets[2], data.size() - offsets[2]) == 0);
+}
+
+TEST_CASE("Invalid references") {
+    std::vector<std::uint64_t> offsets;
+    auto data = write_layers(offsets);
+
+    SECTION("reference outside of data") {
+        data[offsets[2] + 32 + 8 + 4] = 1;
+
+        const tgd_header::layer_view_range range{data.data(), data.size()};
+        const tgd_header::layer_view view{data.data() + offsets[2], 56};
+        REQUIRE_THROWS_AS(range.wire_content(view), const tgd_header::format_error&);
+
+        const tgd_header::buffer b{data.data(), data.size()};
+        const tgd_header::buffer_source source{b};
+        REQUIRE_THROWS_AS(tgd_header::read_layer_at(source, offsets[2]), const tgd_header::format_error&);
+    }
+
+    SECTION("reference record with wrong size") {
+        data[offsets[2] + 28] = 24;
+
+        REQUIRE_THROWS_AS(tgd_header::layer_view(data.data() + offsets[2], 64), const tgd_header::format_error&);
+        REQUIRE_THROWS_AS(tgd_header::layer(data.data() + offsets[2], 32), const tgd_header::format_error&);
+        REQUIRE(tgd_header::check_record(data.data() + offsets[2], data.size() - offsets[2]) == 0);
+    }
+
+    SECTION("reference from view can't be written without resolving it") {
+        const tgd_header::layer_view view{data.data() + offsets[2], 56};
+        auto layer = view.to_layer();
+        std::string out;
+        tgd_header::string_sink sink{out};
+        REQUIRE_THROWS_AS(layer.write(sink), const tgd_header::format_error&);
+    }
+}
@@ -1,12 +1,24 @@
 
 #include <catch.hpp>
+#include <test_layers.hpp>
 
+#include <tgd_header/buffer_source.hpp>
+#include <tgd_header/buffered_file_source.hpp>
+#include <tgd_header/cursor.hpp>
 #include <tgd_header/file_sink.hpp>
 #include <tgd_header/file_source.hpp>
+#include <tgd_header/layer.hpp>
 #include <tgd_header/mmap_source.hpp>
+#include <tgd_header/pread_source.hpp>
+#include <tgd_header/reader.hpp>
+#include <tgd_header/string_sink.hpp>
 
 #include <algorithm>
+#include <cstring>
+#include <string>
+#include <thread>
 #include <type_traits>
+#include <vector>
 
 static_assert(!std::is_copy_constructible<tgd_header::file_source>(), "file_source should not be copy constructible");
 static_assert(!std::is_copy_assignable<tgd_header::file_source>(), "file_source should not be copy constructible");
@@ -14,6 +26,9 @@ static_assert(!std::is_copy_assignable<tgd_header::file_source>(), "file_source
 static_assert(!std::is_copy_constructible<tgd_header::mmap_source>(), "mmap_source should not be copy constructible");
 static_assert(!std::is_copy_assignable<tgd_header::mmap_source>(), "mmap_source should not be copy constructible");
 
+static_assert(!std::is_copy_constructible<tgd_header::buffered_file_source>(), "buffered_file_source should not be copy constructible");
+static_assert(!std::is_copy_assignable<tgd_header::buffered_file_source>(), "buffered_file_source should not be copy constructible");
+
 static_assert(!std::is_copy_constructible<tgd_header::file_sink>(), "file_sink should not be copy constructible");
 static_assert(!std::is_copy_assignable<tgd_header::file_sink>(), "file_sink should not be copy constructible");
 
@@ -213,8 +228,416 @@ TEST_CASE("Mmapping zero-length file fails") {
     tgd_header::file_sink sink{filename};
     sink.close();
 
-    // XXX this should fail (length is zero), but doesn't for some reason
-    // tgd_header::mmap_source source{filename};
+    REQUIRE_THROWS_AS(tgd_header::mmap_source{filename}, const std::system_error&);
+
+    unlink(filename);
+}
+
+TEST_CASE("Read using mmap with different options") {
+    const auto filename = "test_file_9";
+
+    // larger than the chunks used for drop behind
+    std::string data;
+    for (std::size_t i = 0; data.size() < 9UL * 1024UL * 1024UL; ++i) {
+        data += std::to_string(i);
+        data += ',';
+    }
+
+    {
+        tgd_header::file_sink sink{filename};
+        sink.write(tgd_header::buffer{data.data(), data.size()});
+        sink.close();
+    }
+
+    tgd_header::mmap_options options;
+
+    SECTION("default options") {
+    }
+
+    SECTION("sequential access with readahead and drop behind") {
+        options.access = tgd_header::mmap_access::sequential;
+        options.readahead = 64UL * 1024UL;
+        options.drop_behind = true;
+    }
+
+    SECTION("random access") {
+        options.access = tgd_header::mmap_access::random;
+    }
+
+    SECTION("populate and huge pages") {
+        options.populate = true;
+        options.huge_pages = true;
+    }
+
+    tgd_header::mmap_source source{filename, options};
+    REQUIRE(source.options().access == options.access);
+
+    source.prefetch(1000, 100000);
+    source.prefetch(data.size() - 10, 100000);
+    source.prefetch(data.size() + 10, 100000);
+
+    std::string in;
+    while (auto b = source.read(1000)) {
+        in.append(b.data(), b.size());
+    }
+    const auto rest = data.size() - in.size();
+    const auto b = source.read(rest);
+    in.append(b.data(), b.size());
+    REQUIRE(in == data);
+
+    source.advise(tgd_header::mmap_access::random);
+    REQUIRE(source.options().access == tgd_header::mmap_access::random);
+
+    source.seek(12345);
+    const auto b2 = source.read(10);
+    REQUIRE(std::string(b2.data(), b2.size()) == data.substr(12345, 10));
+
+    unlink(filename);
+}
+
+TEST_CASE("Read buffers using buffered file source with small window") {
+    const auto filename = "test_file_16";
+    const char data[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+    const auto data_size = sizeof(data) - 1;
+
+    {
+        tgd_header::file_sink sink{filename};
+        sink.write(tgd_header::buffer{data, data_size});
+        sink.close();
+    }
+
+    tgd_header::buffered_file_source source{filename, 8};
+    REQUIRE(source.window_size() == 8);
+
+    const auto b1 = source.read(5);
+    REQUIRE(std::string(b1.data(), b1.size()) == "01234");
+    REQUIRE_FALSE(b1.managed());
+
+    // needs a refill, b1 must still be valid afterwards
+    const auto b2 = source.read(6);
+    REQUIRE(std::string(b2.data(), b2.size()) == "56789a");
+    REQUIRE(std::string(b1.data(), b1.size()) == "01234");
+
+    source.skip(3);
+
+    // larger than the window
+    const auto b3 = source.read(10);
+    REQUIRE(b3.managed());
+    REQUIRE(std::string(b3.data(), b3.size()) == "efghijklmn");
+
+    // skip beyond the window
+    source.skip(8);
+
+    const auto b4 = source.read(4);
+    REQUIRE(std::string(b4.data(), b4.size()) == "wxyz");
+
+    const auto end_buffer = source.read(1);
+    REQUIRE_FALSE(end_buffer);
+
+    unlink(filename);
+}
+
+TEST_CASE("Buffered file source throws on truncated data") {
+    const auto filename = "test_file_10";
+
+    {
+        tgd_header::file_sink sink{filename};
+        sink.padding(5);
+        sink.close();
+    }
+
+    tgd_header::buffered_file_source source{filename, 8};
+    REQUIRE_THROWS_AS(source.read(6), const tgd_header::format_error&);
+
+    tgd_header::buffered_file_source source2{filename, 2};
+    REQUIRE_THROWS_AS(source2.read(6), const tgd_header::format_error&);
+
+    unlink(filename);
+}
+
+TEST_CASE("Read layers using buffered file source") {
+    const auto filename = "test_file_11";
+    const char content[] = "some content for the layers in this file";
+
+    {
+        tgd_header::file_sink sink{filename};
+        for (int i = 0; i < 20; ++i) {
+            const auto name = "layer" + std::to_string(i);
+            tgd_header::layer layer;
+            layer.set_name(name.c_str());
+            layer.set_compression_type(i % 2 ? tgd_header::layer_compression_type::zlib
+                                             : tgd_header::layer_compression_type::uncompressed);
+            layer.set_content(content, static_cast<std::size_t>(i) * 2);
+            layer.write(sink);
+        }
+        sink.close();
+    }
+
+    for (const std::size_t window_size : {64, 100, 1024}) {
+        tgd_header::buffered_file_source source{filename, window_size};
+        tgd_header::reader<decltype(source)> reader{source};
+
+        std::size_t count = 0;
+        while (auto& layer = reader.next_layer()) {
+            if (count % 3) {
+                reader.read_content();
+                layer.decode_content();
+                REQUIRE(layer.content_length() == count * 2);
+                REQUIRE(!std::memcmp(layer.content().data(), content, layer.content_length()));
+            }
+            REQUIRE(layer.has_name("layer" + std::to_string(count)));
+            ++count;
+        }
+        REQUIRE(count == 20);
+    }
+
+    unlink(filename);
+}
+
+static std::string read_whole_file(const char* filename) {
+    tgd_header::file_source source{filename};
+    const auto buffer = source.read(source.file_size());
+    return std::string(buffer.data(), buffer.size());
+}
+
+static void write_test_layers(tgd_header::file_sink& sink, const std::string& content) {
+    for (std::size_t i = 1; i < 12; ++i) {
+        tgd_header::layer layer;
+        layer.set_name(std::string(i, 'n').c_str());
+        layer.set_compression_type(i % 2 ? tgd_header::layer_compression_type::zlib
+                                         : tgd_header::layer_compression_type::uncompressed);
+        layer.set_content(content.data(), i * i * 10);
+        layer.write(sink);
+    }
+}
+
+TEST_CASE("Write layers with and without batching gives same result") {
+    const auto filename_a = "test_file_12";
+    const auto filename_b = "test_file_13";
+
+    std::string content;
+    for (int i = 0; i < 2000; ++i) {
+        content += std::to_string(i);
+    }
+
+    {
+        tgd_header::file_sink sink{filename_a};
+        write_test_layers(sink, content);
+        sink.close();
+    }
+
+    const auto a = read_whole_file(filename_a);
+
+    for (const std::size_t batch_size : {1, 100, 1000, 1000000}) {
+        {
+            tgd_header::file_sink sink{filename_b, batch_size};
+            write_test_layers(sink, content);
+            sink.padding(3);
+            sink.write(tgd_header::buffer{"abc", 3});
+            sink.close();
+        }
+
+        const auto b = read_whole_file(filename_b);
+        REQUIRE(a + std::string(3, '\0') + "abc" == b);
+    }
+
+    unlink(filename_a);
+    unlink(filename_b);
+}
+
+TEST_CASE("Batched data is only written on flush") {
+    const auto filename = "test_file_14";
+
+    tgd_header::file_sink sink{filename, 1000};
+
+    tgd_header::layer layer;
+    layer.set_name("test");
+    layer.set_content("abc", 3);
+    layer.write(sink);
+    REQUIRE(sink.file_size() == 0);
+
+    tgd_header::file_sink sink2{std::move(sink)};
+    sink2.flush();
+    REQUIRE(sink2.file_size() == 48);
+
+    sink2.close();
+    unlink(filename);
+}
+
+TEST_CASE("Batched data is flushed on destruction") {
+    const auto filename = "test_file_15";
+
+    {
+        tgd_header::file_sink sink{filename, 1000};
+        sink.write(tgd_header::buffer{"abc", 3});
+    }
+
+    REQUIRE(read_whole_file(filename) == "abc");
+
+    unlink(filename);
+}
+
+TEST_CASE("Copy ranges from one file to another") {
+    const auto filename_in = "test_file_24";
+    const auto filename_out = "test_file_25";
+
+    std::string data;
+    for (int i = 0; i < 50000; ++i) {
+        data += std::to_string(i);
+    }
+
+    {
+        tgd_header::file_sink sink{filename_in};
+        sink.write(tgd_header::buffer{data.data(), data.size()});
+        sink.close();
+    }
+
+    const tgd_header::pread_source input{filename_in};
+
+    {
+        tgd_header::file_sink sink{filename_out, 1000};
+        sink.write(tgd_header::buffer{"abc", 3});
+        sink.copy_from(input, 10, 20);
+        sink.copy_from(input, 0, data.size());
+        sink.copy_from(input, 5, 0);
+        sink.write(tgd_header::buffer{"xyz", 3});
+        REQUIRE_THROWS_AS(sink.copy_from(input, data.size() - 10, 20), const tgd_header::format_error&);
+        sink.close();
+    }
+
+    const auto out = read_whole_file(filename_out);
+    REQUIRE(out.substr(0, 3 + 20 + data.size() + 3) == "abc" + data.substr(10, 20) + data + "xyz");
+
+    unlink(filename_in);
+    unlink(filename_out);
+}
+
+TEST_CASE("Read buffers using pread source") {
+    const auto filename = "test_file_17";
+
+    {
+        tgd_header::file_sink sink{filename};
+        sink.write(tgd_header::buffer{"0123456789", 10});
+        sink.close();
+    }
+
+    const tgd_header::pread_source source{filename};
+
+    const auto b1 = source.read_at(3, 4);
+    REQUIRE(b1.managed());
+    REQUIRE(std::string(b1.data(), b1.size()) == "3456");
+
+    const auto b2 = source.read_at(0, 10);
+    REQUIRE(std::string(b2.data(), b2.size()) == "0123456789");
+
+    REQUIRE_FALSE(source.read_at(10, 1));
+    REQUIRE_FALSE(source.read_at(100, 1));
+    REQUIRE_THROWS_AS(source.read_at(8, 4), const tgd_header::format_error&);
+
+    unlink(filename);
+}
+
+static std::size_t content_size(std::size_t i) {
+    return i * 10;
+}
+
+static std::string make_layers(std::vector<std::uint64_t>& offsets) {
+    return make_test_layers(offsets, 20, content_size, tgd_header::layer_compression_type::zlib);
+}
+
+static bool check_layer(tgd_header::layer& layer, std::size_t i) {
+    return check_test_layer(layer, i, content_size);
+}
+
+TEST_CASE("Read layers at offsets from positional sources") {
+    const auto filename = "test_file_18";
+
+    std::vector<std::uint64_t> offsets;
+    const auto data = make_layers(offsets);
+
+    {
+        tgd_header::file_sink sink{filename};
+        sink.write(tgd_header::buffer{data.data(), data.size()});
+        sink.close();
+    }
+
+    const tgd_header::buffer b{data.data(), data.size()};
+    const tgd_header::buffer_source buffer_source{b};
+    const tgd_header::mmap_source mmap_source{filename};
+    const tgd_header::pread_source pread_source{filename};
+
+    for (std::size_t i = offsets.size(); i > 0; --i) {
+        auto l1 = tgd_header::read_layer_at(buffer_source, offsets[i - 1]);
+        REQUIRE(check_layer(l1, i - 1));
+        auto l2 = tgd_header::read_layer_at(mmap_source, offsets[i - 1]);
+        REQUIRE(check_layer(l2, i - 1));
+        auto l3 = tgd_header::read_layer_at(pread_source, offsets[i - 1]);
+        REQUIRE(check_layer(l3, i - 1));
+    }
+
+    const auto header_only = tgd_header::read_layer_at(pread_source, offsets[5], false);
+    REQUIRE(header_only.has_name("layer5"));
+    REQUIRE_FALSE(header_only.wire_content());
+
+    auto lazy = tgd_header::read_layer_at(pread_source, offsets[7], false);
+    REQUIRE(lazy.has_wire_content_fetcher());
+    REQUIRE(check_layer(lazy, 7));
+
+    REQUIRE_FALSE(tgd_header::read_layer_at(pread_source, data.size()));
+    REQUIRE_THROWS_AS(tgd_header::read_layer_at(pread_source, 8), const tgd_header::format_error&);
+
+    unlink(filename);
+}
+
+TEST_CASE("Read layers from several threads using one pread source") {
+    const auto filename = "test_file_19";
+
+    std::vector<std::uint64_t> offsets;
+    const auto data = make_layers(offsets);
+
+    {
+        tgd_header::file_sink sink{filename};
+        sink.write(tgd_header::buffer{data.data(), data.size()});
+        sink.close();
+    }
+
+    const tgd_header::pread_source source{filename};
+
+    std::vector<int> results(8, 0);
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < results.size(); ++t) {
+        threads.emplace_back([&, t]() {
+            // Every thread reads all layers sequentially using its own
+            // cursor starting at a different layer and then directly
+            // using the offsets.
+            const auto start = t % offsets.size();
+            tgd_header::cursor<tgd_header::pread_source> cursor{source, offsets[start]};
+            tgd_header::reader<tgd_header::cursor<tgd_header::pread_source>> reader{cursor, offsets[start]};
+            std::size_t n = start;
+            while (auto& layer = reader.next_layer()) {
+                reader.read_content();
+                if (reader.layer_offset() != offsets[n] || !check_layer(layer, n)) {
+                    return;
+                }
+                ++n;
+            }
+            if (n != offsets.size()) {
+                return;
+            }
+            for (std::size_t i = 0; i < offsets.size(); ++i) {
+                auto layer = tgd_header::read_layer_at(source, offsets[i]);
+                if (!check_layer(layer, i)) {
+                    return;
+                }
+            }
+            results[t] = 1;
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    REQUIRE(results == std::vector<int>(8, 1));
 
     unlink(filename);
 }
@@ -0,0 +1,190 @@
+
+#include <catch.hpp>
+
+#include <tgd_header/buffer.hpp>
+#include <tgd_header/file_sink.hpp>
+#include <tgd_header/index.hpp>
+#include <tgd_header/layer.hpp>
+#include <tgd_header/mmap_source.hpp>
+#include <tgd_header/reader.hpp>
+#include <tgd_header/string_sink.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const char content[] = "some content for the layers in this file";
+
+static void write_test_file(const char* filename) {
+    tgd_header::file_sink sink{filename};
+    for (std::uint32_t x = 0; x < 4; ++x) {
+        for (const char* name : {"water", "roads", "buildings"}) {
+            tgd_header::layer layer;
+            layer.set_name(name);
+            layer.set_tile(tgd_header::tile_address{3, x, 7 - x});
+            layer.set_content_type(tgd_header::layer_content_type::vt2);
+            layer.set_compression_type(tgd_header::layer_compression_type::zlib);
+            layer.set_content(content, x * 10);
+            layer.write(sink);
+        }
+    }
+    sink.close();
+}
+
+static std::string build_index(const char* filename) {
+    tgd_header::mmap_source source{filename};
+    tgd_header::reader<decltype(source)> reader{source};
+
+    tgd_header::layer_index_builder builder;
+    while (auto& layer = reader.next_layer()) {
+        builder.add(layer, reader.layer_offset());
+    }
+    REQUIRE(builder.size() == 12);
+
+    std::string out;
+    tgd_header::string_sink sink{out};
+    const auto size = builder.write(sink);
+    REQUIRE(size == out.size());
+
+    return out;
+}
+
+TEST_CASE("Build index and find layers") {
+    const auto filename = "test_index_1";
+    write_test_file(filename);
+
+    const auto index_data = build_index(filename);
+    tgd_header::buffer buffer{index_data.data(), index_data.size()};
+    tgd_header::layer_index index{buffer};
+    REQUIRE(index.size() == 12);
+    REQUIRE_FALSE(index.empty());
+
+    // entries are sorted
+    REQUIRE(index[0].tile() == tgd_header::tile_address(3, 0, 7));
+    REQUIRE(index[0].has_name("buildings"));
+    REQUIRE(index[11].tile() == tgd_header::tile_address(3, 3, 4));
+    REQUIRE(index[11].has_name("water"));
+
+    REQUIRE_FALSE(index.find(tgd_header::tile_address{3, 2, 2}, "roads"));
+    REQUIRE_FALSE(index.find(tgd_header::tile_address{3, 2, 5}, "rivers"));
+    REQUIRE_FALSE(index.find(tgd_header::tile_address{3, 2, 5}, "roads", tgd_header::layer_content_type::png));
+    REQUIRE_FALSE(index.find(tgd_header::tile_address{9, 9, 9}, "roads"));
+
+    const auto entry = index.find(tgd_header::tile_address{3, 2, 5}, "roads", tgd_header::layer_content_type::vt2);
+    REQUIRE(entry);
+    REQUIRE(entry.content_type() == tgd_header::layer_content_type::vt2);
+    REQUIRE(entry.name_length() == 5);
+    REQUIRE(entry.offset() > 0);
+    REQUIRE(entry.size() > 40);
+
+    // read the layer from the tile file
+    tgd_header::mmap_source source{filename};
+    tgd_header::reader<decltype(source)> reader{source};
+    reader.seek(entry.offset());
+    auto& layer = reader.next_layer();
+    REQUIRE(layer);
+    REQUIRE(reader.layer_offset() == entry.offset());
+    REQUIRE(layer.has_name("roads"));
+    REQUIRE(layer.tile() == tgd_header::tile_address(3, 2, 5));
+    REQUIRE(layer.record_size() == entry.size());
+    reader.read_content();
+    layer.decode_content();
+    REQUIRE(layer.content_length() == 20);
+    REQUIRE(!std::memcmp(layer.content().data(), content, 20));
+
+    // the next layer directly follows
+    auto& next = reader.next_layer();
+    REQUIRE(reader.layer_offset() == entry.offset() + entry.size());
+    REQUIRE(next.has_name("buildings"));
+
+    unlink(filename);
+}
+
+TEST_CASE("Empty index") {
+    std::string out;
+    tgd_header::string_sink sink{out};
+
+    tgd_header::layer_index_builder builder;
+    builder.write(sink);
+
+    tgd_header::buffer buffer{out.data(), out.size()};
+    tgd_header::layer_index index{buffer};
+    REQUIRE(index.empty());
+    REQUIRE_FALSE(index.find(tgd_header::tile_address{}, "x"));
+}
+
+TEST_CASE("Invalid index throws") {
+    std::string data{"TGI0...."};
+    tgd_header::buffer buffer{data.data(), data.size()};
+    REQUIRE_THROWS_AS(tgd_header::layer_index{buffer}, const tgd_header::format_error&);
+
+    data = "ABCD123456789012";
+    tgd_header::buffer buffer2{data.data(), data.size()};
+    REQUIRE_THROWS_AS(tgd_header::layer_index{buffer2}, const tgd_header::format_error&);
+
+    tgd_header::layer_index_builder builder;
+    builder.add(tgd_header::tile_address{}, tgd_header::layer_content_type::png, "name", 0, 48);
+    std::string out;
+    tgd_header::string_sink sink{out};
+    builder.write(sink);
+
+    // index is truncated
+    tgd_header::buffer buffer3{out.data(), out.size() - 8};
+    REQUIRE_THROWS_AS(tgd_header::layer_index{buffer3}, const tgd_header::format_error&);
+}
+
+
+TEST_CASE("Query index by tile range") {
+    // zoom 2: every other tile, zoom 3: a diagonal, two layers each
+    tgd_header::layer_index_builder builder;
+    std::uint64_t offset = 0;
+    std::vector<tgd_header::tile_address> tiles;
+    for (std::uint32_t x = 0; x < 4; ++x) {
+        for (std::uint32_t y = 0; y < 4; ++y) {
+            if ((x + y) % 2 == 0) {
+                tiles.emplace_back(2, x, y);
+            }
+        }
+    }
+    for (std::uint32_t x = 0; x < 8; ++x) {
+        tiles.emplace_back(3, x, x);
+    }
+    for (const auto& tile : tiles) {
+        for (const char* name : {"roads", "water"}) {
+            builder.add(tile, tgd_header::layer_content_type::vt2, name, offset, 64);
+            offset += 64;
+        }
+    }
+
+    std::string index_data;
+    tgd_header::string_sink sink{index_data};
+    builder.write(sink);
+    const tgd_header::layer_index index{tgd_header::buffer{index_data.data(), index_data.size()}};
+
+    const auto check = [&](const tgd_header::tile_range& range) {
+        std::vector<tgd_header::tile_address> found;
+        index.for_each_in(range, [&](const tgd_header::layer_index_entry& entry) {
+            REQUIRE(range.contains(entry.tile()));
+            found.push_back(entry.tile());
+        });
+        const auto expected = std::count_if(tiles.begin(), tiles.end(), [&](const tgd_header::tile_address& tile) {
+            return range.contains(tile);
+        });
+        REQUIRE(found.size() == static_cast<std::size_t>(expected) * 2);
+        REQUIRE(std::is_sorted(found.begin(), found.end()));
+    };
+
+    check(tgd_header::tile_range{2});
+    check(tgd_header::tile_range{3});
+    check(tgd_header::tile_range{4});
+    check(tgd_header::tile_range{2, 1, 1, 2, 3});
+    check(tgd_header::tile_range{2, 3, 0, 3, 0});
+    check(tgd_header::tile_range{3, 2, 0, 5, 3});
+    check(tgd_header::tile_range{3, 6, 6, 7, 7});
+
+    REQUIRE(index.query(0, 255).size() == index.size());
+    REQUIRE(index.query(3, 3).size() == 16);
+    REQUIRE(index.query(2, 2, tgd_header::geo_bbox{-90.0, 0.0, -1.0, 60.0}).size() == 2);
+    REQUIRE(index.query(0, 1).empty());
+}
@@ -0,0 +1,196 @@
+#include <catch.hpp>
+#include <test_layers.hpp>
+
+#include <tgd_header/buffer_source.hpp>
+#include <tgd_header/file_sink.hpp>
+#include <tgd_header/file_source.hpp>
+#include <tgd_header/layer.hpp>
+#include <tgd_header/reader.hpp>
+#include <tgd_header/string_sink.hpp>
+#include <tgd_header/uring_sink.hpp>
+#include <tgd_header/uring_source.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+static_assert(!std::is_copy_constructible<tgd_header::uring_source>(), "uring_source should not be copy constructible");
+static_assert(!std::is_copy_assignable<tgd_header::uring_source>(), "uring_source should not be copy constructible");
+
+// read_at() uses the ring, so it can't be called on a const uring_source
+static_assert(!tgd_header::detail::has_read_at<const tgd_header::uring_source>(), "uring_source::read_at() should not be const");
+static_assert(tgd_header::detail::has_read_at<tgd_header::uring_source>(), "uring_source should have read_at()");
+
+static_assert(!std::is_copy_constructible<tgd_header::uring_sink>(), "uring_sink should not be copy constructible");
+static_assert(!std::is_copy_assignable<tgd_header::uring_sink>(), "uring_sink should not be copy constructible");
+
+// Layers with content sizes from 0 to 30000 bytes, so some of them fit into
+// the first read of the uring_source and some don't.
+static std::size_t content_size(std::size_t i) {
+    return i * i * 19;
+}
+
+static std::string make_uring_layers(std::vector<std::uint64_t>& offsets) {
+    return make_test_layers(offsets, 40, content_size, tgd_header::layer_compression_type::uncompressed);
+}
+
+static bool check_uring_layer(tgd_header::layer& layer, std::size_t i) {
+    return check_test_layer(layer, i, content_size);
+}
+
+static std::string read_whole_uring_file(const char* filename) {
+    tgd_header::file_source source{filename};
+    const auto buffer = source.read(source.file_size());
+    return std::string(buffer.data(), buffer.size());
+}
+
+TEST_CASE("Read layers using uring source") {
+    if (!tgd_header::io_uring_available()) {
+        WARN("io_uring not available, test skipped");
+        return;
+    }
+
+    const auto filename = "test_file_20";
+
+    std::vector<std::uint64_t> offsets;
+    const auto data = make_uring_layers(offsets);
+
+    {
+        tgd_header::file_sink sink{filename};
+        sink.write(tgd_header::buffer{data.data(), data.size()});
+        sink.close();
+    }
+
+    for (const unsigned queue_depth : {1, 4, 64}) {
+        tgd_header::uring_source source{filename, queue_depth, 4096};
+        REQUIRE(source.queue_depth() == queue_depth);
+
+        // read layers in reverse order plus one offset at the end of file
+        std::vector<std::uint64_t> read_offsets{offsets.rbegin(), offsets.rend()};
+        read_offsets.push_back(data.size());
+
+        std::vector<bool> seen(read_offsets.size(), false);
+        source.read_layers(read_offsets, [&](std::size_t index, tgd_header::layer& layer) {
+            REQUIRE_FALSE(seen[index]);
+            seen[index] = true;
+            if (index == offsets.size()) {
+                REQUIRE_FALSE(layer);
+            } else {
+                REQUIRE(check_uring_layer(layer, offsets.size() - index - 1));
+            }
+        });
+        REQUIRE(std::all_of(seen.begin(), seen.end(), [](bool b) { return b; }));
+
+        std::size_t count = 0;
+        source.read_layers(offsets, [&](std::size_t index, tgd_header::layer& layer) {
+            REQUIRE(layer.has_name("layer" + std::to_string(index)));
+            REQUIRE_FALSE(layer.wire_content());
+            ++count;
+        }, false);
+        REQUIRE(count == offsets.size());
+
+        auto layer = tgd_header::read_layer_at(source, offsets[33]);
+        REQUIRE(check_uring_layer(layer, 33));
+    }
+
+    unlink(filename);
+}
+
+TEST_CASE("Uring source throws on invalid data") {
+    if (!tgd_header::io_uring_available()) {
+        WARN("io_uring not available, test skipped");
+        return;
+    }
+
+    const auto filename = "test_file_21";
+
+    std::vector<std::uint64_t> offsets;
+    const auto data = make_uring_layers(offsets);
+
+    {
+        tgd_header::file_sink sink{filename};
+        // truncated in the middle of the content of the last layer
+        sink.write(tgd_header::buffer{data.data(), data.size() - 100});
+        sink.close();
+    }
+
+    tgd_header::uring_source source{filename, 8};
+
+    std::vector<std::uint64_t> bad_offsets{offsets[0], 8, offsets[1]};
+    REQUIRE_THROWS_AS(source.read_layers(bad_offsets, [](std::size_t, tgd_header::layer&) {}),
+                      const tgd_header::format_error&);
+
+    std::vector<std::uint64_t> truncated{offsets.back()};
+    REQUIRE_THROWS_AS(source.read_layers(truncated, [](std::size_t, tgd_header::layer&) {}),
+                      const tgd_header::format_error&);
+
+    // source can still be used after an error
+    std::size_t count = 0;
+    source.read_layers(offsets, [&](std::size_t, tgd_header::layer&) {
+        ++count;
+    }, false);
+    REQUIRE(count == offsets.size());
+
+    unlink(filename);
+}
+
+TEST_CASE("Write layers using uring sink") {
+    if (!tgd_header::io_uring_available()) {
+        WARN("io_uring not available, test skipped");
+        return;
+    }
+
+    const auto filename = "test_file_22";
+
+    std::vector<std::uint64_t> offsets;
+    const auto data = make_uring_layers(offsets);
+
+    for (const std::size_t batch_size : {8, 1000, 4096, 10000000}) {
+        {
+            tgd_header::uring_sink sink{filename, 3, batch_size};
+            for (std::size_t i = 0; i < offsets.size(); ++i) {
+                const auto end = i + 1 < offsets.size() ? offsets[i + 1] : data.size();
+                tgd_header::buffer b{data.data() + offsets[i], end - offsets[i]};
+                tgd_header::buffer_source source{b};
+                tgd_header::reader<tgd_header::buffer_source> reader{source};
+                auto& layer = reader.next_layer();
+                reader.read_content();
+                layer.write(sink);
+            }
+            sink.padding(3);
+            sink.write(tgd_header::buffer{"abc", 3});
+            sink.close();
+        }
+
+        REQUIRE(read_whole_uring_file(filename) == data + std::string(3, '\0') + "abc");
+    }
+
+    unlink(filename);
+}
+
+TEST_CASE("Uring sink flushes on destruction and can be moved") {
+    if (!tgd_header::io_uring_available()) {
+        WARN("io_uring not available, test skipped");
+        return;
+    }
+
+    const auto filename = "test_file_23";
+
+    {
+        tgd_header::uring_sink sink{filename};
+        sink.write(tgd_header::buffer{"abc", 3});
+        REQUIRE(sink.file_size() == 0);
+
+        tgd_header::uring_sink sink2{std::move(sink)};
+        sink2.write(tgd_header::buffer{"def", 3});
+        sink2.flush();
+        REQUIRE(sink2.file_size() == 6);
+        sink2.write(tgd_header::buffer{"ghi", 3});
+    }
+
+    REQUIRE(read_whole_uring_file(filename) == "abcdefghi");
+
+    unlink(filename);
+}
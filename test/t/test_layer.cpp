@@ -4,6 +4,7 @@
 #include <tgd_header/buffer.hpp>
 #include <tgd_header/buffer_source.hpp>
 #include <tgd_header/layer.hpp>
+#include <tgd_header/layer_view.hpp>
 #include <tgd_header/reader.hpp>
 #include <tgd_header/string_sink.hpp>
 #include <tgd_header/tile.hpp>
@@ -11,7 +12,13 @@
 
 #include <array>
 #include <cstring>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <utility>
+
+static_assert(!std::is_copy_constructible<tgd_header::reader<tgd_header::buffer_source>>(), "reader should not be copy constructible");
+static_assert(!std::is_move_constructible<tgd_header::reader<tgd_header::buffer_source>>(), "reader should not be move constructible");
 
 static const char content[] = "the quick brown fox jumps over the lazy dog";
 
@@ -180,6 +187,87 @@ TEST_CASE("auto-skips content if read_content() is not called") {
     REQUIRE_FALSE(reader.next_layer());
 }
 
+TEST_CASE("Content is read and decoded lazily when accessed") {
+    const auto out = create_test_layer();
+
+    tgd_header::buffer b{out.data(), out.size()};
+    tgd_header::buffer_source source{b};
+    tgd_header::reader<tgd_header::buffer_source> reader{source};
+    auto& new_layer = reader.next_layer();
+
+    REQUIRE(new_layer.has_wire_content_fetcher());
+    REQUIRE_FALSE(new_layer.wire_content());
+    REQUIRE_FALSE(new_layer.content());
+
+    REQUIRE(!std::strcmp(new_layer.load_content().data(), content));
+    REQUIRE_FALSE(new_layer.has_wire_content_fetcher());
+    REQUIRE(new_layer.wire_content());
+    REQUIRE(!std::strcmp(new_layer.content().data(), content));
+
+    // content is cached and read_content() doesn't read it again
+    reader.read_content();
+    REQUIRE(!std::strcmp(new_layer.load_content().data(), content));
+    REQUIRE_FALSE(reader.next_layer());
+}
+
+TEST_CASE("Writing a layer reads its content lazily") {
+    const auto out = create_test_layer();
+
+    tgd_header::buffer b{out.data(), out.size()};
+    tgd_header::buffer_source source{b};
+    tgd_header::reader<tgd_header::buffer_source> reader{source};
+    auto& new_layer = reader.next_layer();
+
+    std::string copy;
+    tgd_header::string_sink sink{copy};
+    new_layer.write(sink);
+    REQUIRE(copy == out);
+}
+
+TEST_CASE("Setting new content replaces lazily read content") {
+    const auto out = create_test_layer();
+
+    tgd_header::buffer b{out.data(), out.size()};
+    tgd_header::buffer_source source{b};
+    tgd_header::reader<tgd_header::buffer_source> reader{source};
+    auto& new_layer = reader.next_layer();
+
+    new_layer.set_content("abc", 3);
+    REQUIRE_FALSE(new_layer.has_wire_content_fetcher());
+    REQUIRE(std::string(new_layer.content().data(), new_layer.content().size()) == "abc");
+}
+
+TEST_CASE("Lazy content is not available after reader moved on") {
+    const auto one = create_test_layer();
+    const auto out = one + one;
+
+    tgd_header::buffer b{out.data(), out.size()};
+    tgd_header::buffer_source source{b};
+    tgd_header::reader<tgd_header::buffer_source> reader{source};
+
+    auto first = std::move(reader.next_layer());
+    REQUIRE(first);
+    REQUIRE(reader.next_layer());
+    REQUIRE_THROWS_AS(first.load_content(), const std::logic_error&);
+}
+
+TEST_CASE("Lazy content is not available after reader is gone") {
+    const auto out = create_test_layer();
+
+    tgd_header::buffer b{out.data(), out.size()};
+    tgd_header::buffer_source source{b};
+    tgd_header::layer layer;
+
+    {
+        tgd_header::reader<tgd_header::buffer_source> reader{source};
+        layer = std::move(reader.next_layer());
+        REQUIRE(layer);
+    }
+
+    REQUIRE(layer.has_wire_content_fetcher());
+    REQUIRE_THROWS_AS(layer.load_content(), const std::logic_error&);
+}
+
 TEST_CASE("Error in compressed content is detected") {
     auto out = create_test_layer();
 
@@ -197,6 +285,32 @@ TEST_CASE("Error in compressed content is detected") {
     REQUIRE_THROWS_WITH(new_layer.decode_content(), "failed to uncompress data: data error");
 }
 
+TEST_CASE("Invalid records are detected when reading") {
+    auto out = create_test_layer();
+
+    tgd_header::buffer b{out.data(), out.size()};
+    tgd_header::buffer_source source{b};
+    tgd_header::reader<tgd_header::buffer_source> reader{source};
+
+    SECTION("unknown compression type") {
+        out[tgd_header::detail::offset::compression_type] = 7;
+        REQUIRE_THROWS_WITH(tgd_header::layer(out.data(), out.size()), "unknown compression type");
+        REQUIRE_THROWS_WITH(reader.next_layer(), "unknown compression type");
+    }
+
+    SECTION("name not terminated") {
+        out[tgd_header::detail::header_size + 4] = 'x';
+        REQUIRE_THROWS_WITH(reader.next_layer(), "name not terminated");
+        REQUIRE_THROWS_WITH(tgd_header::read_layer_at(source, 0), "name not terminated");
+    }
+
+    SECTION("name contains zero byte") {
+        out[tgd_header::detail::header_size + 1] = '\0';
+        REQUIRE_THROWS_WITH(reader.next_layer(), "name contains zero byte");
+        REQUIRE_THROWS_WITH(tgd_header::read_layer_at(source, 0), "name contains zero byte");
+    }
+}
+
 TEST_CASE("Length of compressed content is too large") {
     auto out = create_test_layer();
 
@@ -231,3 +345,185 @@ TEST_CASE("Length of compressed content is too small") {
     REQUIRE_THROWS_WITH(new_layer.decode_content(), "failed to uncompress data: buffer error");
 }
 
+TEST_CASE("Scanning headers never touches the content") {
+    auto out = create_test_layer();
+    const auto wire_length = out.size() - 32 - 8;
+    out += create_test_layer();
+
+    // corrupt the compressed data in the first layer
+    out[40] = '\0';
+
+    tgd_header::buffer b{out.data(), out.size()};
+    tgd_header::buffer_source source{b};
+    tgd_header::reader<tgd_header::buffer_source> reader{source};
+
+    int count = 0;
+    while (auto& layer = reader.next_layer()) {
+        REQUIRE(layer.has_name("test"));
+        REQUIRE(layer.content_length() == sizeof(content));
+        REQUIRE(tgd_header::detail::padded_size(layer.wire_content_length()) == wire_length);
+        REQUIRE_FALSE(layer.wire_content());
+        REQUIRE_FALSE(layer.content());
+        ++count;
+    }
+    REQUIRE(count == 2);
+}
+
+TEST_CASE("Encode and decode many layers with the same zlib context") {
+    tgd_header::zlib_context context;
+
+    std::string out;
+    tgd_header::string_sink sink{out};
+
+    for (std::size_t n = 1; n < sizeof(content); n += 7) {
+        tgd_header::layer layer;
+        layer.set_compression_type(tgd_header::layer_compression_type::zlib);
+        layer.set_name("test");
+        layer.set_content(content, n);
+        layer.write(sink, context);
+    }
+
+    tgd_header::buffer b{out.data(), out.size()};
+    tgd_header::buffer_source source{b};
+    tgd_header::reader<tgd_header::buffer_source> reader{source};
+
+    std::size_t n = 1;
+    while (auto& layer = reader.next_layer()) {
+        reader.read_content();
+        layer.decode_content(context);
+        REQUIRE(layer.content_length() == n);
+        REQUIRE(std::string(layer.content().data(), layer.content().size()) == std::string(content, n));
+        n += 7;
+    }
+    REQUIRE(n > sizeof(content));
+}
+
+TEST_CASE("Adaptive compression") {
+    tgd_header::zlib_options options;
+    options.adaptive = true;
+
+    const std::string compressible(1000, 'x');
+
+    tgd_header::layer layer;
+    layer.set_name("test");
+    layer.set_compression_type(tgd_header::layer_compression_type::zlib);
+
+    SECTION("compressible content is compressed") {
+        tgd_header::zlib_context context{options};
+        layer.set_content(compressible.data(), compressible.size());
+        layer.encode_content(context);
+        REQUIRE(layer.compression_type() == tgd_header::layer_compression_type::zlib);
+        REQUIRE(layer.wire_content_length() < compressible.size());
+    }
+
+    SECTION("incompressible content is stored uncompressed") {
+        tgd_header::zlib_context context{options};
+        layer.set_content(content, sizeof(content));
+        layer.encode_content(context);
+        REQUIRE(layer.compression_type() == tgd_header::layer_compression_type::uncompressed);
+        REQUIRE(layer.wire_content_length() == sizeof(content));
+        REQUIRE(layer.wire_content().data() == layer.content().data());
+    }
+
+    SECTION("content not saving enough is stored uncompressed") {
+        options.min_savings = 100;
+        tgd_header::zlib_context context{options};
+        layer.set_content(compressible.data(), compressible.size());
+        layer.encode_content(context);
+        REQUIRE(layer.compression_type() == tgd_header::layer_compression_type::uncompressed);
+    }
+
+    SECTION("already compressed content types are not compressed") {
+        tgd_header::zlib_context context{options};
+        layer.set_content_type(tgd_header::layer_content_type::png);
+        layer.set_content(compressible.data(), compressible.size());
+        layer.encode_content(context);
+        REQUIRE(layer.compression_type() == tgd_header::layer_compression_type::uncompressed);
+    }
+
+    SECTION("without adaptive compression the content is always compressed") {
+        tgd_header::zlib_context context;
+        layer.set_content(content, sizeof(content));
+        layer.encode_content(context);
+        REQUIRE(layer.compression_type() == tgd_header::layer_compression_type::zlib);
+        REQUIRE(layer.wire_content_length() > sizeof(content));
+    }
+}
+
+
+TEST_CASE("Layers with checksum") {
+    tgd_header::layer layer;
+    layer.set_name("test");
+    layer.set_tile(tgd_header::tile_address{4, 3, 2});
+    layer.set_compression_type(tgd_header::layer_compression_type::zlib);
+    layer.set_content(content, sizeof(content));
+    REQUIRE_FALSE(layer.has_checksum());
+    layer.enable_checksum();
+    REQUIRE(layer.has_checksum());
+    REQUIRE(layer.flags() == tgd_header::layer_flags::checksum);
+
+    std::string out;
+    tgd_header::string_sink sink{out};
+    layer.write(sink);
+
+    SECTION("checksum is okay") {
+        tgd_header::buffer b{out.data(), out.size()};
+        tgd_header::buffer_source source{b};
+        tgd_header::reader<tgd_header::buffer_source> reader{source};
+        auto& new_layer = reader.next_layer();
+        REQUIRE(new_layer.has_checksum());
+        REQUIRE(new_layer.checksum() == layer.checksum());
+        REQUIRE(new_layer.verify_checksum());
+        REQUIRE(!std::strcmp(new_layer.load_content().data(), content));
+
+        const tgd_header::layer_view view{out.data(), out.size()};
+        REQUIRE(view.has_checksum());
+        REQUIRE(view.checksum() == layer.checksum());
+        REQUIRE(view.verify_checksum());
+    }
+
+    SECTION("corrupted content is detected") {
+        out[out.size() - 10] ^= 1;
+        tgd_header::buffer b{out.data(), out.size()};
+        tgd_header::buffer_source source{b};
+        tgd_header::reader<tgd_header::buffer_source> reader{source};
+        auto& new_layer = reader.next_layer();
+        REQUIRE_FALSE(new_layer.verify_checksum());
+        REQUIRE_THROWS_AS(new_layer.decode_content(), const tgd_header::format_error&);
+        REQUIRE_THROWS_WITH(new_layer.decode_content(), "checksum mismatch");
+
+        const tgd_header::layer_view view{out.data(), out.size()};
+        REQUIRE_FALSE(view.verify_checksum());
+    }
+
+    SECTION("corrupted header is detected") {
+        out[13] ^= 1; // part of tile x
+        const tgd_header::layer_view view{out.data(), out.size()};
+        REQUIRE_FALSE(view.verify_checksum());
+
+        auto new_layer = view.to_layer();
+        REQUIRE_FALSE(new_layer.verify_checksum());
+    }
+
+    SECTION("checksum can be disabled again") {
+        tgd_header::layer_view view{out.data(), out.size()};
+        auto new_layer = view.to_layer();
+        new_layer.enable_checksum(false);
+        REQUIRE_FALSE(new_layer.has_checksum());
+
+        std::string out2;
+        tgd_header::string_sink sink2{out2};
+        new_layer.write(sink2);
+        const tgd_header::layer_view view2{out2.data(), out2.size()};
+        REQUIRE_FALSE(view2.has_checksum());
+        REQUIRE(view2.verify_checksum());
+    }
+}
+
+TEST_CASE("Layers without checksum always verify") {
+    const auto out = create_test_layer();
+    const tgd_header::layer_view view{out.data(), out.size()};
+    REQUIRE_FALSE(view.has_checksum());
+    REQUIRE(view.verify_checksum());
+    REQUIRE(view.flags() == 0);
+}
@@ -0,0 +1,256 @@
+
+#include <catch.hpp>
+
+#include <tgd_header/buffer.hpp>
+#include <tgd_header/layer.hpp>
+#include <tgd_header/layer_cache.hpp>
+#include <tgd_header/shared_buffer.hpp>
+#include <tgd_header/string_sink.hpp>
+#include <tgd_header/tile.hpp>
+#include <tgd_header/zlib_context.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+static tgd_header::shared_buffer make_content(std::size_t size, char c) {
+    const std::string data(size, c);
+    return tgd_header::shared_buffer{tgd_header::buffer{data.data(), data.size()}.copy()};
+}
+
+static tgd_header::layer_cache_key make_key(std::uint32_t x, const char* name = "water") {
+    return tgd_header::layer_cache_key{1, tgd_header::tile_address{5, x, 7}, name};
+}
+
+TEST_CASE("Layer cache needs power of two shards") {
+    REQUIRE_THROWS_AS(tgd_header::layer_cache(1000, 0), const std::invalid_argument&);
+    REQUIRE_THROWS_AS(tgd_header::layer_cache(1000, 3), const std::invalid_argument&);
+
+    const tgd_header::layer_cache cache{1000, 4};
+    REQUIRE(cache.num_shards() == 4);
+    REQUIRE(cache.max_bytes() == 1000);
+}
+
+TEST_CASE("Layer cache keys") {
+    REQUIRE(make_key(1) == make_key(1));
+    REQUIRE(make_key(1) != make_key(2));
+    REQUIRE(make_key(1) != make_key(1, "roads"));
+    REQUIRE(make_key(1) != (tgd_header::layer_cache_key{2, tgd_header::tile_address{5, 1, 7}, "water"}));
+    REQUIRE(make_key(1).hash() == make_key(1).hash());
+
+    tgd_header::layer layer;
+    layer.set_name("water");
+    layer.set_tile(tgd_header::tile_address{5, 3, 7});
+    REQUIRE((tgd_header::layer_cache_key{1, layer}) == make_key(3));
+}
+
+TEST_CASE("Put and get layers") {
+    tgd_header::layer_cache cache{1000};
+
+    REQUIRE_FALSE(cache.get(make_key(1)));
+
+    const auto content = make_content(10, 'a');
+    REQUIRE(cache.put(make_key(1), content));
+
+    const auto found = cache.get(make_key(1));
+    REQUIRE(found);
+    REQUIRE(found.data() == content.data());
+    REQUIRE_FALSE(cache.get(make_key(1, "roads")));
+
+    // replace content
+    REQUIRE(cache.put(make_key(1), make_content(20, 'b')));
+    REQUIRE(cache.get(make_key(1)).size() == 20);
+
+    auto stats = cache.stats();
+    REQUIRE(stats.hits == 2);
+    REQUIRE(stats.misses == 2);
+    REQUIRE(stats.evictions == 0);
+    REQUIRE(stats.entries == 1);
+    REQUIRE(stats.bytes == 20);
+
+    cache.erase(make_key(1));
+    REQUIRE_FALSE(cache.get(make_key(1)));
+    REQUIRE(cache.stats().bytes == 0);
+
+    cache.put(make_key(1), content);
+    cache.put(make_key(2), content);
+    cache.clear();
+    stats = cache.stats();
+    REQUIRE(stats.entries == 0);
+    REQUIRE(stats.bytes == 0);
+    REQUIRE(stats.misses == 3);
+}
+
+TEST_CASE("Least recently used layers are evicted") {
+    tgd_header::layer_cache cache{100, 1};
+
+    for (std::uint32_t x = 0; x < 4; ++x) {
+        REQUIRE(cache.put(make_key(x), make_content(25, 'a')));
+    }
+    REQUIRE(cache.stats().bytes == 100);
+
+    // use layer 0, so layer 1 is now the least recently used
+    REQUIRE(cache.get(make_key(0)));
+
+    REQUIRE(cache.put(make_key(4), make_content(25, 'b')));
+    REQUIRE(cache.get(make_key(0)));
+    REQUIRE_FALSE(cache.get(make_key(1)));
+    REQUIRE(cache.get(make_key(2)));
+
+    // a larger layer evicts several
+    REQUIRE(cache.put(make_key(5), make_content(60, 'c')));
+    const auto stats = cache.stats();
+    REQUIRE(stats.evictions == 4);
+    REQUIRE(stats.entries == 2);
+    REQUIRE(stats.bytes == 85);
+    REQUIRE(cache.get(make_key(2)));
+    REQUIRE(cache.get(make_key(5)));
+
+    // too large for the cache
+    REQUIRE_FALSE(cache.put(make_key(6), make_content(101, 'd')));
+    REQUIRE_FALSE(cache.get(make_key(6)));
+    REQUIRE(cache.stats().entries == 2);
+}
+
+TEST_CASE("Evicted content stays valid while it is used") {
+    tgd_header::layer_cache cache{10, 1};
+    cache.put(make_key(1), make_content(10, 'a'));
+    const auto content = cache.get(make_key(1));
+    cache.put(make_key(2), make_content(10, 'b'));
+    REQUIRE_FALSE(cache.get(make_key(1)));
+    REQUIRE(std::string(content.data(), content.size()) == std::string(10, 'a'));
+}
+
+TEST_CASE("Decode layers through the cache") {
+    const std::string data(1000, 'x');
+    tgd_header::zlib_context context;
+
+    tgd_header::layer original;
+    original.set_name("water");
+    original.set_tile(tgd_header::tile_address{5, 3, 7});
+    original.set_compression_type(tgd_header::layer_compression_type::zlib);
+    original.set_content(data.data(), data.size());
+    std::string record;
+    tgd_header::string_sink sink{record};
+    original.write(sink, context);
+    const auto wire = original.wire_content().copy();
+
+    // A layer with only the header, the content is fetched when needed.
+    const auto make_layer = [&](int& fetches) {
+        tgd_header::layer layer{record.data(), tgd_header::detail::header_size};
+        layer.set_name("water");
+        layer.set_wire_content_fetcher([&]() {
+            ++fetches;
+            return tgd_header::buffer{wire.data(), wire.size()};
+        });
+        return layer;
+    };
+
+    tgd_header::layer_cache cache{1024 * 1024};
+
+    int fetches = 0;
+    auto l1 = make_layer(fetches);
+    const auto c1 = cache.content(1, l1, context);
+    REQUIRE(std::string(c1.data(), c1.size()) == data);
+    REQUIRE(fetches == 1);
+
+    // the content isn't fetched again
+    auto l2 = make_layer(fetches);
+    const auto c2 = cache.content(1, l2);
+    REQUIRE(c2.data() == c1.data());
+    REQUIRE(fetches == 1);
+
+    // but it is for another file
+    auto l3 = make_layer(fetches);
+    const auto c3 = cache.content(2, l3, context);
+    REQUIRE(c3.data() != c1.data());
+    REQUIRE(fetches == 2);
+
+    const auto stats = cache.stats();
+    REQUIRE(stats.hits == 1);
+    REQUIRE(stats.misses == 2);
+    REQUIRE(stats.bytes == 2 * data.size());
+}
+
+TEST_CASE("Layers with empty content are cached, too") {
+    tgd_header::zlib_context context;
+
+    tgd_header::layer original;
+    original.set_name("water");
+    original.set_tile(tgd_header::tile_address{5, 3, 7});
+    original.set_compression_type(tgd_header::layer_compression_type::zlib);
+    original.set_content("", 0);
+    std::string record;
+    tgd_header::string_sink sink{record};
+    original.write(sink, context);
+    const auto wire = original.wire_content().copy();
+    REQUIRE(wire.size() > 0);
+
+    tgd_header::layer_cache cache{1024 * 1024};
+
+    int fetches = 0;
+    const auto read_content = [&]() {
+        tgd_header::layer layer{record.data(), tgd_header::detail::header_size};
+        layer.set_name("water");
+        layer.set_wire_content_fetcher([&]() {
+            ++fetches;
+            return tgd_header::buffer{wire.data(), wire.size()};
+        });
+        return cache.content(1, layer, context);
+    };
+
+    for (int i = 0; i < 3; ++i) {
+        REQUIRE(read_content().size() == 0);
+    }
+    REQUIRE(fetches == 1);
+
+    // a cached empty shared_buffer is a hit, too
+    REQUIRE(cache.put(make_key(3), tgd_header::shared_buffer{}));
+    REQUIRE_FALSE(read_content());
+    REQUIRE(fetches == 1);
+
+    tgd_header::shared_buffer content;
+    REQUIRE(cache.get(make_key(3), &content));
+    REQUIRE(content.size() == 0);
+    REQUIRE_FALSE(cache.get(make_key(4), &content));
+
+    const auto stats = cache.stats();
+    REQUIRE(stats.hits == 4);
+    REQUIRE(stats.misses == 2);
+    REQUIRE(stats.entries == 1);
+    REQUIRE(stats.bytes == 0);
+}
+
+TEST_CASE("Use layer cache from several threads") {
+    tgd_header::layer_cache cache{16 * 1000, 4};
+
+    std::atomic<int> errors{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&cache, &errors, t]() {
+            for (std::uint32_t n = 0; n < 2000; ++n) {
+                const auto x = (n * 7U + static_cast<std::uint32_t>(t)) % 50U;
+                auto content = cache.get(make_key(x));
+                if (!content) {
+                    content = make_content(100, static_cast<char>('a' + (x % 26U)));
+                    cache.put(make_key(x), content);
+                }
+                if (content.size() != 100 || content.data()[99] != static_cast<char>('a' + (x % 26U))) {
+                    ++errors;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    REQUIRE(errors == 0);
+    const auto stats = cache.stats();
+    REQUIRE(stats.hits + stats.misses == 8000);
+    REQUIRE(stats.bytes <= cache.max_bytes());
+    REQUIRE(stats.entries * 100 == stats.bytes);
+}
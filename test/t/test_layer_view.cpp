@@ -0,0 +1,177 @@
+#include <catch.hpp>
+
+#include <tgd_header/buffer.hpp>
+#include <tgd_header/buffer_source.hpp>
+#include <tgd_header/file_sink.hpp>
+#include <tgd_header/layer.hpp>
+#include <tgd_header/layer_view.hpp>
+#include <tgd_header/mmap_source.hpp>
+#include <tgd_header/reader.hpp>
+#include <tgd_header/string_sink.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+static_assert(std::is_same<std::iterator_traits<tgd_header::layer_view_iterator>::iterator_category, std::forward_iterator_tag>::value,
+              "layer_view_iterator should be a forward iterator");
+
+static const char content[] = "some content for the layers in this buffer";
+
+static std::string make_test_data() {
+    std::string out;
+    tgd_header::string_sink sink{out};
+    for (std::uint32_t x = 0; x < 4; ++x) {
+        for (const char* name : {"water", "roads", "buildings"}) {
+            tgd_header::layer layer;
+            layer.set_name(name);
+            layer.set_tile(tgd_header::tile_address{3, x, 7 - x});
+            layer.set_content_type(tgd_header::layer_content_type::vt2);
+            layer.set_compression_type(x % 2 ? tgd_header::layer_compression_type::zlib
+                                             : tgd_header::layer_compression_type::uncompressed);
+            layer.set_content(content, x * 10);
+            layer.write(sink);
+        }
+    }
+    return out;
+}
+
+TEST_CASE("Default constructed layer_view is invalid") {
+    const tgd_header::layer_view view;
+    REQUIRE_FALSE(view);
+}
+
+TEST_CASE("Iterate over layers in buffer gives same results as reader") {
+    const auto data = make_test_data();
+    const tgd_header::buffer b{data.data(), data.size()};
+
+    tgd_header::buffer_source source{b};
+    tgd_header::reader<tgd_header::buffer_source> reader{source};
+
+    const tgd_header::layer_view_range range{b};
+    REQUIRE(std::distance(range.begin(), range.end()) == 12);
+
+    for (const auto& view : range) {
+        REQUIRE(view);
+        auto& layer = reader.next_layer();
+        reader.read_content();
+        REQUIRE(range.offset(view) == reader.layer_offset());
+        REQUIRE(view.content_type() == layer.content_type());
+        REQUIRE(view.compression_type() == layer.compression_type());
+        REQUIRE(view.tile() == layer.tile());
+        REQUIRE(view.name_length() == layer.name_length());
+        REQUIRE(view.has_name(layer.name()));
+        REQUIRE(view.has_name(std::string{layer.name()}));
+        REQUIRE(view.content_length() == layer.content_length());
+        REQUIRE(view.wire_content_length() == layer.wire_content_length());
+        REQUIRE(view.record_size() == layer.record_size());
+        REQUIRE_FALSE(view.wire_content().managed());
+        REQUIRE(std::string(view.wire_content().data(), view.wire_content().size()) ==
+                std::string(layer.wire_content().data(), layer.wire_content().size()));
+    }
+
+    REQUIRE_FALSE(reader.next_layer());
+}
+
+TEST_CASE("Use standard algorithms on layer_view_range") {
+    const auto data = make_test_data();
+    const tgd_header::layer_view_range range{data.data(), data.size()};
+
+    const auto it = std::find_if(range.begin(), range.end(), [](const tgd_header::layer_view& view) {
+        return view.tile().x() == 2 && view.has_name("roads");
+    });
+    REQUIRE(it != range.end());
+    REQUIRE(it->tile() == tgd_header::tile_address(3, 2, 5));
+
+    auto layer = it->to_layer();
+    REQUIRE(layer.has_name("roads"));
+    REQUIRE_FALSE(layer.wire_content().managed());
+    layer.decode_content();
+    REQUIRE(std::string(layer.content().data(), layer.content().size()) == std::string(content, 20));
+
+    REQUIRE(std::count_if(range.begin(), range.end(), [](const tgd_header::layer_view& view) {
+        return view.has_name("water");
+    }) == 4);
+
+    auto it2 = range.begin();
+    const auto it3 = it2++;
+    REQUIRE(it3 == range.begin());
+    REQUIRE(it2 != range.begin());
+    REQUIRE(it2->has_name("roads"));
+}
+
+TEST_CASE("Iterate over empty range") {
+    const tgd_header::layer_view_range range{nullptr, 0};
+    REQUIRE(range.begin() == range.end());
+}
+
+TEST_CASE("Short data at end of layer_view_range is ignored") {
+    auto data = make_test_data();
+    data.append(20, 'x');
+    const tgd_header::layer_view_range range{data.data(), data.size()};
+    REQUIRE(std::distance(range.begin(), range.end()) == 12);
+}
+
+TEST_CASE("Invalid data in layer_view_range throws") {
+    auto data = make_test_data();
+
+    SECTION("truncated record") {
+        const tgd_header::layer_view_range range{data.data(), data.size() - 8};
+        auto it = range.begin();
+        for (int i = 0; i < 10; ++i) {
+            ++it;
+        }
+        REQUIRE_THROWS_AS(++it, const tgd_header::format_error&);
+    }
+
+    SECTION("magic error") {
+        data[0] = 'X';
+        const tgd_header::layer_view_range range{data.data(), data.size()};
+        REQUIRE_THROWS_AS(range.begin(), const tgd_header::format_error&);
+    }
+
+    SECTION("incomplete header") {
+        REQUIRE_THROWS_AS(tgd_header::layer_view(data.data(), 20), const tgd_header::format_error&);
+    }
+
+    SECTION("name not terminated") {
+        data[tgd_header::detail::header_size + 5] = 'x';
+        REQUIRE_THROWS_WITH(tgd_header::layer_view(data.data(), data.size()), "name not terminated");
+    }
+
+    SECTION("name contains zero byte") {
+        data[tgd_header::detail::header_size + 2] = '\0';
+        REQUIRE_THROWS_WITH(tgd_header::layer_view(data.data(), data.size()), "name contains zero byte");
+    }
+
+    SECTION("unknown compression type") {
+        data[tgd_header::detail::offset::compression_type] = 7;
+        REQUIRE_THROWS_WITH(tgd_header::layer_view(data.data(), data.size()), "unknown compression type");
+    }
+}
+
+TEST_CASE("Iterate over layers in mmapped file") {
+    const auto filename = "test_layer_view_1";
+    const auto data = make_test_data();
+
+    {
+        tgd_header::file_sink sink{filename};
+        sink.write(tgd_header::buffer{data.data(), data.size()});
+        sink.close();
+    }
+
+    const tgd_header::mmap_source source{filename};
+    const tgd_header::layer_view_range range{source.mapping()};
+
+    std::size_t count = 0;
+    for (const auto& view : range) {
+        REQUIRE(view.has_name(count % 3 == 0 ? "water" : count % 3 == 1 ? "roads" : "buildings"));
+        ++count;
+    }
+    REQUIRE(count == 12);
+
+    unlink(filename);
+}
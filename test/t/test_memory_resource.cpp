@@ -0,0 +1,172 @@
+#include <catch.hpp>
+
+#include <tgd_header/buffer.hpp>
+#include <tgd_header/memory_resource.hpp>
+#include <tgd_header/shared_buffer.hpp>
+#include <tgd_header/zlib_context.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+static_assert(!std::is_copy_constructible<tgd_header::mutable_buffer>(), "mutable_buffer should not be copy constructible");
+static_assert(std::is_nothrow_move_constructible<tgd_header::mutable_buffer>(), "mutable_buffer should be nothrow move constructible");
+
+namespace {
+
+    // Memory resource keeping track of allocations for testing.
+    class counting_resource : public tgd_header::memory_resource {
+
+    public:
+
+        std::size_t allocations = 0;
+        std::size_t deallocations = 0;
+        std::size_t bytes = 0;
+
+        char* allocate(std::size_t size) override {
+            ++allocations;
+            bytes += size;
+            return tgd_header::new_delete_resource()->allocate(size);
+        }
+
+        void deallocate(char* data, std::size_t size) noexcept override {
+            ++deallocations;
+            bytes -= size;
+            tgd_header::new_delete_resource()->deallocate(data, size);
+        }
+
+    }; // class counting_resource
+
+} // anonymous namespace
+
+TEST_CASE("Buffers using custom memory resource") {
+    counting_resource resource;
+
+    {
+        tgd_header::mutable_buffer mb{100, &resource};
+        REQUIRE(mb.resource() == &resource);
+        REQUIRE(resource.allocations == 1);
+
+        tgd_header::buffer b{std::move(mb), 10};
+        REQUIRE(b.managed());
+        REQUIRE(b.resource() == &resource);
+        REQUIRE(b.size() == 10);
+        REQUIRE(b.capacity() == 100);
+
+        const auto b2 = b.copy(&resource);
+        REQUIRE(b2.resource() == &resource);
+        REQUIRE(resource.allocations == 2);
+        REQUIRE(resource.bytes == 110);
+
+        const auto b3 = b.copy();
+        REQUIRE(b3.resource() == tgd_header::new_delete_resource());
+    }
+
+    REQUIRE(resource.deallocations == 2);
+    REQUIRE(resource.bytes == 0);
+}
+
+TEST_CASE("Shared buffer gives memory back to memory resource") {
+    counting_resource resource;
+
+    {
+        tgd_header::mutable_buffer mb{100, &resource};
+        tgd_header::shared_buffer sb{tgd_header::buffer{std::move(mb), 20}};
+        REQUIRE(sb.size() == 20);
+        REQUIRE(resource.deallocations == 0);
+    }
+
+    REQUIRE(resource.deallocations == 1);
+    REQUIRE(resource.bytes == 0);
+}
+
+TEST_CASE("Pool resource reuses blocks") {
+    counting_resource upstream;
+
+    {
+        tgd_header::pool_resource pool{1000, &upstream};
+        REQUIRE(pool.max_block_size() == 1024);
+
+        char* p1 = pool.allocate(100);
+        REQUIRE(upstream.allocations == 1);
+        char* p2 = pool.allocate(100);
+        REQUIRE(p1 != p2);
+        REQUIRE(reinterpret_cast<std::uintptr_t>(p2) % alignof(std::max_align_t) == 0);
+
+        pool.deallocate(p1, 100);
+        REQUIRE(pool.allocate(120) == p1);
+
+        pool.deallocate(p2, 100);
+        REQUIRE(pool.allocate(1000) != p2);
+
+        // larger allocations go to upstream directly
+        char* large = pool.allocate(2000);
+        REQUIRE(upstream.allocations == 2);
+        pool.deallocate(large, 2000);
+        REQUIRE(upstream.deallocations == 1);
+
+        for (int i = 0; i < 10; ++i) {
+            tgd_header::mutable_buffer mb{50, &pool};
+            tgd_header::buffer b{std::move(mb)};
+        }
+        REQUIRE(upstream.allocations == 2);
+    }
+
+    REQUIRE(upstream.bytes == 0);
+}
+
+TEST_CASE("Arena resource") {
+    counting_resource upstream;
+
+    {
+        tgd_header::arena_resource arena{1024, &upstream};
+
+        char* p1 = arena.allocate(10);
+        char* p2 = arena.allocate(10);
+        REQUIRE(p2 == p1 + tgd_header::detail::aligned_size(10));
+        REQUIRE(upstream.allocations == 1);
+
+        arena.allocate(2000);
+        REQUIRE(upstream.allocations == 2);
+
+        arena.allocate(1000);
+        REQUIRE(upstream.allocations == 3);
+        REQUIRE(arena.bytes_allocated() >= 3010);
+
+        arena.reset();
+        REQUIRE(arena.bytes_allocated() == 0);
+        REQUIRE(upstream.deallocations == 1);
+        REQUIRE(arena.allocate(10) == p1);
+        REQUIRE(upstream.allocations == 3);
+
+        {
+            tgd_header::mutable_buffer mb{100, &arena};
+            tgd_header::buffer b{std::move(mb)};
+        }
+        REQUIRE(arena.bytes_allocated() > 100);
+    }
+
+    REQUIRE(upstream.bytes == 0);
+}
+
+TEST_CASE("zlib context using arena resource") {
+    tgd_header::arena_resource arena;
+    tgd_header::zlib_context context{tgd_header::zlib_options{}, &arena};
+    REQUIRE(context.resource() == &arena);
+
+    const std::string data(1000, 'x');
+    const auto compressed = context.compress(data.data(), data.size());
+    REQUIRE(compressed.resource() == &arena);
+
+    const auto uncompressed = context.uncompress(compressed.data(), compressed.size(), data.size());
+    REQUIRE(uncompressed.resource() == &arena);
+    REQUIRE(std::string(uncompressed.data(), uncompressed.size()) == data);
+
+    context.set_resource(tgd_header::new_delete_resource());
+    const auto compressed2 = context.compress(data.data(), data.size());
+    REQUIRE(compressed2.resource() == tgd_header::new_delete_resource());
+}
+
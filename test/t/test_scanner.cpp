@@ -0,0 +1,127 @@
+#include <catch.hpp>
+
+#include <tgd_header/encoding.hpp>
+#include <tgd_header/layer.hpp>
+#include <tgd_header/scanner.hpp>
+#include <tgd_header/string_sink.hpp>
+
+#include <cstdint>
+#include <string>
+
+static std::string make_record(const char* name, bool checksum = false) {
+    std::string out;
+    tgd_header::string_sink sink{out};
+    tgd_header::layer layer;
+    layer.set_name(name);
+    layer.set_tile(tgd_header::tile_address{4, 3, 2});
+    layer.set_content("some content", 12);
+    layer.enable_checksum(checksum);
+    layer.write(sink);
+    return out;
+}
+
+TEST_CASE("find_magic on data without magic") {
+    const std::string data(1000, 'x');
+    REQUIRE(tgd_header::find_magic(data.data(), data.size(), 0) == data.size());
+    REQUIRE(tgd_header::find_magic(data.data(), 0, 0) == 0);
+    REQUIRE(tgd_header::find_magic(data.data(), 3, 0) == 3);
+}
+
+TEST_CASE("find_magic finds magic at every aligned offset") {
+    // Covers offsets inside the vectorized blocks and in the tail.
+    for (std::size_t size : {8U, 40U, 64U, 72U, 200U}) {
+        for (std::size_t pos = 0; pos + 4 <= size; pos += 8) {
+            std::string data(size, 'x');
+            data.replace(pos, 4, "TGD0");
+            REQUIRE(tgd_header::find_magic(data.data(), size, 0) == pos);
+            REQUIRE(tgd_header::find_magic(data.data(), size, pos) == pos);
+            REQUIRE(tgd_header::find_magic(data.data(), size, pos + 1) == size);
+        }
+    }
+}
+
+TEST_CASE("find_magic ignores magic at unaligned offsets") {
+    std::string data(200, 'x');
+    data.replace(4, 4, "TGD0");
+    data.replace(67, 4, "TGD0");
+    data.replace(130, 4, "TGD0");
+    REQUIRE(tgd_header::find_magic(data.data(), data.size(), 0) == data.size());
+
+    data.replace(136, 4, "TGD0");
+    REQUIRE(tgd_header::find_magic(data.data(), data.size(), 0) == 136);
+}
+
+TEST_CASE("find_magic rounds start offset up") {
+    std::string data(200, 'x');
+    data.replace(16, 4, "TGD0");
+    data.replace(96, 4, "TGD0");
+    REQUIRE(tgd_header::find_magic(data.data(), data.size(), 9) == 16);
+    REQUIRE(tgd_header::find_magic(data.data(), data.size(), 17) == 96);
+}
+
+TEST_CASE("check_record on valid records") {
+    const auto record = make_record("water");
+    REQUIRE(tgd_header::check_record(record.data(), record.size()) == record.size());
+
+    const auto with_checksum = make_record("water", true);
+    REQUIRE(tgd_header::check_record(with_checksum.data(), with_checksum.size()) == with_checksum.size());
+}
+
+TEST_CASE("check_record rejects damaged records") {
+    auto record = make_record("water", true);
+
+    SECTION("truncated") {
+        REQUIRE(tgd_header::check_record(record.data(), record.size() - 8) == 0);
+        REQUIRE(tgd_header::check_record(record.data(), 20) == 0);
+    }
+
+    SECTION("wrong magic") {
+        record[3] = '1';
+        REQUIRE(tgd_header::check_record(record.data(), record.size()) == 0);
+    }
+
+    SECTION("zero name length") {
+        record[tgd_header::detail::offset::name_length] = 0;
+        REQUIRE(tgd_header::check_record(record.data(), record.size()) == 0);
+    }
+
+    SECTION("name length too long") {
+        record[tgd_header::detail::offset::name_length] = 7;
+        REQUIRE(tgd_header::check_record(record.data(), record.size()) == 0);
+    }
+
+    SECTION("invalid compression type") {
+        record[tgd_header::detail::offset::compression_type] = 5;
+        REQUIRE(tgd_header::check_record(record.data(), record.size()) == 0);
+    }
+
+    SECTION("content length too large") {
+        record[tgd_header::detail::offset::content_length + 1] = 1;
+        REQUIRE(tgd_header::check_record(record.data(), record.size()) == 0);
+    }
+
+    SECTION("content damaged") {
+        record[record.size() - 16] ^= 1;
+        REQUIRE(tgd_header::check_record(record.data(), record.size()) == 0);
+    }
+}
+
+TEST_CASE("find_record skips garbage and damaged records") {
+    const auto a = make_record("water", true);
+    auto b = make_record("roads", true);
+    const auto c = make_record("buildings", true);
+    b[b.size() - 16] ^= 1;
+
+    const std::string garbage(120, 'x');
+    std::string data = a + garbage + "TGD0TGD0" + b + c;
+    const std::uint64_t offset_c = data.size() - c.size();
+
+    REQUIRE(tgd_header::find_record(data.data(), data.size(), 0) == 0);
+    REQUIRE(tgd_header::find_record(data.data(), data.size(), 8) == offset_c);
+    REQUIRE(tgd_header::find_record(data.data(), data.size(), offset_c + 8) == data.size());
+
+    // without the checksum the damaged record is still plausible
+    const auto d = make_record("roads");
+    data = a + garbage + d;
+    REQUIRE(tgd_header::find_record(data.data(), data.size(), 8) == a.size() + garbage.size());
+}
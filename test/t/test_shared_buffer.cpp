@@ -0,0 +1,160 @@
+#include <catch.hpp>
+
+#include <tgd_header/buffer_source.hpp>
+#include <tgd_header/file_sink.hpp>
+#include <tgd_header/layer.hpp>
+#include <tgd_header/mmap_source.hpp>
+#include <tgd_header/reader.hpp>
+#include <tgd_header/shared_buffer.hpp>
+#include <tgd_header/string_sink.hpp>
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+static_assert(std::is_copy_constructible<tgd_header::shared_buffer>(), "shared_buffer should be copy constructible");
+static_assert(std::is_nothrow_move_constructible<tgd_header::shared_buffer>(), "shared_buffer should be nothrow move constructible");
+
+TEST_CASE("Empty shared buffer") {
+    tgd_header::shared_buffer b;
+
+    REQUIRE_FALSE(b);
+    REQUIRE(b.size() == 0);
+    REQUIRE(b.data() == nullptr);
+    REQUIRE(b.begin() == b.end());
+    REQUIRE(b.use_count() == 0);
+
+    tgd_header::shared_buffer b2{tgd_header::buffer{}};
+    REQUIRE_FALSE(b2);
+}
+
+TEST_CASE("Shared buffer takes over managed buffer") {
+    tgd_header::mutable_buffer mb{5};
+    std::memcpy(mb.data(), "abcde", 5);
+    tgd_header::buffer b{std::move(mb)};
+    const char* data = b.data();
+
+    tgd_header::shared_buffer sb{std::move(b)};
+    REQUIRE_FALSE(b);
+    REQUIRE(sb.data() == data);
+    REQUIRE(sb.size() == 5);
+    REQUIRE(sb.use_count() == 1);
+
+    const auto sb2 = sb;
+    REQUIRE(sb2.data() == data);
+    REQUIRE(sb.use_count() == 2);
+
+    sb.clear();
+    REQUIRE_FALSE(sb);
+    REQUIRE(sb2.use_count() == 1);
+    REQUIRE(std::string(sb2.begin(), sb2.end()) == "abcde");
+}
+
+TEST_CASE("Shared buffer copies non-managed buffer") {
+    const char data[] = "abcde";
+    tgd_header::shared_buffer sb{tgd_header::buffer{data, 5}};
+
+    REQUIRE(sb.data() != data);
+    REQUIRE(sb.size() == 5);
+    REQUIRE(std::string(sb.begin(), sb.end()) == "abcde");
+}
+
+TEST_CASE("Shared buffer with custom deleter") {
+    int deleted = 0;
+    const char* deleted_data = nullptr;
+    const char data[] = "abcde";
+
+    {
+        tgd_header::shared_buffer sb{data, 5, [&](const char* d) {
+            deleted_data = d;
+            ++deleted;
+        }};
+        const auto slice = sb.slice(1, 3);
+        sb.clear();
+        REQUIRE(deleted == 0);
+        REQUIRE(std::string(slice.begin(), slice.end()) == "bcd");
+    }
+
+    REQUIRE(deleted == 1);
+    REQUIRE(deleted_data == data);
+}
+
+TEST_CASE("Slicing shared buffers") {
+    tgd_header::shared_buffer sb{tgd_header::buffer{"abcdefgh", 8}};
+
+    const auto s1 = sb.slice(2, 4);
+    REQUIRE(s1.data() == sb.data() + 2);
+    REQUIRE(std::string(s1.begin(), s1.end()) == "cdef");
+    REQUIRE(sb.use_count() == 2);
+
+    const auto s2 = s1.slice(1, 2);
+    REQUIRE(std::string(s2.begin(), s2.end()) == "de");
+    REQUIRE(sb.use_count() == 3);
+
+    const auto s3 = sb.slice(8, 0);
+    REQUIRE(s3.size() == 0);
+
+    REQUIRE_THROWS_AS(sb.slice(9, 0), const std::range_error&);
+    REQUIRE_THROWS_AS(sb.slice(4, 5), const std::range_error&);
+    REQUIRE_THROWS_AS(s1.slice(0, 5), const std::range_error&);
+
+    const auto view = s1.view();
+    REQUIRE_FALSE(view.managed());
+    REQUIRE(view.data() == s1.data());
+    REQUIRE(view.size() == 4);
+}
+
+TEST_CASE("Shared buffer from decoded layer content") {
+    tgd_header::layer layer;
+    layer.set_name("test");
+    layer.set_compression_type(tgd_header::layer_compression_type::zlib);
+    layer.set_content("some content", 12);
+
+    std::string out;
+    tgd_header::string_sink sink{out};
+    layer.write(sink);
+
+    tgd_header::buffer b{out.data(), out.size()};
+    tgd_header::buffer_source source{b};
+    tgd_header::reader<tgd_header::buffer_source> reader{source};
+    auto& layer2 = reader.next_layer();
+    REQUIRE(layer2);
+    reader.read_content();
+    layer2.decode_content();
+    const char* data = layer2.content().data();
+
+    tgd_header::shared_buffer sb{layer2.release_content()};
+    REQUIRE_FALSE(layer2.content());
+    REQUIRE(sb.data() == data);
+    REQUIRE(std::string(sb.begin(), sb.end()) == "some content");
+}
+
+TEST_CASE("Shared buffers keep mmap alive") {
+    const auto filename = "test_file_shared";
+
+    {
+        tgd_header::file_sink sink{filename};
+        sink.write(tgd_header::buffer{"0123456789", 10});
+    }
+
+    tgd_header::shared_buffer slice;
+    tgd_header::shared_buffer all;
+    {
+        tgd_header::mmap_source source{filename};
+        source.skip(2);
+        slice = source.read_shared(3);
+        REQUIRE(slice);
+        all = source.mapping();
+        REQUIRE_FALSE(source.read_shared(100));
+        source.close();
+    }
+
+    REQUIRE(std::string(slice.begin(), slice.end()) == "234");
+    REQUIRE(std::string(all.begin(), all.end()) == "0123456789");
+    REQUIRE(slice.use_count() == 2);
+
+    unlink(filename);
+}
+
@@ -0,0 +1,144 @@
+
+#include <catch.hpp>
+
+#include <tgd_header/exceptions.hpp>
+#include <tgd_header/tile.hpp>
+#include <tgd_header/tile_key.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <set>
+#include <unordered_set>
+#include <vector>
+
+static_assert(tgd_header::morton_encode(0, 0) == 0, "morton_encode should be constexpr");
+static_assert(tgd_header::morton_encode(1, 0) == 1, "x goes into the even bits");
+static_assert(tgd_header::morton_encode(0, 1) == 2, "y goes into the odd bits");
+static_assert(tgd_header::morton_encode(0xffffffffU, 0xffffffffU) == 0xffffffffffffffffULL, "all bits are used");
+static_assert(tgd_header::morton_decode(5, 0x36).x() == 6 && tgd_header::morton_decode(5, 0x36).y() == 5, "morton_decode should be constexpr");
+static_assert(tgd_header::hilbert_encode(1, 0, 1) == 1, "hilbert_encode should be constexpr");
+static_assert(tgd_header::hilbert_decode(1, 2).x() == 1 && tgd_header::hilbert_decode(1, 2).y() == 1, "hilbert_decode should be constexpr");
+
+TEST_CASE("Morton keys") {
+    REQUIRE(tgd_header::morton_key(tgd_header::tile_address{2, 3, 1}) == 0x7);
+    REQUIRE(tgd_header::morton_key(tgd_header::tile_address{2, 1, 3}) == 0xb);
+
+    for (unsigned int zoom = 0; zoom <= 6; ++zoom) {
+        const std::uint32_t n = 1U << zoom;
+        for (std::uint32_t x = 0; x < n; ++x) {
+            for (std::uint32_t y = 0; y < n; ++y) {
+                const tgd_header::tile_address tile{static_cast<std::uint8_t>(zoom), x, y};
+                const auto key = tgd_header::morton_key(tile);
+                REQUIRE(key == tgd_header::morton_encode(x, y));
+                REQUIRE(key < static_cast<std::uint64_t>(n) * n);
+                REQUIRE(tgd_header::tile_from_morton_key(tile.zoom(), key) == tile);
+                REQUIRE(tgd_header::morton_decode(tile.zoom(), key) == tile);
+            }
+        }
+    }
+}
+
+TEST_CASE("Morton keys on highest zoom level") {
+    const tgd_header::tile_address tile{32, 0xfedcba98U, 0x12345678U};
+    const auto key = tgd_header::morton_key(tile);
+    REQUIRE(key == tgd_header::morton_encode(tile.x(), tile.y()));
+    REQUIRE(tgd_header::tile_from_morton_key(32, key) == tile);
+}
+
+TEST_CASE("Hilbert keys") {
+    for (unsigned int zoom = 0; zoom <= 7; ++zoom) {
+        const std::uint32_t n = 1U << zoom;
+        std::vector<tgd_header::tile_address> by_key(static_cast<std::size_t>(n) * n);
+        for (std::uint32_t x = 0; x < n; ++x) {
+            for (std::uint32_t y = 0; y < n; ++y) {
+                const tgd_header::tile_address tile{static_cast<std::uint8_t>(zoom), x, y};
+                const auto key = tgd_header::hilbert_key(tile);
+                REQUIRE(key == tgd_header::hilbert_encode(tile.zoom(), x, y));
+                REQUIRE(key < by_key.size());
+                REQUIRE(tgd_header::tile_from_hilbert_key(tile.zoom(), key) == tile);
+                REQUIRE(tgd_header::hilbert_decode(tile.zoom(), key) == tile);
+                by_key[key] = tile;
+            }
+        }
+
+        // the curve starts in the corner and consecutive tiles are neighbours
+        REQUIRE(by_key.front() == (tgd_header::tile_address{static_cast<std::uint8_t>(zoom), 0, 0}));
+        for (std::size_t i = 1; i < by_key.size(); ++i) {
+            const auto dx = std::max(by_key[i].x(), by_key[i - 1].x()) - std::min(by_key[i].x(), by_key[i - 1].x());
+            const auto dy = std::max(by_key[i].y(), by_key[i - 1].y()) - std::min(by_key[i].y(), by_key[i - 1].y());
+            REQUIRE(dx + dy == 1);
+        }
+    }
+}
+
+TEST_CASE("Hilbert keys on high zoom levels") {
+    for (unsigned int zoom = 25; zoom <= 32; ++zoom) {
+        const std::uint32_t mask = zoom == 32 ? 0xffffffffU : (1U << zoom) - 1U;
+        const tgd_header::tile_address tile{static_cast<std::uint8_t>(zoom), 0x9abcdef1U & mask, 0x2468ace1U & mask};
+        const auto key = tgd_header::hilbert_key(tile);
+        REQUIRE(key == tgd_header::hilbert_encode(tile.zoom(), tile.x(), tile.y()));
+        REQUIRE(tgd_header::tile_from_hilbert_key(tile.zoom(), key) == tile);
+    }
+}
+
+TEST_CASE("Quadkeys") {
+    REQUIRE(tgd_header::quadkey(tgd_header::tile_address{}).empty());
+    REQUIRE(tgd_header::quadkey(tgd_header::tile_address{3, 3, 5}) == "213");
+    REQUIRE(tgd_header::quadkey(tgd_header::tile_address{2, 3, 0}) == "11");
+
+    REQUIRE(tgd_header::tile_from_quadkey("") == tgd_header::tile_address{});
+    REQUIRE(tgd_header::tile_from_quadkey("213") == (tgd_header::tile_address{3, 3, 5}));
+    REQUIRE(tgd_header::tile_from_quadkey("0000000000") == (tgd_header::tile_address{10, 0, 0}));
+
+    REQUIRE_THROWS_AS(tgd_header::tile_from_quadkey("0124"), const tgd_header::format_error&);
+    REQUIRE_THROWS_AS(tgd_header::tile_from_quadkey(std::string(33, '1')), const tgd_header::format_error&);
+}
+
+TEST_CASE("Tile ordering") {
+    const tgd_header::tile_address t1{1, 1, 0};
+    const tgd_header::tile_address t2{1, 0, 1};
+    const tgd_header::tile_address t3{2, 0, 0};
+
+    REQUIRE(t2 < t1);
+    REQUIRE(t1 < t3);
+    REQUIRE(t2 < t3);
+    REQUIRE_FALSE(t1 < t1);
+    REQUIRE(t1 <= t1);
+    REQUIRE(t3 > t1);
+    REQUIRE(t3 >= t3);
+
+    std::vector<tgd_header::tile_address> tiles{t3, t1, t2};
+    std::sort(tiles.begin(), tiles.end(), tgd_header::morton_order{});
+    REQUIRE(tiles[0] == t1);
+    REQUIRE(tiles[1] == t2);
+    REQUIRE(tiles[2] == t3);
+
+    std::sort(tiles.begin(), tiles.end(), tgd_header::hilbert_order{});
+    REQUIRE(tiles[0] == t2);
+    REQUIRE(tiles[1] == t1);
+    REQUIRE(tiles[2] == t3);
+
+    std::set<tgd_header::tile_address> set{t1, t2, t3, t1};
+    REQUIRE(set.size() == 3);
+}
+
+TEST_CASE("Tile hashing") {
+    std::unordered_set<tgd_header::tile_address> tiles;
+    for (unsigned int zoom = 0; zoom <= 5; ++zoom) {
+        const std::uint32_t n = 1U << zoom;
+        for (std::uint32_t x = 0; x < n; ++x) {
+            for (std::uint32_t y = 0; y < n; ++y) {
+                tiles.insert(tgd_header::tile_address{static_cast<std::uint8_t>(zoom), x, y});
+            }
+        }
+    }
+    REQUIRE(tiles.size() == 1365);
+    REQUIRE(tiles.count(tgd_header::tile_address{5, 31, 31}) == 1);
+    REQUIRE(tiles.count(tgd_header::tile_address{5, 32, 31}) == 0);
+
+    const std::hash<tgd_header::tile_address> hash;
+    REQUIRE(hash(tgd_header::tile_address{1, 0, 1}) != hash(tgd_header::tile_address{1, 1, 0}));
+    REQUIRE(hash(tgd_header::tile_address{1, 0, 0}) != hash(tgd_header::tile_address{2, 0, 0}));
+}
+
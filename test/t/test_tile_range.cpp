@@ -0,0 +1,62 @@
+
+#include <catch.hpp>
+
+#include <tgd_header/tile.hpp>
+#include <tgd_header/tile_range.hpp>
+
+TEST_CASE("Geographic bounding box") {
+    const tgd_header::geo_bbox world;
+    REQUIRE(world.valid());
+    REQUIRE(world.min_lon == -180.0);
+    REQUIRE(world.max_lat == tgd_header::geo_bbox::max_latitude());
+
+    REQUIRE((tgd_header::geo_bbox{13.08, 52.33, 13.77, 52.68}.valid()));
+    REQUIRE_FALSE((tgd_header::geo_bbox{13.77, 52.33, 13.08, 52.68}.valid()));
+    REQUIRE_FALSE((tgd_header::geo_bbox{13.08, 52.68, 13.77, 52.33}.valid()));
+    REQUIRE_FALSE((tgd_header::geo_bbox{-181.0, 0.0, 0.0, 0.0}.valid()));
+    REQUIRE_FALSE((tgd_header::geo_bbox{0.0, 0.0, 0.0, 91.0}.valid()));
+}
+
+TEST_CASE("Tile range for whole zoom level") {
+    const tgd_header::tile_range range{3};
+    REQUIRE(range.zoom() == 3);
+    REQUIRE(range.min_x() == 0);
+    REQUIRE(range.min_y() == 0);
+    REQUIRE(range.max_x() == 7);
+    REQUIRE(range.max_y() == 7);
+
+    REQUIRE(range.contains(tgd_header::tile_address{3, 7, 0}));
+    REQUIRE_FALSE(range.contains(tgd_header::tile_address{3, 8, 0}));
+    REQUIRE_FALSE(range.contains(tgd_header::tile_address{2, 1, 1}));
+
+    const tgd_header::tile_range max_range{32};
+    REQUIRE(max_range.max_x() == 0xffffffffU);
+}
+
+TEST_CASE("Tile range from bounding box") {
+    const tgd_header::geo_bbox berlin{13.08, 52.33, 13.77, 52.68};
+
+    const tgd_header::tile_range range{10, berlin};
+    REQUIRE(range.min_x() == 549);
+    REQUIRE(range.min_y() == 335);
+    REQUIRE(range.max_x() == 551);
+    REQUIRE(range.max_y() == 336);
+    REQUIRE(range.contains(tgd_header::tile_address{10, 550, 336}));
+    REQUIRE_FALSE(range.contains(tgd_header::tile_address{10, 552, 336}));
+
+    const tgd_header::tile_range range0{0, berlin};
+    REQUIRE(range0.max_x() == 0);
+    REQUIRE(range0.max_y() == 0);
+
+    const tgd_header::tile_range world{1, tgd_header::geo_bbox{}};
+    REQUIRE(world.min_x() == 0);
+    REQUIRE(world.min_y() == 0);
+    REQUIRE(world.max_x() == 1);
+    REQUIRE(world.max_y() == 1);
+
+    const tgd_header::tile_range poles{2, tgd_header::geo_bbox{-10.0, -90.0, 10.0, 90.0}};
+    REQUIRE(poles.min_x() == 1);
+    REQUIRE(poles.min_y() == 0);
+    REQUIRE(poles.max_x() == 2);
+    REQUIRE(poles.max_y() == 3);
+}
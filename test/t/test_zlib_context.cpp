@@ -0,0 +1,86 @@
+
+#include <catch.hpp>
+
+#include <tgd_header/exceptions.hpp>
+#include <tgd_header/zlib_context.hpp>
+
+#include <string>
+#include <type_traits>
+
+static_assert(!std::is_copy_constructible<tgd_header::zlib_context>(), "zlib_context should not be copy constructible");
+static_assert(!std::is_move_constructible<tgd_header::zlib_context>(), "zlib_context should not be move constructible");
+
+TEST_CASE("Compress and uncompress with the same context many times") {
+    tgd_header::zlib_context context;
+
+    for (std::size_t n = 0; n < 10; ++n) {
+        const std::string data(n * 1000, static_cast<char>('a' + n));
+
+        const auto compressed = context.compress(data.data(), data.size());
+        REQUIRE(compressed.managed());
+        REQUIRE(compressed.size() < data.size() + 20);
+
+        const auto uncompressed = context.uncompress(compressed.data(), compressed.size(), data.size());
+        REQUIRE(uncompressed.size() == data.size());
+        REQUIRE(std::string(uncompressed.data(), uncompressed.size()) == data);
+    }
+}
+
+TEST_CASE("Uncompress with wrong size") {
+    tgd_header::zlib_context context;
+
+    const std::string data(100, 'x');
+    const auto compressed = context.compress(data.data(), data.size());
+
+    REQUIRE_THROWS_AS(context.uncompress(compressed.data(), compressed.size(), 101), const tgd_header::format_error&);
+    REQUIRE_THROWS_WITH(context.uncompress(compressed.data(), compressed.size(), 99), "failed to uncompress data: buffer error");
+    REQUIRE_THROWS_WITH(context.uncompress(compressed.data(), 3, 100), "failed to uncompress data: data error");
+
+    // context is still usable after errors
+    const auto uncompressed = context.uncompress(compressed.data(), compressed.size(), 100);
+    REQUIRE(std::string(uncompressed.data(), uncompressed.size()) == data);
+}
+
+TEST_CASE("Uncompress invalid data") {
+    tgd_header::zlib_context context;
+
+    const std::string data(20, 'x');
+    REQUIRE_THROWS_WITH(context.uncompress(data.data(), data.size(), 10), "failed to uncompress data: data error");
+}
+
+TEST_CASE("Compress with different options") {
+    const std::string data(10000, 'x');
+
+    tgd_header::zlib_context context;
+    REQUIRE(context.options().level == Z_DEFAULT_COMPRESSION);
+
+    for (const int level : {0, 1, 9}) {
+        tgd_header::zlib_options options;
+        options.level = level;
+        options.window_bits = 10;
+        options.mem_level = 9;
+        options.strategy = Z_RLE;
+        context.set_options(options);
+        REQUIRE(context.options().level == level);
+
+        const auto compressed = context.compress(data.data(), data.size());
+        if (level == 0) {
+            REQUIRE(compressed.size() > data.size());
+        } else {
+            REQUIRE(compressed.size() < data.size() / 10);
+        }
+
+        const auto uncompressed = context.uncompress(compressed.data(), compressed.size(), data.size());
+        REQUIRE(std::string(uncompressed.data(), uncompressed.size()) == data);
+    }
+}
+
+TEST_CASE("Invalid compression options") {
+    tgd_header::zlib_options options;
+    options.level = 42;
+    tgd_header::zlib_context context{options};
+
+    const std::string data(10, 'x');
+    REQUIRE_THROWS_AS(context.compress(data.data(), data.size()), const tgd_header::zlib_error&);
+}
+
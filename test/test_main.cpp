@@ -1,3 +1,6 @@
 #define CATCH_CONFIG_MAIN
+// The alternate signal stack in this version of Catch doesn't compile with
+// newer glibc versions where SIGSTKSZ isn't a constant any more.
+#define CATCH_CONFIG_NO_POSIX_SIGNALS
 #include "catch.hpp"
 